@@ -0,0 +1,71 @@
+#pragma once
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Bump-pointer storage for objects that die together, such as the AST of
+// one compilation. Allocating is a pointer increment within a block, and
+// release() (or the destructor) frees every block at once. Destructors of
+// the objects never run, so they must not own memory outside the arena.
+class Arena
+{
+public:
+    Arena() = default;
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    void *allocate(size_t size, size_t align)
+    {
+        size_t at = (used + align - 1) & ~(align - 1);
+        if (blocks.empty() || at + size > capacity)
+        {
+            // Blocks come from new[], which aligns them for any scalar type.
+            capacity = size > block_size ? size : block_size;
+            blocks.emplace_back(new char[capacity]);
+            at = 0;
+        }
+        used = at + size;
+        allocated += size;
+        return blocks.back().get() + at;
+    }
+
+    template <class T, class... Args>
+    T *make(Args &&...args)
+    {
+        static_assert(std::is_trivially_destructible<T>::value, "Arena objects are never destroyed");
+        return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    // Copies n trivially copyable objects into the arena.
+    template <class T>
+    T *copy(const T *first, size_t n)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "Arena::copy needs trivially copyable types");
+        if (n == 0)
+            return nullptr;
+        T *dst = static_cast<T *>(allocate(sizeof(T) * n, alignof(T)));
+        std::memcpy(dst, first, sizeof(T) * n);
+        return dst;
+    }
+
+    void release()
+    {
+        blocks.clear();
+        capacity = used = allocated = 0;
+    }
+
+    // Bytes handed out so far, without alignment padding or block slack.
+    size_t bytes() const { return allocated; }
+
+private:
+    static constexpr size_t block_size = 64 * 1024;
+
+    std::vector<std::unique_ptr<char[]>> blocks;
+    size_t capacity{0};
+    size_t used{0};
+    size_t allocated{0};
+};
@@ -1,71 +1,121 @@
 #pragma once
-#include <memory>
 #include <string>
-#include <vector>
+#include "arena.hpp"
+#include "symbol_table.hpp"
 #include "tokens.hpp"
 
+enum class NodeKind : uint8_t {
+    Number,
+    Identifier,
+    BinOp,
+    UnaryOp,
+    Assignment,
+    Block,
+    If,
+    While,
+    Print,
+    Program,
+    Declaration,
+    // Markers of the flat layout (see flat_ast.hpp); no Node has them.
+    ShortCircuit,
+    WhileStart,
+    Condition,
+    Else
+};
+
+// Nodes are allocated in the Arena of the compilation and released with it,
+// never one by one: they hold tokens, values and plain pointers to other
+// nodes of the same arena, nothing that needs a destructor. Consumers
+// dispatch with a switch on `kind` and cast with node_cast.
 struct Node {
-    virtual ~Node() = default;
+    NodeKind kind;
+
+protected:
+    explicit Node(NodeKind kind) : kind(kind) {}
 };
 
-struct NumberNode : Node {
+template <NodeKind K>
+struct NodeOf : Node {
+    static constexpr NodeKind tag = K;
+    NodeOf() : Node(K) {}
+};
+
+// `n` as a T, or nullptr if it is null or of another kind.
+template <class T>
+const T *node_cast(const Node *n) {
+    return n && n->kind == T::tag ? static_cast<const T *>(n) : nullptr;
+}
+
+// Child list of a block, stored contiguously in the arena.
+struct NodeList {
+    Node **items{nullptr};
+    uint32_t count{0};
+
+    Node **begin() const { return items; }
+    Node **end() const { return items + count; }
+    uint32_t size() const { return count; }
+    bool empty() const { return count == 0; }
+};
+
+// An integer literal (with its value) or, as the operand of cout, a string.
+struct NumberNode : NodeOf<NodeKind::Number> {
     Token tok;
-    explicit NumberNode(Token t) : tok(std::move(t)) {}
-    std::string getValue() const { return tok.value; }
+    int64_t value{0};
+    explicit NumberNode(Token t, int64_t v = 0) : tok(t), value(v) {}
+    std::string getValue(const Source &src) const { return src.value(tok); }
 };
 
-struct IdentifierNode : Node {
+// Variables carry the SymbolTable id the parser resolved them to.
+struct IdentifierNode : NodeOf<NodeKind::Identifier> {
     Token tok;
-    explicit IdentifierNode(Token t) : tok(std::move(t)) {}
-    std::string getValue() const { return tok.value; }
+    uint32_t symbol;
+    IdentifierNode(Token t, uint32_t symbol) : tok(t), symbol(symbol) {}
+    std::string getValue(const Source &src) const { return src.value(tok); }
 };
 
-struct BinOpNode : Node {
-    std::shared_ptr<Node> left;
+struct BinOpNode : NodeOf<NodeKind::BinOp> {
+    Node *left{nullptr};
     Token op_tok;
-    std::shared_ptr<Node> right;
+    Node *right{nullptr};
 };
 
-struct UnaryOpNode : Node {
+struct UnaryOpNode : NodeOf<NodeKind::UnaryOp> {
     Token op_tok;
-    std::shared_ptr<Node> operand;
+    Node *operand{nullptr};
 };
 
-struct AssignmentNode : Node {
+struct AssignmentNode : NodeOf<NodeKind::Assignment> {
     Token identifier;
-    std::shared_ptr<Node> expression;
-};
-
-struct BlockNode : Node {
-    std::vector<std::shared_ptr<Node>> statements;
+    uint32_t symbol{SymbolTable::none};
+    Node *expression{nullptr};
 };
 
-struct IfNode : Node {
-    std::shared_ptr<Node> condition;
-    std::shared_ptr<Node> then_branch;
-    std::shared_ptr<Node> else_branch;
+struct BlockNode : NodeOf<NodeKind::Block> {
+    NodeList statements;
 };
 
-struct WhileNode : Node {
-    std::shared_ptr<Node> condition;
-    std::shared_ptr<Node> body;
+struct IfNode : NodeOf<NodeKind::If> {
+    Node *condition{nullptr};
+    Node *then_branch{nullptr};
+    Node *else_branch{nullptr};
 };
 
-struct PrintNode : Node {
-    std::shared_ptr<Node> value;
+struct WhileNode : NodeOf<NodeKind::While> {
+    Node *condition{nullptr};
+    Node *body{nullptr};
 };
 
-struct ProgramNode : Node {
-    std::vector<std::shared_ptr<Node>> statements;
+struct PrintNode : NodeOf<NodeKind::Print> {
+    Node *value{nullptr};
 };
 
-enum class ValueType {
-    Int,
-    String
+struct ProgramNode : NodeOf<NodeKind::Program> {
+    NodeList statements;
 };
 
-struct DeclarationNode : Node {
+struct DeclarationNode : NodeOf<NodeKind::Declaration> {
     ValueType var_type;
     Token identifier;
+    uint32_t symbol{SymbolTable::none};
 };
 
@@ -0,0 +1,257 @@
+#pragma once
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include "ast.hpp"
+
+// Receives a syntax tree in post-order: every node after its operands. The
+// parser produces this stream, and whoever consumes it decides the layout:
+// TreeBuilder links nodes in an Arena, FlatBuilder stores them in one array,
+// and IntermediateCodeGen lowers them to IR as they arrive.
+//
+// Besides the nodes, the stream has markers where a consumer working in one
+// pass must act before the rest of the parent arrives: short_circuit after
+// the left operand of && or ||, while_start before a loop's condition,
+// condition after the condition of an if or a while, and else_start before
+// an else block. Builders of a tree are free to ignore them.
+class AstBuilder
+{
+public:
+    virtual ~AstBuilder() = default;
+
+    virtual void number(Token tok, int64_t value) = 0;
+    virtual void string_literal(Token tok) = 0; // operand of cout
+    virtual void identifier(Token tok, uint32_t symbol) = 0;
+    virtual void unary(Token op) = 0;         // after its operand
+    virtual void short_circuit(Token op) = 0; // after the left operand
+    virtual void binary(Token op) = 0;        // after both operands
+    virtual void declaration(ValueType type, Token identifier, uint32_t symbol) = 0;
+    virtual void assignment(Token identifier, uint32_t symbol) = 0; // after the expression
+    virtual void print() = 0;                 // after the value
+    virtual void block(uint32_t count) = 0;   // after `count` statements
+    virtual void while_start() = 0;
+    virtual void condition() = 0;             // after the condition expression
+    virtual void else_start() = 0;
+    // After condition, then block and, if has_else, else_start and block.
+    virtual void if_statement(bool has_else) = 0;
+    // After while_start, condition and body block.
+    virtual void while_statement() = 0;
+};
+
+// Links the stream into Arena nodes, keeping the operands of unfinished
+// nodes on a stack.
+class TreeBuilder final : public AstBuilder
+{
+public:
+    explicit TreeBuilder(Arena &arena) : arena(arena) {}
+
+    // The block of the whole program, once it has been parsed.
+    Node *root() const { return stack.empty() ? nullptr : stack.back(); }
+    // The node completed last.
+    Node *last() const { return stack.back(); }
+    // Takes a statement of an earlier tree as if it had just been built.
+    void reuse(Node *statement) { stack.push_back(statement); }
+
+    void number(Token tok, int64_t value) override;
+    void string_literal(Token tok) override;
+    void identifier(Token tok, uint32_t symbol) override;
+    void unary(Token op) override;
+    void short_circuit(Token) override {}
+    void binary(Token op) override;
+    void declaration(ValueType type, Token identifier, uint32_t symbol) override;
+    void assignment(Token identifier, uint32_t symbol) override;
+    void print() override;
+    void block(uint32_t count) override;
+    void while_start() override {}
+    void condition() override {}
+    void else_start() override {}
+    void if_statement(bool has_else) override;
+    void while_statement() override;
+
+private:
+    Node *pop()
+    {
+        Node *n = stack.back();
+        stack.pop_back();
+        return n;
+    }
+
+    Arena &arena;
+    std::vector<Node *> stack;
+};
+
+// Reports `n` to `out` if it is a leaf; false otherwise.
+template <class Builder>
+bool replay_leaf(const Node *n, Builder &out)
+{
+    switch (n->kind)
+    {
+    case NodeKind::Number:
+    {
+        auto x = static_cast<const NumberNode *>(n);
+        if (x->tok.type == TokenType::String)
+            out.string_literal(x->tok);
+        else
+            out.number(x->tok, x->value);
+        return true;
+    }
+    case NodeKind::Identifier:
+    {
+        auto x = static_cast<const IdentifierNode *>(n);
+        out.identifier(x->tok, x->symbol);
+        return true;
+    }
+    case NodeKind::Declaration:
+    {
+        auto x = static_cast<const DeclarationNode *>(n);
+        out.declaration(x->var_type, x->identifier, x->symbol);
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+// Plays the tree under `n` back to `out` as the parser produced it. The
+// builder is a template parameter so that a final class is called directly.
+// The walk keeps its path on a heap stack, each entry with the number of
+// steps of its node already taken, so deep trees cannot overflow the
+// native stack. Leaf operands are reported on the spot and the walk goes
+// on with the next step of the same node, so only inner nodes are pushed.
+template <class Builder>
+void replay(const Node *n, Builder &out)
+{
+    if (replay_leaf(n, out))
+        return;
+
+    struct Step
+    {
+        const Node *node;
+        uint32_t done;
+    };
+    std::vector<Step> path;
+    path.push_back(Step{n, 0});
+    while (!path.empty())
+    {
+        // Inner node to descend into; none once the node is complete.
+        const Node *next = nullptr;
+        auto visit = [&](const Node *child) {
+            if (replay_leaf(child, out))
+                return false;
+            next = child;
+            return true;
+        };
+
+        Step &at = path.back();
+        uint32_t step = at.done++;
+        switch (at.node->kind)
+        {
+        case NodeKind::BinOp:
+        {
+            // '!' is a BinOp without a left operand.
+            auto x = static_cast<const BinOpNode *>(at.node);
+            if (!x->left)
+            {
+                if (step == 0 && visit(x->right))
+                    break;
+                out.unary(x->op_tok);
+                break;
+            }
+            if (step == 0 && visit(x->left))
+                break;
+            if (step <= 1)
+            {
+                if (x->op_tok.type == TokenType::And || x->op_tok.type == TokenType::Or)
+                    out.short_circuit(x->op_tok);
+                at.done = 2;
+                if (visit(x->right))
+                    break;
+            }
+            out.binary(x->op_tok);
+            break;
+        }
+        case NodeKind::UnaryOp:
+        {
+            auto x = static_cast<const UnaryOpNode *>(at.node);
+            if (step == 0 && visit(x->operand))
+                break;
+            out.unary(x->op_tok);
+            break;
+        }
+        case NodeKind::Assignment:
+        {
+            auto x = static_cast<const AssignmentNode *>(at.node);
+            if (step == 0 && visit(x->expression))
+                break;
+            out.assignment(x->identifier, x->symbol);
+            break;
+        }
+        case NodeKind::Print:
+            if (step == 0 && visit(static_cast<const PrintNode *>(at.node)->value))
+                break;
+            out.print();
+            break;
+        case NodeKind::Block:
+        {
+            auto x = static_cast<const BlockNode *>(at.node);
+            bool descended = false;
+            for (uint32_t i = step; i < x->statements.size() && !descended; ++i)
+            {
+                at.done = i + 1;
+                descended = visit(x->statements.items[i]);
+            }
+            if (!descended)
+                out.block(x->statements.size());
+            break;
+        }
+        case NodeKind::If:
+        {
+            auto x = static_cast<const IfNode *>(at.node);
+            if (step == 0 && visit(x->condition))
+                break;
+            if (step <= 1)
+            {
+                out.condition();
+                at.done = 2;
+                if (visit(x->then_branch))
+                    break;
+            }
+            if (step <= 2 && x->else_branch)
+            {
+                out.else_start();
+                at.done = 3;
+                if (visit(x->else_branch))
+                    break;
+            }
+            out.if_statement(x->else_branch != nullptr);
+            break;
+        }
+        case NodeKind::While:
+        {
+            auto x = static_cast<const WhileNode *>(at.node);
+            if (step == 0)
+            {
+                out.while_start();
+                if (visit(x->condition))
+                    break;
+            }
+            if (step <= 1)
+            {
+                out.condition();
+                at.done = 2;
+                if (visit(x->body))
+                    break;
+            }
+            out.while_statement();
+            break;
+        }
+        default:
+            throw std::runtime_error("AST: unsupported node");
+        }
+
+        if (next)
+            path.push_back(Step{next, 0});
+        else
+            path.pop_back();
+    }
+}
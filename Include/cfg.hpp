@@ -0,0 +1,65 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "ir.hpp"
+
+// Blocks adjacent to one block, as a range of block ids.
+struct BlockList
+{
+    const uint32_t *items{nullptr};
+    uint32_t count{0};
+
+    const uint32_t *begin() const { return items; }
+    const uint32_t *end() const { return items + count; }
+    uint32_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    uint32_t operator[](uint32_t i) const { return items[i]; }
+};
+
+// The basic blocks of an InterCodeArray and the edges between them.
+//
+// A block starts at the first instruction, at every Label and after every
+// jump, and is numbered in code order. A conditional jump has two
+// successors, its target first; Jump has its target; any other block falls
+// through to the next. The last block falls through to the exit, a block of
+// its own with no instructions, numbered after all the others, so that the
+// graph has one entry (block 0) and one exit.
+//
+// Edges are kept in two flat arrays, successors and predecessors, with the
+// offset of each block's first edge; the graph takes O(blocks + edges)
+// space and time to build.
+class ControlFlowGraph
+{
+public:
+    static constexpr uint32_t none = UINT32_MAX;
+
+    explicit ControlFlowGraph(const InterCodeArray &ir);
+
+    // Blocks, the exit included.
+    uint32_t size() const { return static_cast<uint32_t>(starts.size() - 1); }
+    uint32_t entry() const { return 0; }
+    uint32_t exit() const { return size() - 1; }
+
+    // Instructions [begin, end) of block `b`.
+    uint32_t begin(uint32_t b) const { return starts[b]; }
+    uint32_t end(uint32_t b) const { return starts[b + 1]; }
+    // Block that a Label places, by the label's id.
+    uint32_t block_of_label(IROperand label) const { return label_blocks[label.id()]; }
+
+    BlockList successors(uint32_t b) const { return list(succ, succ_at, b); }
+    BlockList predecessors(uint32_t b) const { return list(pred, pred_at, b); }
+    size_t edges() const { return succ.size(); }
+
+private:
+    static BlockList list(const std::vector<uint32_t> &edges, const std::vector<uint32_t> &at, uint32_t b)
+    {
+        return BlockList{edges.data() + at[b], at[b + 1] - at[b]};
+    }
+
+    // First instruction of each block; the last entry is the code's size,
+    // twice: the exit is empty.
+    std::vector<uint32_t> starts;
+    std::vector<uint32_t> label_blocks;
+    std::vector<uint32_t> succ, succ_at;
+    std::vector<uint32_t> pred, pred_at;
+};
@@ -1,15 +1,11 @@
 #pragma once
 #include "ir.hpp"
 #include <string>
-#include <unordered_map>
 
 class CodeGenerator
 {
 public:
-    CodeGenerator(const InterCodeArray &arr,
-                  const std::unordered_map<std::string, std::string> &identifiers,
-                  const std::unordered_map<std::string, std::string> &constants,
-                  const std::unordered_map<std::string, std::string> &tempmap);
+    CodeGenerator(GeneratedIR ir, const SymbolTable &symbols);
 
     void writeAsm(const std::string &path);
 
@@ -25,23 +21,20 @@ private:
     void gen_end();
     void gen_code();
 
-    void gen_assignment(const AssignmentCode &a);
-    void gen_jump(const JumpCode &j);
-    void gen_label(const LabelCode &l);
-    void gen_compare(const CompareCodeIR &c);
-    void gen_print(const PrintCodeIR &p);
+    void gen_assignment(const IRInstr &a);
+    void gen_compare(const IRInstr &c);
+    void gen_print(const IRInstr &p);
+
+    std::string name(IROperand o) const;
+    std::string operand(IROperand o) const;
+    void load(const std::string &reg, IROperand o);
 
     void gen_print_num_function();
     void gen_print_string_function();
 
-    static std::string handleVar(const std::string &a,
-                                 const std::unordered_map<std::string, std::string> &tempmap);
-
 private:
-    const InterCodeArray &arr;
-    std::unordered_map<std::string, std::string> ids;
-    std::unordered_map<std::string, std::string> consts;
-    std::unordered_map<std::string, std::string> tempmap;
+    InterCodeArray arr;
+    const SymbolTable &symbols;
 
     std::string out;
     bool need_print_num = false;
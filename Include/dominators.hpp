@@ -0,0 +1,82 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "cfg.hpp"
+
+// Immediate dominators of the blocks of a ControlFlowGraph, by the
+// iterative algorithm of Cooper, Harvey and Kennedy ("A Simple, Fast
+// Dominance Algorithm"): blocks are visited in reverse post-order and each
+// takes the nearest common dominator of its processed predecessors, until
+// nothing changes. On the reducible graphs the IR generator produces, the
+// first round is final and the second only confirms it.
+//
+// Built over the reversed graph from the exit, the same tree gives the
+// post-dominators.
+//
+// Blocks the root does not reach (or, for post-dominators, that do not
+// reach the exit, such as an endless loop) have no immediate dominator and
+// are dominated by nothing.
+class DominatorTree
+{
+public:
+    static constexpr uint32_t none = UINT32_MAX;
+
+    enum class Direction
+    {
+        Forward, // dominators, from the entry
+        Reverse  // post-dominators, from the exit
+    };
+
+    DominatorTree(const ControlFlowGraph &cfg, Direction direction);
+
+    uint32_t root() const { return root_block; }
+    // Immediate dominator of `b`; none for the root and for blocks the root
+    // does not reach.
+    uint32_t idom(uint32_t b) const { return idoms[b]; }
+    bool reachable(uint32_t b) const { return b == root_block || idoms[b] != none; }
+    // Whether `a` dominates `b` (every block dominates itself), in O(1)
+    // from the numbering of a depth-first walk of the tree.
+    bool dominates(uint32_t a, uint32_t b) const
+    {
+        return reachable(a) && reachable(b) && enter[a] <= enter[b] && leave[b] <= leave[a];
+    }
+    // Blocks the root reaches, in reverse post-order of the graph walked.
+    const std::vector<uint32_t> &order() const { return rpo; }
+    // Children of `b` in the tree.
+    BlockList children(uint32_t b) const
+    {
+        return BlockList{kids.data() + kids_at[b], kids_at[b + 1] - kids_at[b]};
+    }
+    // Rounds over the blocks until nothing changed.
+    uint32_t rounds() const { return passes; }
+
+private:
+    uint32_t root_block;
+    std::vector<uint32_t> idoms;
+    std::vector<uint32_t> rpo;
+    std::vector<uint32_t> kids, kids_at;
+    std::vector<uint32_t> enter, leave;
+    uint32_t passes{0};
+};
+
+// Dominance frontier of every block: the blocks where its dominance ends,
+// those it does not strictly dominate that have a predecessor it dominates.
+// Computed as Cooper, Harvey and Kennedy do, by walking up the tree from
+// each predecessor of a join until the join's immediate dominator, and kept
+// in one flat array with the offset of each block's first entry, as the
+// graph keeps its edges.
+class DominanceFrontier
+{
+public:
+    DominanceFrontier(const ControlFlowGraph &cfg, const DominatorTree &dom);
+
+    BlockList operator[](uint32_t b) const
+    {
+        return BlockList{blocks.data() + at[b], at[b + 1] - at[b]};
+    }
+    // Entries over all blocks.
+    size_t size() const { return blocks.size(); }
+
+private:
+    std::vector<uint32_t> blocks, at;
+};
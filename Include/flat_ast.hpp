@@ -0,0 +1,127 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "ast_builder.hpp"
+
+// One node of the flat layout. Nodes are stored in post-order, so the
+// subtree of the node at index i is nodes[i - size + 1, i] and its last
+// operand ends at i - 1. Markers are leaves (WhileStart, Else) or wrap the
+// expression they follow (ShortCircuit, Condition), so every subtree stays
+// contiguous.
+struct FlatNode
+{
+    NodeKind kind;
+    uint8_t flag;  // Declaration: its ValueType; If: has an else block
+    uint32_t size; // nodes in the subtree, this one included
+    Token tok;     // literal, identifier or operator
+    union
+    {
+        int64_t value;   // Number
+        uint32_t symbol; // Identifier, Assignment, Declaration
+        uint32_t count;  // Block: statements
+    };
+};
+
+// The whole syntax tree in one array instead of linked Arena nodes:
+// consumers read it front to back, in the order the parser produced it.
+// Move-only, like everything that holds a whole program.
+struct FlatTree
+{
+    FlatTree() = default;
+    FlatTree(FlatTree &&) = default;
+    FlatTree &operator=(FlatTree &&) = default;
+
+    std::vector<FlatNode> nodes;
+
+    size_t bytes() const { return nodes.capacity() * sizeof(FlatNode); }
+};
+
+class FlatBuilder final : public AstBuilder
+{
+public:
+    // A parse makes at most one node per token, plus one for the program.
+    explicit FlatBuilder(size_t expected_nodes = 0) { tree.nodes.reserve(expected_nodes); }
+
+    FlatTree take() { return std::move(tree); }
+
+    void number(Token tok, int64_t value) override;
+    void string_literal(Token tok) override;
+    void identifier(Token tok, uint32_t symbol) override;
+    void unary(Token op) override;
+    void short_circuit(Token op) override;
+    void binary(Token op) override;
+    void declaration(ValueType type, Token identifier, uint32_t symbol) override;
+    void assignment(Token identifier, uint32_t symbol) override;
+    void print() override;
+    void block(uint32_t count) override;
+    void while_start() override;
+    void condition() override;
+    void else_start() override;
+    void if_statement(bool has_else) override;
+    void while_statement() override;
+
+private:
+    // Appends a node over the last `operands` subtrees.
+    FlatNode &add(NodeKind kind, Token tok, uint32_t operands);
+
+    FlatTree tree;
+};
+
+// Plays the tree back to `out` in one forward pass over the array.
+template <class Builder>
+void replay(const FlatTree &tree, Builder &out)
+{
+    for (const FlatNode &n : tree.nodes)
+    {
+        switch (n.kind)
+        {
+        case NodeKind::Number:
+            if (n.tok.type == TokenType::String)
+                out.string_literal(n.tok);
+            else
+                out.number(n.tok, n.value);
+            break;
+        case NodeKind::Identifier:
+            out.identifier(n.tok, n.symbol);
+            break;
+        case NodeKind::UnaryOp:
+            out.unary(n.tok);
+            break;
+        case NodeKind::ShortCircuit:
+            out.short_circuit(n.tok);
+            break;
+        case NodeKind::BinOp:
+            out.binary(n.tok);
+            break;
+        case NodeKind::Declaration:
+            out.declaration(static_cast<ValueType>(n.flag), n.tok, n.symbol);
+            break;
+        case NodeKind::Assignment:
+            out.assignment(n.tok, n.symbol);
+            break;
+        case NodeKind::Print:
+            out.print();
+            break;
+        case NodeKind::Block:
+            out.block(n.count);
+            break;
+        case NodeKind::WhileStart:
+            out.while_start();
+            break;
+        case NodeKind::Condition:
+            out.condition();
+            break;
+        case NodeKind::Else:
+            out.else_start();
+            break;
+        case NodeKind::If:
+            out.if_statement(n.flag != 0);
+            break;
+        case NodeKind::While:
+            out.while_statement();
+            break;
+        default:
+            throw std::runtime_error("AST: unsupported flat node");
+        }
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include "cfg.hpp"
+#include "dominators.hpp"
+#include "ir.hpp"
+#include "loops.hpp"
+
+// The control-flow analyses of one program, each computed when first asked
+// for and kept until the code changes. Every accessor compares the code's
+// revision with the one the results were computed at, and drops them all
+// if it moved on: passes only have to call InterCodeArray::changed().
+//
+// References returned stay valid until the next call after a change.
+class FlowAnalysis
+{
+public:
+    explicit FlowAnalysis(const InterCodeArray &ir) : ir(ir) {}
+
+    const ControlFlowGraph &cfg();
+    const DominatorTree &dominators();
+    const DominatorTree &post_dominators();
+    const DominanceFrontier &frontiers();
+    const LoopNest &loops();
+
+    // How many times each analysis has been computed.
+    struct Stats
+    {
+        uint32_t cfg{0};
+        uint32_t dominators{0};
+        uint32_t post_dominators{0};
+        uint32_t frontiers{0};
+        uint32_t loops{0};
+    };
+    const Stats &stats() const { return counts; }
+
+private:
+    void refresh();
+
+    const InterCodeArray &ir;
+    uint64_t revision{0};
+    std::unique_ptr<ControlFlowGraph> graph;
+    std::unique_ptr<DominatorTree> dom, post_dom;
+    std::unique_ptr<DominanceFrontier> frontier;
+    std::unique_ptr<LoopNest> nest;
+    Stats counts;
+};
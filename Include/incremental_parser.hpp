@@ -0,0 +1,145 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "arena.hpp"
+#include "ast_builder.hpp"
+#include "parser.hpp"
+#include "symbol_table.hpp"
+#include "token_buffer.hpp"
+
+// Keeps the AST of a TokenBuffer up to date across edits.
+//
+// Besides the tree, it keeps an index of the token range of every statement.
+// The index is organised block by block. Each statement's start is relative
+// to its block, so an edit only shifts the statements after it in its own
+// block and in the blocks around that one.
+//
+// After TokenBuffer::apply() has re-scanned an edit, reparse() goes down to
+// the innermost block whose statements contain the damaged tokens. There it
+// parses again only the statements that touch the damage.
+//
+// Statements inside those that the edit did not reach are reused. Each is
+// entered in a hash table under the token range it has after the edit. The
+// parser skips those tokens and takes over the old node.
+//
+// The new statements replace the old ones in the block's node list. If the
+// range no longer parses as whole statements (a brace was added or removed,
+// for instance), the statement that owns the block is parsed again instead,
+// and so on up to the whole program.
+//
+// An assignment is only legal after a declaration of its variable, so the
+// position of every variable's first declaration is kept, and a reparsed
+// assignment is checked against it. Declarations that are reused keep their
+// order. An edit that reaches a declaration, or adds one, parses the whole
+// program again.
+//
+// Nodes and index entries that an edit replaced stay allocated until the
+// next parse of the whole program. Nodes that were kept may hold tokens with
+// stale offsets. Nothing that runs after parsing reads those offsets: tokens
+// are spelled through Source::value().
+class IncrementalParser final : private StatementCache
+{
+public:
+    IncrementalParser(const TokenBuffer &tokens, const Source &src);
+
+    // Parses the whole program with a fresh symbol table. Throws like Parser.
+    Node *parse();
+    // Brings the tree up to date after tokens.apply() returned [first, last).
+    Node *reparse(size_t first, size_t last);
+
+    Node *root() const { return blocks.empty() ? nullptr : blocks[program].node; }
+    // Symbols of the tree: reparse() adds to them, parse() replaces them.
+    SymbolTable &symbols() { return *table; }
+
+    // What the last parse() or reparse() did.
+    struct Stats
+    {
+        size_t parsed{0};   // tokens parsed
+        size_t reused{0};   // statements taken over from the old tree
+        size_t attempts{0}; // ranges tried, each enclosing the previous one
+        bool whole{false};  // the whole program was parsed
+    };
+    const Stats &stats() const { return last_stats; }
+
+private:
+    static constexpr uint32_t none = UINT32_MAX;
+
+    // A statement in the index. An if or a while owns its blocks (then and
+    // else, or body), which start block_at tokens after the statement.
+    struct Stmt
+    {
+        Node *node;
+        uint32_t length; // tokens
+        uint32_t blocks[2];
+        uint32_t block_at[2];
+    };
+    // The statements of one block. Their starts are kept apart from the
+    // records so that shifting them after an edit is a tight loop.
+    struct Block
+    {
+        BlockNode *node;
+        uint32_t length;   // from after its '{' to its '}'; the program's to End
+        uint32_t capacity; // of node->statements.items
+        std::vector<uint32_t> start;
+        std::vector<Stmt> stmts;
+    };
+    // One step of the way down: statement `index` of block `block`, which
+    // starts at token `base`, and the block of it that was entered.
+    struct Level
+    {
+        uint32_t block;
+        uint32_t base;
+        uint32_t index;
+        uint32_t slot;
+    };
+    struct DoneBlock
+    {
+        uint32_t id;
+        uint32_t start;
+    };
+
+    uint32_t reuse(size_t position) override;
+    void statement(size_t start, size_t end) override;
+    void block(size_t start, size_t end, uint32_t count) override;
+
+    // Parses tokens [from, to) as a list of statements; it ends up as the
+    // last entry of `blocks`.
+    void run(size_t from, size_t to);
+    // Reparses statements [i, j) of block `id`, old tokens [from, to), that
+    // contain the damage [a, b). False if the new tokens do not parse as
+    // statements on their own.
+    bool try_range(const std::vector<Level> &path, uint32_t id, uint32_t base, uint32_t i, uint32_t j,
+                   uint32_t from, uint32_t to, uint32_t a, uint32_t b);
+    bool collect(const Stmt &s, uint32_t at, uint32_t a, uint32_t b);
+    void splice(const std::vector<Level> &path, uint32_t id, uint32_t base, uint32_t i, uint32_t j,
+                uint32_t from, uint32_t b);
+
+    const TokenBuffer &tokens;
+    const Source &src;
+    Arena arena;
+    std::unique_ptr<SymbolTable> table;
+    std::vector<Block> blocks;
+    uint32_t program{0};
+    // Token position of each variable's first declaration, or none.
+    std::vector<uint32_t> first_decl;
+    // Size of the token stream the index describes.
+    size_t known_size{0};
+    // Tokens inserted by the edit being applied, modulo 2^32.
+    uint32_t shift{0};
+    Stats last_stats;
+
+    // State of the parse in progress.
+    TreeBuilder *builder{nullptr};
+    size_t origin{0};
+    bool whole{false};
+    // Set when no range short of the program can be reparsed.
+    bool needs_whole{false};
+    std::vector<std::pair<uint32_t, Stmt>> done_stmts;
+    std::vector<DoneBlock> done_blocks;
+    // Statements that can be reused, by their start after the edit.
+    std::unordered_map<uint32_t, Stmt> candidates;
+};
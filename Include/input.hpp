@@ -0,0 +1,31 @@
+#pragma once
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+// Program text loaded for one compile. Regular files are memory-mapped;
+// stdin, pipes and other non-seekable inputs are read in chunks. Either way
+// the bytes are writable and followed by two NUL bytes, which is what flex's
+// yy_scan_buffer needs to scan the text in place without copying it.
+class InputBuffer
+{
+public:
+    InputBuffer() = default;
+    ~InputBuffer();
+    InputBuffer(const InputBuffer &) = delete;
+    InputBuffer &operator=(const InputBuffer &) = delete;
+
+    // Both return false if the input cannot be opened or read.
+    bool load_file(const char *path);
+    bool load_fd(int fd);
+
+    std::string_view text() const { return std::string_view(data, size); }
+
+private:
+    void release();
+
+    char *data{nullptr};
+    size_t size{0};
+    size_t mapped{0};       // length of the mapping, 0 when data lives in `owned`
+    std::vector<char> owned;
+};
@@ -0,0 +1,56 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Maps each distinct spelling to a dense id. The first occurrence of a
+// spelling is copied into block storage owned by the Interner, so ids stay
+// valid when the text they came from is edited or released.
+class Interner
+{
+public:
+    static constexpr uint32_t none = UINT32_MAX;
+
+    uint32_t intern(std::string_view s)
+    {
+        auto it = ids.find(s);
+        if (it != ids.end())
+            return it->second;
+        std::string_view stored = store(s);
+        uint32_t id = static_cast<uint32_t>(names.size());
+        names.push_back(stored);
+        ids.emplace(stored, id);
+        return id;
+    }
+
+    std::string_view name(uint32_t id) const { return names[id]; }
+    size_t size() const { return names.size(); }
+
+private:
+    static constexpr size_t block_size = 64 * 1024;
+
+    std::string_view store(std::string_view s)
+    {
+        if (s.empty())
+            return std::string_view();
+        if (s.size() > capacity - used)
+        {
+            capacity = s.size() > block_size ? s.size() : block_size;
+            blocks.emplace_back(new char[capacity]);
+            used = 0;
+        }
+        char *dst = blocks.back().get() + used;
+        std::memcpy(dst, s.data(), s.size());
+        used += s.size();
+        return std::string_view(dst, s.size());
+    }
+
+    std::unordered_map<std::string_view, uint32_t> ids;
+    std::vector<std::string_view> names;
+    std::vector<std::unique_ptr<char[]>> blocks;
+    size_t capacity{0};
+    size_t used{0};
+};
@@ -1,108 +1,246 @@
 #pragma once
+#include <cstdint>
 #include <string>
-#include <vector>
 #include <unordered_map>
-#include <memory>
+#include <vector>
+#include <type_traits>
 #include "ast.hpp"
+#include "flat_ast.hpp"
+#include "symbol_table.hpp"
 
-enum class IRKind
+// What an instruction does. Copy assigns operand a to dst, the arithmetic
+// ops assign a op b. The conditional jumps compare a with b and go to label
+// dst when the comparison holds; Jump goes there always and Label places
+// it. The prints write a, a number or a string constant.
+enum class IROp : uint8_t
 {
-    Assignment,
-    Jump,
+    Copy,
+    Add,
+    Sub,
+    Mul,
+    Div,
     Label,
-    Compare,
-    Print
+    Jump,
+    JumpEq,
+    JumpNe,
+    JumpLt,
+    JumpLe,
+    JumpGt,
+    JumpGe,
+    PrintInt,
+    PrintString
 };
 
-struct IRInstr
-{
-    virtual ~IRInstr() = default;
-    virtual IRKind kind() const = 0;
-};
+inline bool is_compare(IROp op) { return op >= IROp::JumpEq && op <= IROp::JumpGe; }
+// Copy and the arithmetic ops: those that assign dst.
+inline bool assigns(IROp op) { return op <= IROp::Div; }
+// "+" for Add, "<" for JumpLt, and so on; empty for the others.
+const char *ir_op_spelling(IROp op);
 
-struct AssignmentCode : IRInstr
+// What an operand names. Each kind has its own ids, dense from 0:
+// variables, temporaries and string constants are numbered by the
+// SymbolTable, immediates index the program's table of values and labels
+// are numbered in the order they are placed.
+enum class OperandKind : uint8_t
 {
-    std::string var;
-    std::string left;
-    std::string op;
-    std::string right;
-    IRKind kind() const override { return IRKind::Assignment; }
+    None,
+    Variable,
+    Temp,
+    Immediate,
+    Label,
+    String
 };
 
-struct JumpCode : IRInstr
+// Operand of an instruction, in four bytes: its kind in the top three bits
+// and its id below, so that a pass tells what it is without a lookup and
+// can index a table of the kind with the id.
+struct IROperand
 {
-    std::string dist;
-    IRKind kind() const override { return IRKind::Jump; }
-};
+    uint32_t bits{0};
 
-struct LabelCode : IRInstr
-{
-    std::string label;
-    IRKind kind() const override { return IRKind::Label; }
-};
+    static constexpr uint32_t id_bits = 29;
+    static constexpr uint32_t id_mask = (1u << id_bits) - 1;
 
-struct CompareCodeIR : IRInstr
-{
-    std::string left;
-    std::string operation;
-    std::string right;
-    std::string jump;
-    IRKind kind() const override { return IRKind::Compare; }
+    // Throws if `id` does not fit its bits.
+    static IROperand make(OperandKind kind, uint32_t id)
+    {
+        if (id > id_mask)
+            id_overflow(kind, id);
+        return IROperand{uint32_t(kind) << id_bits | id};
+    }
+    static IROperand variable(uint32_t id) { return make(OperandKind::Variable, id); }
+    static IROperand temp(uint32_t id) { return make(OperandKind::Temp, id); }
+    static IROperand immediate(uint32_t index) { return make(OperandKind::Immediate, index); }
+    static IROperand label(uint32_t id) { return make(OperandKind::Label, id); }
+    static IROperand string(uint32_t id) { return make(OperandKind::String, id); }
+
+    OperandKind kind() const { return OperandKind(bits >> id_bits); }
+    uint32_t id() const { return bits & id_mask; }
+    bool empty() const { return bits == 0; }
+    bool is_imm() const { return kind() == OperandKind::Immediate; }
+    // A variable or a temporary: something with a value in memory.
+    bool is_location() const { return kind() == OperandKind::Variable || kind() == OperandKind::Temp; }
+
+    bool operator==(IROperand o) const { return bits == o.bits; }
+    bool operator!=(IROperand o) const { return bits != o.bits; }
+
+private:
+    [[noreturn]] static void id_overflow(OperandKind kind, uint32_t id);
 };
+static_assert(IROperand::id_mask + 1 == SymbolTable::max_ids, "SymbolTable ids must fit an IROperand");
 
-struct PrintCodeIR : IRInstr
+// Labels are spelled "L1", "L2", ... in the order of their ids.
+std::string ir_label(IROperand label);
+
+// One instruction: plain data, 16 bytes, stored by value. dst is the
+// variable or temporary assigned, or the label of a Label or a jump.
+struct IRInstr
 {
-    std::string type;
-    std::string value;
-    IRKind kind() const override { return IRKind::Print; }
+    IROp op;
+    IROperand dst;
+    IROperand a;
+    IROperand b;
 };
+static_assert(sizeof(IRInstr) == 16, "IRInstr is meant to stay 16 bytes");
+static_assert(std::is_trivially_copyable<IRInstr>::value, "IRInstr is plain data");
 
+// The instructions of a program, one array of them, with the side table of
+// immediates their operands point into and the number of labels. The other
+// kinds of operands are counted by the SymbolTable. Immediates are interned
+// by value, so that every use of a literal shares one entry.
+//
+// `revision` tells analyses of the code (see FlowAnalysis) whether what
+// they computed still holds: append() moves it on, and so must a pass that
+// changes `code` in place, by calling changed().
+//
+// Move-only, like everything that holds a whole program: each phase takes
+// ownership of its input instead of copying it.
 struct InterCodeArray
 {
-    std::vector<std::shared_ptr<IRInstr>> code;
-    void append(const std::shared_ptr<IRInstr> &n) { code.push_back(n); }
+    InterCodeArray() = default;
+    InterCodeArray(InterCodeArray &&) = default;
+    InterCodeArray &operator=(InterCodeArray &&) = default;
+
+    std::vector<IRInstr> code;
+    std::vector<int64_t> immediates;
+    std::unordered_map<int64_t, uint32_t> immediate_ids;
+    uint32_t labels{0};
+    uint64_t revision{0};
+
+    void append(const IRInstr &instr)
+    {
+        code.push_back(instr);
+        ++revision;
+    }
+    void changed() { ++revision; }
+    IROperand immediate(int64_t value)
+    {
+        auto it = immediate_ids.find(value);
+        if (it != immediate_ids.end())
+            return IROperand::immediate(it->second);
+        uint32_t id = SymbolTable::next_id(immediates.size(), "immediates");
+        immediates.push_back(value);
+        immediate_ids.emplace(value, id);
+        return IROperand::immediate(id);
+    }
+    IROperand new_label()
+    {
+        IROperand label = IROperand::label(SymbolTable::next_id(labels, "labels"));
+        ++labels;
+        return label;
+    }
+    int64_t value(IROperand o) const { return immediates[o.id()]; }
+    // Operand as the IR dump spells it: "Vx", "T1", "S1", "L1" or the value.
+    std::string str(IROperand o, const SymbolTable &symbols) const;
+    size_t bytes() const
+    {
+        return code.capacity() * sizeof(IRInstr) + immediates.capacity() * sizeof(int64_t);
+    }
 };
 
 struct GeneratedIR
 {
     InterCodeArray code;
-    std::unordered_map<std::string, std::string> identifiers;
-    std::unordered_map<std::string, std::string> constants;
-    std::unordered_map<std::string, std::string> tempmap;
 };
 
-class IntermediateCodeGen
+// Lowers the syntax tree in post-order, the order the parser reports it
+// in, so that it can read the flat layout front to back. Conditions become
+// jumps whose targets are filled in once the label they lead to is placed;
+// labels are numbered in the order they appear in the code.
+class IntermediateCodeGen final : public AstBuilder
 {
 public:
-    explicit IntermediateCodeGen(const std::shared_ptr<Node> &root);
-    GeneratedIR get() const { return GeneratedIR{arr, identifiers, constants, tempmap}; }
+    // Temporaries and string constants are added to `symbols`, which the
+    // parser has filled with the variables.
+    IntermediateCodeGen(const Node *root, const Source &src, SymbolTable &symbols);
+    IntermediateCodeGen(const FlatTree &tree, const Source &src, SymbolTable &symbols);
+    // To be handed to a Parser as its builder: the program is lowered while
+    // it is parsed and no tree is built. Call take() after Parser::parse().
+    IntermediateCodeGen(const Source &src, SymbolTable &symbols);
+    // Hands the generated program over; the generator is left empty.
+    GeneratedIR take() { return GeneratedIR{std::move(arr)}; }
+
+    void number(Token tok, int64_t value) override;
+    void string_literal(Token tok) override;
+    void identifier(Token tok, uint32_t symbol) override;
+    void unary(Token op) override;
+    void short_circuit(Token op) override;
+    void binary(Token op) override;
+    void declaration(ValueType type, Token identifier, uint32_t symbol) override;
+    void assignment(Token identifier, uint32_t symbol) override;
+    void print() override;
+    void block(uint32_t count) override;
+    void while_start() override;
+    void condition() override;
+    void else_start() override;
+    void if_statement(bool has_else) override;
+    void while_statement() override;
 
 private:
-    std::string exec_expr(const std::shared_ptr<Node> &n);
+    static constexpr uint32_t none = UINT32_MAX;
 
-    void emit_condition(const std::shared_ptr<Node> &cond,
-                        const std::string &trueLabel,
-                        const std::string &falseLabel);
+    // Jumps still waiting for their label, chained through `links`.
+    struct JumpList
+    {
+        uint32_t head{none};
+        uint32_t tail{none};
+    };
+    struct Link
+    {
+        uint32_t instr;
+        uint32_t next;
+    };
+    // An operand that has been lowered: a value, a string constant for
+    // cout, or a condition given by the jumps it takes when true and false.
+    struct Lowered
+    {
+        IROperand value;
+        JumpList on_true, on_false;
+        bool is_condition{false};
+    };
+    // An if or while being lowered: the label a loop returns to, and the
+    // jumps to be patched when the statement's next label is placed.
+    struct Pending
+    {
+        IROperand label;
+        JumpList jumps;
+    };
 
-    void exec_assignment(const std::shared_ptr<AssignmentNode> &a);
-    void exec_if(const std::shared_ptr<IfNode> &i);
-    void exec_while(const std::shared_ptr<WhileNode> &w);
-    void exec_print(const std::shared_ptr<PrintNode> &p);
-    void exec_declaration(const std::shared_ptr<DeclarationNode> &d);
-    void exec_block(const std::shared_ptr<BlockNode> &b);
-    void exec_statement(const std::shared_ptr<Node> &n);
+    Lowered pop();
+    IROperand value_of(const Lowered &x);
+    Lowered condition_of(const Lowered &x);
 
-    std::string nextTemp();
-    std::string nextLabel();
-    std::string nextStringSym();
+    uint32_t emit(IROp op, IROperand dst, IROperand a = IROperand(), IROperand b = IROperand());
+    JumpList jump_list(uint32_t instr);
+    JumpList join(JumpList a, JumpList b);
+    void patch(JumpList list, IROperand label);
+    IROperand place_label();
 
 private:
-    std::shared_ptr<Node> root;
+    const Source &src;
+    SymbolTable &symbols;
     InterCodeArray arr;
-    std::unordered_map<std::string, std::string> identifiers;
-    std::unordered_map<std::string, std::string> constants;
-    std::unordered_map<std::string, std::string> tempmap;
-    int tCounter{1};
-    int lCounter{1};
-    int sCounter{1};
+    std::vector<Lowered> values;
+    std::vector<Pending> control;
+    std::vector<Link> links;
 };
@@ -0,0 +1,106 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <string_view>
+#include "tokens.hpp"
+
+// Keyword recognition by a perfect hash on (length, first char, last char).
+// The multiplier is searched at compile time, so adding a keyword to the
+// list below only needs a rebuild; static_assert fires if no seed works.
+
+struct Keyword {
+    std::string_view text;
+    TokenType type;
+};
+
+inline constexpr Keyword keywords[] = {
+    {"if", TokenType::If},
+    {"else", TokenType::Else},
+    {"while", TokenType::While},
+    {"cout", TokenType::Print},
+    {"int", TokenType::IntKw},
+    {"string", TokenType::StringKw},
+};
+
+namespace kw_detail {
+
+constexpr size_t table_size = 32;
+constexpr size_t count = sizeof(keywords) / sizeof(keywords[0]);
+
+constexpr size_t min_len()
+{
+    size_t m = keywords[0].text.size();
+    for (const auto &k : keywords)
+        m = k.text.size() < m ? k.text.size() : m;
+    return m;
+}
+
+constexpr size_t max_len()
+{
+    size_t m = 0;
+    for (const auto &k : keywords)
+        m = k.text.size() > m ? k.text.size() : m;
+    return m;
+}
+
+constexpr size_t shortest = min_len();
+constexpr size_t longest = max_len();
+
+constexpr unsigned hash(size_t len, unsigned char first, unsigned char last, unsigned seed)
+{
+    return (static_cast<unsigned>(len) * seed + first * (seed >> 4) + last) & (table_size - 1);
+}
+
+constexpr unsigned hash(std::string_view s, unsigned seed)
+{
+    return hash(s.size(), static_cast<unsigned char>(s.front()), static_cast<unsigned char>(s.back()), seed);
+}
+
+constexpr bool collision_free(unsigned seed)
+{
+    bool used[table_size] = {};
+    for (const auto &k : keywords)
+    {
+        unsigned h = hash(k.text, seed);
+        if (used[h])
+            return false;
+        used[h] = true;
+    }
+    return true;
+}
+
+constexpr unsigned find_seed()
+{
+    for (unsigned seed = 1; seed < (1u << 12); ++seed)
+        if (collision_free(seed))
+            return seed;
+    return 0;
+}
+
+constexpr unsigned seed = find_seed();
+static_assert(seed != 0, "no perfect hash seed for the keyword set; grow table_size");
+
+constexpr std::array<int8_t, table_size> make_table()
+{
+    std::array<int8_t, table_size> t{};
+    for (auto &slot : t)
+        slot = -1;
+    for (size_t i = 0; i < count; ++i)
+        t[hash(keywords[i].text, seed)] = static_cast<int8_t>(i);
+    return t;
+}
+
+constexpr std::array<int8_t, table_size> table = make_table();
+
+} // namespace kw_detail
+
+// TokenType of an identifier-shaped lexeme: its keyword, or Var.
+constexpr TokenType keyword_type(std::string_view s)
+{
+    if (s.size() < kw_detail::shortest || s.size() > kw_detail::longest)
+        return TokenType::Var;
+    int8_t i = kw_detail::table[kw_detail::hash(s, kw_detail::seed)];
+    if (i < 0 || keywords[i].text != s)
+        return TokenType::Var;
+    return keywords[i].type;
+}
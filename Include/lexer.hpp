@@ -0,0 +1,71 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "tokens.hpp"
+#include "token_stream.hpp"
+
+// Flex scanner from scanner.lx; kept as the reference implementation.
+// It keeps its state in globals, so it is not thread-safe: no two calls,
+// nor tokenize(..., LexerKind::Flex), may run at the same time.
+void scan_string_to_tokens(Source &src, std::vector<Token> &out);
+
+// Which scanner produces the token stream. Scalar, Sse2 and Avx2 are the
+// hand-written Lexer with the given block width for skipping whitespace,
+// comments and identifier runs.
+enum class LexerKind
+{
+    Flex,
+    Scalar,
+    Sse2,
+    Avx2
+};
+
+// Widest hand-written variant the running CPU supports.
+LexerKind best_simd_lexer();
+
+// Hand-written scanner that accepts the same language as scanner.lx.
+// All scanning state lives in the Lexer object, so independent instances
+// can run on different threads at the same time.
+class Lexer
+{
+public:
+    explicit Lexer(Source &src, LexerKind kind = best_simd_lexer());
+    // Starts scanning at byte `offset`, which must be a token boundary.
+    Lexer(Source &src, uint32_t offset, LexerKind kind = best_simd_lexer());
+
+    // Returns the next token; keeps returning End once the input is consumed.
+    Token next();
+
+private:
+    Token make(TokenType type, const char *start, uint32_t sym = Interner::none) const;
+    [[noreturn]] void unknown_char() const;
+
+    Source &src;
+    const char *base;
+    const char *cur;
+    const char *end;
+    LexerKind kind;
+};
+
+// Pulls tokens from a Lexer on demand, so the parser can consume them while
+// they are being scanned instead of after the whole file is tokenized.
+class LexerTokenSource : public TokenSource
+{
+public:
+    explicit LexerTokenSource(Lexer &lexer) : lexer(lexer) {}
+    size_t fill(Token *out, size_t max) override;
+
+private:
+    Lexer &lexer;
+};
+
+std::vector<Token> lex_string_to_tokens(Source &src, LexerKind kind = best_simd_lexer());
+
+// Lexes `src` on up to `jobs` threads (0: one per core) by splitting it into
+// chunks at line starts. Produces the same tokens and throws the same first
+// error as lex_string_to_tokens; falls back to it for small inputs.
+std::vector<Token> lex_parallel(Source &src, unsigned jobs = 0, LexerKind kind = best_simd_lexer());
+
+// Runs the scanner selected by `kind` over `src`. Not thread-safe for
+// LexerKind::Flex (see scan_string_to_tokens).
+std::vector<Token> tokenize(Source &src, LexerKind kind);
@@ -0,0 +1,35 @@
+#pragma once
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// 1-based line and column of a byte offset.
+struct Position
+{
+    int line;
+    int column;
+};
+
+// Offsets at which each line of a text starts, found in one SIMD pass over
+// the text. Tokens only record offsets; line and column are looked up here
+// by binary search when a diagnostic or a dump asks for them.
+class LineTable
+{
+public:
+    explicit LineTable(std::string_view text);
+
+    // Line of the byte at `offset`, i.e. 1 + the newlines before it.
+    // `offset` may be the size of the text.
+    int line(uint32_t offset) const;
+    Position position(uint32_t offset) const;
+
+    size_t lines() const { return starts.size(); }
+    // The text the table was built for.
+    const char *data() const { return text_data; }
+    size_t size() const { return text_size; }
+
+private:
+    std::vector<uint32_t> starts;
+    const char *text_data;
+    size_t text_size;
+};
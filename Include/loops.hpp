@@ -0,0 +1,54 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "cfg.hpp"
+#include "dominators.hpp"
+
+// The natural loops of a ControlFlowGraph and how they nest. An edge from
+// a block to one that dominates it is a back edge; the loop of a header is
+// the header and every block that reaches one of its back edges without
+// going through it. Every while loop of the source is one such loop, headed
+// by the block of the label its condition starts at.
+//
+// Loops are found innermost first: headers are taken in post-order, and the
+// body of each is collected backwards from its back edges. A union-find
+// forest stands each finished inner loop in for its blocks, so the walk
+// steps over it in one go and every block is entered once per loop
+// boundary rather than once per enclosing loop.
+//
+// Only back edges make loops: a cycle entered at two places (which the IR
+// generator never produces) is not a natural loop and is not reported.
+class LoopNest
+{
+public:
+    static constexpr uint32_t none = UINT32_MAX;
+
+    struct Loop
+    {
+        uint32_t header;
+        uint32_t parent; // enclosing loop, or none
+        uint32_t depth;  // 1 for an outermost loop
+        uint32_t blocks; // blocks in the loop, inner loops included
+    };
+
+    LoopNest(const ControlFlowGraph &cfg, const DominatorTree &dom);
+
+    // Loops are numbered innermost first: a loop's parent has a higher id.
+    size_t size() const { return loops.size(); }
+    const Loop &operator[](uint32_t id) const { return loops[id]; }
+    // Innermost loop containing block `b`, or none.
+    uint32_t loop_of(uint32_t b) const { return innermost[b]; }
+    // Loops around block `b`; 0 outside of all loops.
+    uint32_t depth(uint32_t b) const { return innermost[b] == none ? 0 : loops[innermost[b]].depth; }
+    bool contains(uint32_t loop, uint32_t b) const
+    {
+        for (uint32_t l = innermost[b]; l != none; l = loops[l].parent)
+            if (l == loop)
+                return true;
+        return false;
+    }
+
+private:
+    std::vector<Loop> loops;
+    std::vector<uint32_t> innermost;
+};
@@ -1,37 +1,85 @@
 #pragma once
 #include <memory>
 #include <string>
-#include <unordered_map>
+#include <vector>
 
 #include "tokens.hpp"
-#include "ast.hpp"
+#include "token_stream.hpp"
+#include "ast_builder.hpp"
 
+// Lets a parse take over statements of an earlier one (see
+// IncrementalParser). Positions count the tokens the parser has consumed.
+class StatementCache {
+public:
+    virtual ~StatementCache() = default;
+    // Called where a statement may start. Either reports an earlier
+    // statement found at `position` to the builder and returns its length
+    // in tokens, which the parser then skips, or returns 0.
+    virtual uint32_t reuse(size_t position) = 0;
+    // A statement that was parsed, not reused, covered [start, end).
+    virtual void statement(size_t start, size_t end) = 0;
+    // A block with `count` statements spans [start, end): from after its
+    // '{' to its '}', or to the end of input for the program.
+    virtual void block(size_t start, size_t end, uint32_t count) = 0;
+};
+
+// Reports the program to an AstBuilder in post-order. With an Arena it
+// builds the linked AST there; the nodes stay valid until the arena is
+// released, independently of the Parser. Nesting is tracked on explicit
+// stacks instead of the native one, so its depth is bounded by memory.
 class Parser {
 public:
-    explicit Parser(TokenArray tokens);
-    std::shared_ptr<Node> get_root();
+    Parser(TokenArray tokens, const Source &src, Arena &arena, SymbolTable &symbols);
+    // Pulls tokens from `tokens` as parsing proceeds; nothing is buffered
+    // beyond TokenStream's lookahead ring.
+    Parser(TokenSource &tokens, const Source &src, Arena &arena, SymbolTable &symbols);
+    Parser(TokenSource &tokens, const Source &src, AstBuilder &out, SymbolTable &symbols,
+           StatementCache *cache = nullptr);
+    // Parses the whole program; its block is the last thing reported.
+    void parse();
+    // Parses into the Arena given to the constructor.
+    Node *get_root();
 
 private:
-    void read_token_pass(const std::string &expected, const std::string &message);
+    void read_token_pass(TokenType expected, const char *message);
 
-    std::shared_ptr<Node> factor();
-    std::shared_ptr<Node> term();
-    std::shared_ptr<Node> expr();
-    std::shared_ptr<Node> comparison();
-    std::shared_ptr<Node> logical_and();
-    std::shared_ptr<Node> logical_or();
-    std::shared_ptr<Node> unary();
+    void factor();
+    void expression(int min_bp);
 
 
-    std::shared_ptr<Node> if_statement();
-    std::shared_ptr<Node> while_statement();
-    std::shared_ptr<Node> declarations();
-    std::shared_ptr<Node> assignment();
-    std::shared_ptr<Node> printing();
-    std::shared_ptr<Node> statements();
-    std::unordered_map<std::string, ValueType> symbol_table;
+    void if_statement();
+    void while_statement();
+    void declarations();
+    void assignment();
+    void printing();
+    bool close_block();
 
 
 private:
-    TokenArray tokens;
+    // A construct whose operand is being parsed: an operator waiting for
+    // its right operand, '!' for its operand, or a parenthesis for its
+    // expression. `min_bp` is that of the expression it continues.
+    struct PendingOp {
+        enum Kind : uint8_t { Binary, Not, Paren } kind;
+        int min_bp;
+        Token op;
+    };
+    // A block being parsed and the number of statements it has so far;
+    // `start` is where its if or while began, `body` its first token.
+    struct OpenBlock {
+        enum Kind : uint8_t { Program, Then, Else, Body } kind;
+        uint32_t count;
+        size_t start;
+        size_t body;
+    };
+
+    const Source &src;
+    std::unique_ptr<TreeBuilder> tree;
+    AstBuilder &out;
+    SymbolTable &symbols;
+    StatementCache *cache{nullptr};
+    std::vector<PendingOp> ops;
+    std::vector<OpenBlock> blocks;
+    std::unique_ptr<TokenSource> owned;
+    TokenStream tokens;
 };
@@ -0,0 +1,111 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "flow_analysis.hpp"
+#include "ir.hpp"
+#include "symbol_table.hpp"
+
+// A phi function at the top of a block: `dst` takes its k-th argument when
+// control comes from the block's k-th predecessor.
+struct Phi
+{
+    IROperand dst;     // a temporary
+    uint32_t variable; // the variable whose values it joins
+    uint32_t block;
+    uint32_t args;  // first argument in the SsaForm's array of them
+    uint32_t count; // arguments, one per predecessor
+};
+
+// The program in static single assignment form, and the way back out of it.
+//
+// Temporaries are assigned once, where they are computed, in the code the
+// IR generator produces, so only variables are renamed: every assignment
+// to one defines a new temporary instead, and every use reads the
+// temporary that reaches it. Where
+// different ones meet, a phi joins them. A variable read before anything
+// is assigned to it reads itself: its slot keeps the value it starts with,
+// since nothing stores to it any more.
+//
+// Phis are kept beside the code rather than in it, so that the instruction
+// array stays what CodeGenerator and the IR dump understand, and go by
+// block number: a pass working on the SSA form must leave the blocks as
+// they are. They are placed on the iterated dominance frontier of the
+// blocks assigning each variable (Cytron et al.) and pruned to those whose
+// variable is live into the block. Liveness is not computed per variable
+// for that, which over all variables and blocks would cost their product:
+// once renaming has given each phi its arguments, a phi is kept when a
+// real use reads it directly or through other phis kept, which is the
+// same thing.
+//
+// destruct() leaves SSA form (see there). Its copies assign temporaries
+// more than once, so its result cannot be taken into SSA form again.
+class SsaForm
+{
+public:
+    // Rewrites `ir` in place; new temporaries are added to `symbols`. If the
+    // first block is the target of a jump, a label is put before it first,
+    // so that the entry has no predecessors.
+    SsaForm(InterCodeArray &ir, SymbolTable &symbols, FlowAnalysis &flow);
+
+    // Phis, grouped by block in code order.
+    uint32_t size() const { return static_cast<uint32_t>(phis.size()); }
+    const Phi &operator[](uint32_t i) const { return phis[i]; }
+    // Phis [first(b), first(b + 1)) are those of block `b`.
+    uint32_t first(uint32_t b) const { return phi_at[b]; }
+    IROperand arg(const Phi &phi, uint32_t k) const { return args[phi.args + k]; }
+    // For passes that rewrite uses.
+    IROperand &arg(const Phi &phi, uint32_t k) { return args[phi.args + k]; }
+
+    // Checks that the code and the phis are in SSA form: no variable is
+    // assigned, every temporary is defined once, and every use is dominated
+    // by its definition (the use of a phi argument being at the end of the
+    // predecessor it comes from). Phis need one argument per predecessor.
+    // Blocks the entry does not reach are not looked at. Throws
+    // std::runtime_error on the first violation.
+    void verify(FlowAnalysis &flow) const;
+
+    // Turns each phi into copies on the edges into its block, leaving
+    // conventional IR and no phis. The copies for one edge happen at once
+    // in the semantics of phis, so they are ordered such that none
+    // overwrites a value another still reads, a cycle of them going
+    // through a spare temporary (Boissinot et al., "Revisiting Out-of-SSA
+    // Translation"). An edge from a conditional jump into a block with
+    // phis is split with a block of its own for the copies: one that falls
+    // through goes just after the jump, one that jumps goes at the end of
+    // the code.
+    void destruct(FlowAnalysis &flow);
+
+    struct Stats
+    {
+        size_t definitions{0}; // assignments to variables renamed
+        size_t placed{0};      // phis on the dominance frontiers
+        size_t copies{0};      // copies out of SSA
+        size_t split{0};       // edges split for them
+        size_t cycles{0};      // cycles of copies broken
+    };
+    const Stats &stats() const { return counts; }
+
+private:
+    struct Move
+    {
+        IROperand dst, src;
+    };
+    void place(FlowAnalysis &flow);
+    void rename(FlowAnalysis &flow);
+    void prune(uint32_t first_phi_temp);
+    void copies_into(uint32_t block, uint32_t k, std::vector<IRInstr> &out);
+
+    InterCodeArray &ir;
+    SymbolTable &symbols;
+    std::vector<Phi> phis;
+    std::vector<uint32_t> phi_at;
+    std::vector<IROperand> args;
+    Stats counts;
+
+    // Scratch of destruct(): where each temporary's value is found, and the
+    // source of the copy into each.
+    std::vector<IROperand> loc, pred;
+    std::vector<Move> moves;
+    std::vector<IROperand> ready, todo;
+    IROperand spare;
+};
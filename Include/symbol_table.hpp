@@ -0,0 +1,75 @@
+#pragma once
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "interner.hpp"
+
+enum class ValueType {
+    Int,
+    String
+};
+
+// The storage locations of one compilation, each class numbered densely
+// from 0: variables as the parser meets them, temporaries and string
+// constants as the IR generator creates them. Parser, IR and code generator
+// pass only these ids around; a name is built when text is emitted.
+// Variable names and string contents are Interner ids of the Source.
+class SymbolTable
+{
+public:
+    static constexpr uint32_t none = UINT32_MAX;
+    // Ids go into the 29 bits an IROperand has for them (see ir.hpp).
+    static constexpr uint32_t max_ids = 1u << 29;
+
+    // The next id of a class that has `count` of them already; throws if
+    // it would not fit an operand.
+    static uint32_t next_id(size_t count, const char *what)
+    {
+        if (count >= max_ids)
+            throw std::runtime_error(std::string("Too many ") + what + ": IR operand ids are 29-bit");
+        return static_cast<uint32_t>(count);
+    }
+
+    struct Symbol
+    {
+        ValueType type;
+        bool declared; // a declaration has been seen
+        uint32_t name;
+    };
+
+    explicit SymbolTable(const Interner &names) : names(names) {}
+
+    // Variable spelled `name`, created undeclared on first use.
+    uint32_t variable(uint32_t name);
+    // Variable spelled `name`, or none if it has never been used.
+    uint32_t find_variable(uint32_t name) const
+    {
+        return name < by_name.size() ? by_name[name] : none;
+    }
+    uint32_t declare(uint32_t name, ValueType type);
+    uint32_t add_temp()
+    {
+        uint32_t id = next_id(temp_count, "temporaries");
+        ++temp_count;
+        return id;
+    }
+    uint32_t add_string(uint32_t text);
+
+    // Variables.
+    const Symbol &operator[](uint32_t id) const { return entries[id]; }
+    size_t size() const { return entries.size(); }
+    std::string_view name(uint32_t id) const { return names.name(entries[id].name); }
+
+    uint32_t temps() const { return temp_count; }
+    uint32_t strings() const { return static_cast<uint32_t>(contents.size()); }
+    std::string_view string_text(uint32_t id) const { return names.name(contents[id]); }
+
+private:
+    const Interner &names;
+    std::vector<Symbol> entries;
+    std::vector<uint32_t> by_name; // Interner id -> variable id
+    uint32_t temp_count{0};
+    std::vector<uint32_t> contents; // string id -> Interner id
+};
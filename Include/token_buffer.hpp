@@ -0,0 +1,71 @@
+#pragma once
+#include <cstdint>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "tokens.hpp"
+#include "lexer.hpp"
+
+// A text change: `removed` bytes at `offset` were replaced by `inserted`.
+struct TextEdit
+{
+    uint32_t offset;
+    uint32_t removed;
+    std::string_view inserted;
+};
+
+// Token stream of one source that is kept up to date across edits.
+//
+// Tokens live in a gap buffer. Tokens before the gap store absolute offsets;
+// tokens after it store them relative to the end of the text
+// (text_size - offset), which an edit in front of them does not change. An edit therefore only moves the gap to the damaged range,
+// re-lexes that range and splices the result in: its cost is proportional to
+// the damaged range and the distance from the previous edit, not to the file.
+class TokenBuffer
+{
+public:
+    // `tokens` must be the full stream of the current text, ending with End.
+    explicit TokenBuffer(std::vector<Token> tokens);
+
+    size_t size() const { return buf.size() - gap_len(); }
+    Token operator[](size_t i) const;
+
+    // Re-lexes after `edit`; src.text must already hold the edited text.
+    // Scanning restarts at the last token boundary before the edit and stops
+    // as soon as a new token starts where an old token past the edit starts
+    // (after shifting), since from there on the text and the tokens agree.
+    // Returns the index range [first, last) of the tokens that were
+    // re-scanned. On a lexical error the buffer is left unchanged.
+    std::pair<size_t, size_t> apply(Source &src, const TextEdit &edit,
+                                    LexerKind kind = best_simd_lexer());
+
+    std::vector<Token> to_vector() const;
+
+private:
+    static constexpr size_t initial_gap = 1024;
+
+    size_t gap_len() const { return gap_end - gap_begin; }
+    void move_gap(size_t pos);
+    void replace(size_t first, size_t last, const std::vector<Token> &fresh);
+
+    std::vector<Token> buf;
+    size_t gap_begin{0};
+    size_t gap_end{0};
+    uint32_t text_size{0};
+};
+
+// Feeds the tokens [first, last) of a TokenBuffer to the parser, followed by
+// End, so that a parse of the range cannot run past it.
+class TokenBufferSource : public TokenSource
+{
+public:
+    TokenBufferSource(const TokenBuffer &tokens, size_t first, size_t last)
+        : tokens(tokens), next(first), last(last) {}
+    size_t fill(Token *out, size_t max) override;
+    void skip(size_t n) override { next += n; }
+
+private:
+    const TokenBuffer &tokens;
+    size_t next;
+    size_t last;
+};
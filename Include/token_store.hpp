@@ -0,0 +1,66 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "tokens.hpp"
+#include "token_stream.hpp"
+
+// Columnar token storage. Per token only a 1-byte kind and a 4-byte offset
+// are kept; identifiers and literals additionally own one entry in a dense
+// payload column holding their symbol id. Lengths follow from the kind and
+// the symbol, and lines come from the source's line table when asked for,
+// so scanning kinds touches 1 byte per token instead of a whole Token.
+class TokenStore
+{
+public:
+    TokenStore() = default;
+    explicit TokenStore(const std::vector<Token> &tokens);
+    TokenStore(TokenStore &&) = default;
+    TokenStore &operator=(TokenStore &&) = default;
+
+    void push_back(const Token &t);
+
+    size_t size() const { return kinds.size(); }
+    TokenType kind(size_t i) const { return static_cast<TokenType>(kinds[i]); }
+    uint32_t offset(size_t i) const { return offsets[i]; }
+    // Symbol id of an identifier or literal; Interner::none for other kinds.
+    uint32_t sym(size_t i) const;
+    uint32_t length(size_t i, const Source &src) const;
+    int line(size_t i, const Source &src) const;
+
+    Token get(size_t i, const Source &src) const;
+
+    // Heap bytes held by the columns, for comparing against sizeof(Token).
+    size_t bytes() const;
+
+    static bool has_payload(TokenType t)
+    {
+        return t == TokenType::Var || t == TokenType::String || t == TokenType::IntLit;
+    }
+
+private:
+    friend class TokenStoreSource;
+    static constexpr size_t checkpoint = 64;
+
+    size_t payload_index(size_t i) const;
+
+    std::vector<uint8_t> kinds;
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> payloads;
+    // Payload index of every `checkpoint`-th token.
+    std::vector<uint32_t> payload_base;
+};
+
+// Feeds a TokenStore to the parser, rebuilding Tokens in batches while
+// walking the columns front to back.
+class TokenStoreSource : public TokenSource
+{
+public:
+    TokenStoreSource(const TokenStore &store, const Source &src) : store(store), src(src) {}
+    size_t fill(Token *out, size_t max) override;
+
+private:
+    const TokenStore &store;
+    const Source &src;
+    size_t next{0};
+    size_t payload{0};
+};
@@ -0,0 +1,83 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include "tokens.hpp"
+
+// Producer side of a token stream. fill() writes up to `max` tokens and
+// returns how many it wrote; once the input is exhausted it keeps producing
+// End tokens, so it never returns 0 for max > 0.
+class TokenSource
+{
+public:
+    virtual ~TokenSource() = default;
+    virtual size_t fill(Token *out, size_t max) = 0;
+    // Drops the next n tokens, none of them End. Sources that can seek
+    // override this; the default produces the tokens and discards them.
+    virtual void skip(size_t n);
+};
+
+// Serves tokens that were already materialized (e.g. by the flex scanner).
+class ArrayTokenSource : public TokenSource
+{
+public:
+    explicit ArrayTokenSource(TokenArray tokens);
+    size_t fill(Token *out, size_t max) override;
+
+private:
+    TokenArray arr;
+};
+
+// Consumer side: a small ring of lookahead tokens refilled in batches from a
+// TokenSource, so only `capacity` tokens are alive at any time no matter how
+// large the input is. A reference returned by peek()/current() stays valid
+// until the next call to peek()/current().
+class TokenStream
+{
+public:
+    static constexpr size_t capacity = 64;
+
+    explicit TokenStream(TokenSource &source) : source(source) {}
+
+    // k-th token ahead of the cursor, k < capacity.
+    const Token &peek(size_t k = 0)
+    {
+        while (count <= k)
+            refill();
+        return buf[(head + k) & (capacity - 1)];
+    }
+    const Token &current() { return peek(0); }
+
+    void next()
+    {
+        peek(0);
+        if (buf[head].type == TokenType::End)
+            return;
+        head = (head + 1) & (capacity - 1);
+        --count;
+        ++consumed;
+    }
+
+    // Consumes n tokens, none of them End, without reading them where the
+    // source can seek.
+    void skip(size_t n)
+    {
+        size_t buffered = n < count ? n : count;
+        head = (head + buffered) & (capacity - 1);
+        count -= buffered;
+        consumed += n;
+        if (n > buffered)
+            source.skip(n - buffered);
+    }
+
+    // Number of tokens consumed so far.
+    size_t position() const { return consumed; }
+
+private:
+    void refill();
+
+    TokenSource &source;
+    Token buf[capacity];
+    size_t head{0};
+    size_t count{0};
+    size_t consumed{0};
+};
@@ -1,7 +1,12 @@
 #pragma once
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <stdexcept>
+#include "interner.hpp"
+#include "line_table.hpp"
 
 enum class TokenType {
     If,
@@ -42,10 +47,103 @@ enum class TokenType {
     End
 };
 
+// A token is a view of the source: its bytes are text[offset, offset + length).
+// Identifiers, string and integer literals also carry the interned id of
+// their name / contents (without quotes) in `sym`; for an integer literal
+// Source::int_value() gives the value the lexer parsed. Line numbers are not
+// stored; Source::line() derives them from the offset.
 struct Token {
     TokenType type;
-    std::string value;
-    int line;
+    uint32_t offset;
+    uint32_t length;
+    uint32_t sym;
+};
+
+// Spelling of a token whose text is fixed by its type; null for Var, String
+// and IntLit.
+inline const char *fixed_spelling(TokenType type) {
+    static const char *const text[] = {
+        "if", "else", "while", "int", "string", "cout", "<<",
+        nullptr, nullptr, nullptr,
+        "=", "==", "!=", "<", "<=", ">", ">=", "&&", "||", "!",
+        ";", ",", "(", ")", "{", "}",
+        "+", "-", "/", "*",
+        "END",
+    };
+    static_assert(sizeof(text) / sizeof(text[0]) == static_cast<size_t>(TokenType::End) + 1,
+                  "fixed_spelling: one entry per TokenType");
+    return text[static_cast<size_t>(type)];
+}
+
+// Program text plus the symbols interned from it. Tokens only hold offsets
+// and ids, so the Source has to outlive every token and node built from it.
+// After an edit, `text` may be pointed at the new buffer: symbol ids survive
+// because the Interner keeps its own copy of every spelling. Call
+// text_changed() after such an edit so that line numbers are recomputed.
+struct Source {
+    std::string_view text;
+    Interner symbols;
+    // text is writable and followed by two NUL bytes (see InputBuffer), so
+    // the flex scanner may run over it in place instead of copying it.
+    bool padded{false};
+
+    explicit Source(std::string_view t, bool padded = false) : text(t), padded(padded) {
+        if (t.size() > UINT32_MAX)
+            throw std::runtime_error("Source larger than 4 GiB: token offsets are 32-bit");
+    }
+
+    std::string_view spelling(const Token &t) const { return text.substr(t.offset, t.length); }
+    std::string_view name(const Token &t) const { return symbols.name(t.sym); }
+
+    // Interns the integer literal text[offset, offset + length) and parses
+    // its value, once per distinct spelling. Throws if it exceeds int64_t.
+    uint32_t intern_int(uint32_t offset, uint32_t length) {
+        uint32_t id = symbols.intern(text.substr(offset, length));
+        if (id >= int_values.size())
+            int_values.resize(symbols.size(), -1);
+        if (int_values[id] < 0) {
+            int64_t v = 0;
+            for (uint32_t i = 0; i < length; ++i) {
+                int d = text[offset + i] - '0';
+                if (v > (INT64_MAX - d) / 10)
+                    throw std::runtime_error("Integer literal out of range at line " +
+                                             std::to_string(lines().line(offset)));
+                v = v * 10 + d;
+            }
+            int_values[id] = v;
+        }
+        return id;
+    }
+    int64_t int_value(const Token &t) const { return int_values[t.sym]; }
+
+    // Line table of `text`, built on first use.
+    const LineTable &lines() const {
+        if (!line_table || line_table->data() != text.data() || line_table->size() != text.size())
+            line_table = std::make_unique<LineTable>(text);
+        return *line_table;
+    }
+    void text_changed() { line_table.reset(); }
+    // Line a token ends on, as the scanner used to count it.
+    int line(const Token &t) const { return lines().line(t.offset + t.length); }
+
+    // Token text as it is printed: variables get their "V" prefix here,
+    // string literals are shown without quotes. Nothing here reads the
+    // offset, so it also holds for tokens of nodes that an incremental
+    // reparse kept while the text in front of them changed.
+    std::string value(const Token &t) const {
+        switch (t.type) {
+            case TokenType::Var: return "V" + std::string(name(t));
+            case TokenType::String:
+            case TokenType::IntLit: return std::string(name(t));
+            default: return fixed_spelling(t.type);
+        }
+    }
+
+private:
+    mutable std::unique_ptr<LineTable> line_table;
+    // Value of each integer-literal symbol; -1 for other symbols (literals
+    // have no sign, so no literal is negative).
+    std::vector<int64_t> int_values;
 };
 
 struct TokenArray {
@@ -55,6 +153,9 @@ struct TokenArray {
     TokenArray() = default;
     explicit TokenArray(std::vector<Token> t)
         : tokens(std::move(t)), pos(0) {}
+    // Move-only: the tokens of a whole program are handed on, never copied.
+    TokenArray(TokenArray &&) = default;
+    TokenArray &operator=(TokenArray &&) = default;
 
     const Token& current() const {
         if (tokens.empty())
@@ -71,8 +172,8 @@ struct TokenArray {
 
     void appendEndIfMissing() {
         if (tokens.empty() || tokens.back().type != TokenType::End) {
-            int line = tokens.empty() ? 1 : tokens.back().line;
-            tokens.push_back(Token{TokenType::End, "END", line});
+            uint32_t offset = tokens.empty() ? 0 : tokens.back().offset + tokens.back().length;
+            tokens.push_back(Token{TokenType::End, offset, 0, Interner::none});
         }
     }
 };
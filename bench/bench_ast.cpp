@@ -0,0 +1,168 @@
+// AST allocation: the arena the parser builds into against one make_shared
+// allocation per node, as the tree used before. Both trees have the same
+// shape and node sizes. For a large flat program and a deeply nested one it
+// reports the time to parse into the arena and to release it, and the time
+// to build the same tree node by node in each scheme and to tear it down.
+//
+//   ./bench_ast [megabytes=64] [depth=2000]
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "corpus.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
+#include "shared_ast.hpp"
+#include "timing.hpp"
+#include "token_store.hpp"
+
+// Copy of `n` in a second arena, allocated in the same order as the copy
+// with shared ownership.
+static Node *clone_arena(const Node *n, Arena &arena, std::vector<Node *> &pending)
+{
+    if (!n)
+        return nullptr;
+    switch (n->kind)
+    {
+    case NodeKind::Number:
+    {
+        auto x = static_cast<const NumberNode *>(n);
+        return arena.make<NumberNode>(x->tok, x->value);
+    }
+    case NodeKind::Identifier:
+    {
+        auto x = static_cast<const IdentifierNode *>(n);
+        return arena.make<IdentifierNode>(x->tok, x->symbol);
+    }
+    case NodeKind::BinOp:
+    {
+        auto x = static_cast<const BinOpNode *>(n);
+        auto c = arena.make<BinOpNode>();
+        c->op_tok = x->op_tok;
+        c->left = clone_arena(x->left, arena, pending);
+        c->right = clone_arena(x->right, arena, pending);
+        return c;
+    }
+    case NodeKind::Assignment:
+    {
+        auto x = static_cast<const AssignmentNode *>(n);
+        auto c = arena.make<AssignmentNode>();
+        c->identifier = x->identifier;
+        c->symbol = x->symbol;
+        c->expression = clone_arena(x->expression, arena, pending);
+        return c;
+    }
+    case NodeKind::Block:
+    {
+        size_t first = pending.size();
+        for (const Node *st : static_cast<const BlockNode *>(n)->statements)
+            pending.push_back(clone_arena(st, arena, pending));
+        auto c = arena.make<BlockNode>();
+        c->statements.count = static_cast<uint32_t>(pending.size() - first);
+        c->statements.items = arena.copy(pending.data() + first, c->statements.count);
+        pending.resize(first);
+        return c;
+    }
+    case NodeKind::If:
+    {
+        auto x = static_cast<const IfNode *>(n);
+        auto c = arena.make<IfNode>();
+        c->condition = clone_arena(x->condition, arena, pending);
+        c->then_branch = clone_arena(x->then_branch, arena, pending);
+        c->else_branch = clone_arena(x->else_branch, arena, pending);
+        return c;
+    }
+    case NodeKind::While:
+    {
+        auto x = static_cast<const WhileNode *>(n);
+        auto c = arena.make<WhileNode>();
+        c->condition = clone_arena(x->condition, arena, pending);
+        c->body = clone_arena(x->body, arena, pending);
+        return c;
+    }
+    case NodeKind::Print:
+    {
+        auto c = arena.make<PrintNode>();
+        c->value = clone_arena(static_cast<const PrintNode *>(n)->value, arena, pending);
+        return c;
+    }
+    case NodeKind::Declaration:
+    {
+        auto x = static_cast<const DeclarationNode *>(n);
+        auto c = arena.make<DeclarationNode>();
+        c->var_type = x->var_type;
+        c->identifier = x->identifier;
+        c->symbol = x->symbol;
+        return c;
+    }
+    default:
+        return nullptr;
+    }
+}
+
+static void bench(const char *name, const std::string &text)
+{
+    Source source(text);
+    std::vector<Token> tokens = tokenize(source, best_simd_lexer());
+    TokenStore store(tokens);
+    std::vector<Token>().swap(tokens);
+
+    Arena ast;
+    SymbolTable symbols(source.symbols);
+    Node *root = nullptr;
+    double parse = ms([&] {
+        TokenStoreSource feed(store, source);
+        Parser parser(feed, source, ast, symbols);
+        root = parser.get_root();
+    });
+
+    // Best of three alternating runs, so that neither scheme always gets
+    // the memory the other just returned to the allocator.
+    size_t nodes = 0;
+    double shared_build = 1e300, shared_free = 1e300, arena_build = 1e300, arena_free = 1e300;
+    std::vector<Node *> pending;
+    for (int rep = 0; rep < 3; ++rep)
+    {
+        nodes = 0;
+        std::shared_ptr<shared_ast::Node> shared_root;
+        shared_build = std::min(shared_build, ms([&] { shared_root = shared_ast::clone(root, nodes); }));
+        shared_free = std::min(shared_free, ms([&] { shared_root.reset(); }));
+
+        // Offsets the copy from the tree it reads: with block-for-block
+        // identical layouts, each load and store would hit the same cache set.
+        Arena copy;
+        copy.allocate(1088, 8);
+        arena_build = std::min(arena_build, ms([&] { clone_arena(root, copy, pending); }));
+        arena_free = std::min(arena_free, ms([&] { copy.release(); }));
+    }
+    size_t bytes = ast.bytes();
+    double parse_free = ms([&] { ast.release(); });
+
+    std::printf("%s: %zu MB, %zu nodes, %.1f bytes/node in the arena\n", name, text.size() >> 20, nodes,
+                double(bytes) / nodes);
+    std::printf("  parse into arena      %9.2f ms   release %8.2f ms\n", parse, parse_free);
+    std::printf("  build, make_shared    %9.2f ms   free    %8.2f ms  (%6.1f ns/node)\n", shared_build,
+                shared_free, (shared_build + shared_free) * 1e6 / nodes);
+    std::printf("  build, arena          %9.2f ms   free    %8.2f ms  (%6.1f ns/node)\n", arena_build,
+                arena_free, (arena_build + arena_free) * 1e6 / nodes);
+    std::fflush(stdout);
+}
+
+int main(int argc, char **argv)
+{
+    size_t mb = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 64;
+    int depth = argc > 2 ? std::atoi(argv[2]) : 2000;
+
+    std::string flat;
+    CorpusGenerator(12345).generate(flat, mb << 20);
+    bench("program", flat);
+    flat = std::string();
+
+    std::string deep;
+    CorpusGenerator(12345).generate_nested(deep, mb << 20, depth);
+    bench("nested", deep);
+    return 0;
+}
@@ -0,0 +1,184 @@
+// Control-flow analyses of the IR: building the CFG, dominators,
+// post-dominators and the loop nest, on generated programs of doubling
+// size up to the given number of blocks, and on towers of nested if/while
+// blocks. Reports the time per block of each, which stays flat as the
+// programs grow if they scale linearly.
+//
+// On a small program it also checks the dominator trees against the
+// definition, computed with sets, checks that every while loop of the
+// source is found as a loop, and that FlowAnalysis computes its results
+// once and again after a change.
+//
+//   ./bench_cfg [blocks=1000000] [depth=10000]
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "corpus.hpp"
+#include "flow_analysis.hpp"
+#include "program.hpp"
+#include "timing.hpp"
+
+// Dominator sets by the definition: the root's is itself, every other
+// reachable block's is itself and what all its reachable predecessors
+// share. Iterated with bit sets until nothing changes.
+static std::vector<std::vector<uint64_t>> dominator_sets(const ControlFlowGraph &cfg, bool post)
+{
+    const uint32_t n = cfg.size(), words = (n + 63) / 64;
+    const uint32_t root = post ? cfg.exit() : cfg.entry();
+    auto preds = [&](uint32_t b) { return post ? cfg.successors(b) : cfg.predecessors(b); };
+    auto succs = [&](uint32_t b) { return post ? cfg.predecessors(b) : cfg.successors(b); };
+
+    std::vector<uint8_t> reached(n, 0);
+    std::vector<uint32_t> work{root};
+    reached[root] = 1;
+    while (!work.empty())
+    {
+        uint32_t b = work.back();
+        work.pop_back();
+        for (uint32_t s : succs(b))
+            if (!reached[s])
+                reached[s] = 1, work.push_back(s);
+    }
+
+    std::vector<std::vector<uint64_t>> dom(n, std::vector<uint64_t>(words, ~uint64_t(0)));
+    std::fill(dom[root].begin(), dom[root].end(), 0);
+    dom[root][root / 64] |= uint64_t(1) << (root % 64);
+    for (bool changed = true; changed;)
+    {
+        changed = false;
+        for (uint32_t b = 0; b < n; ++b)
+        {
+            if (b == root || !reached[b])
+                continue;
+            std::vector<uint64_t> set(words, ~uint64_t(0));
+            for (uint32_t p : preds(b))
+                if (reached[p])
+                    for (uint32_t w = 0; w < words; ++w)
+                        set[w] &= dom[p][w];
+            set[b / 64] |= uint64_t(1) << (b % 64);
+            if (set != dom[b])
+                dom[b] = std::move(set), changed = true;
+        }
+    }
+    for (uint32_t b = 0; b < n; ++b)
+        if (!reached[b])
+            std::fill(dom[b].begin(), dom[b].end(), 0);
+    return dom;
+}
+
+static bool matches_definition(const ControlFlowGraph &cfg, const DominatorTree &tree, bool post)
+{
+    auto sets = dominator_sets(cfg, post);
+    for (uint32_t b = 0; b < cfg.size(); ++b)
+        for (uint32_t a = 0; a < cfg.size(); ++a)
+            if (tree.dominates(a, b) != bool(sets[b][a / 64] >> (a % 64) & 1))
+                return false;
+    return true;
+}
+
+// Every loop header starts with a label, and there is one loop per while.
+static bool loops_are_whiles(const Program &p, const ControlFlowGraph &cfg, const LoopNest &loops)
+{
+    for (uint32_t l = 0; l < loops.size(); ++l)
+    {
+        uint32_t h = loops[l].header;
+        if (cfg.begin(h) == cfg.end(h) || p.ir.code[cfg.begin(h)].op != IROp::Label)
+            return false;
+    }
+    return loops.size() == p.whiles;
+}
+
+static void check(size_t bytes)
+{
+    std::string text;
+    CorpusGenerator(7).generate(text, bytes);
+    Program p(std::move(text));
+    FlowAnalysis flow(p.ir);
+    const ControlFlowGraph &cfg = flow.cfg();
+    bool dom_ok = matches_definition(cfg, flow.dominators(), false);
+    bool post_ok = matches_definition(cfg, flow.post_dominators(), true);
+    bool loops_ok = loops_are_whiles(p, cfg, flow.loops());
+
+    flow.loops();
+    flow.post_dominators();
+    bool cached = flow.stats().cfg == 1 && flow.stats().dominators == 1 && flow.stats().loops == 1;
+    const uint32_t blocks = cfg.size();
+    const size_t loops = flow.loops().size();
+    p.ir.code.push_back(IRInstr{IROp::PrintInt, IROperand(), p.ir.immediate(1), IROperand()});
+    p.ir.changed();
+    flow.loops();
+    bool recomputed = flow.stats().cfg == 2 && flow.stats().loops == 2;
+
+    std::printf("check on %u blocks, %zu loops: dominators %s, post-dominators %s, loops %s, cached %s, "
+                "recomputed after a change %s\n",
+                blocks, loops, dom_ok ? "ok" : "WRONG", post_ok ? "ok" : "WRONG",
+                loops_ok ? "ok" : "WRONG", cached ? "yes" : "NO", recomputed ? "yes" : "NO");
+}
+
+static void row(const char *name, const Program &p)
+{
+    double t_cfg = 1e300, t_dom = 1e300, t_post = 1e300, t_loops = 1e300;
+    size_t blocks = 0, edges = 0, loops = 0, depth = 0;
+    uint32_t rounds = 0, post_rounds = 0;
+    for (int rep = 0; rep < 3; ++rep)
+    {
+        std::unique_ptr<ControlFlowGraph> cfg;
+        std::unique_ptr<DominatorTree> dom, post;
+        std::unique_ptr<LoopNest> nest;
+        t_cfg = std::min(t_cfg, ms([&] { cfg = std::make_unique<ControlFlowGraph>(p.ir); }));
+        t_dom = std::min(t_dom, ms([&] {
+            dom = std::make_unique<DominatorTree>(*cfg, DominatorTree::Direction::Forward);
+        }));
+        t_post = std::min(t_post, ms([&] {
+            post = std::make_unique<DominatorTree>(*cfg, DominatorTree::Direction::Reverse);
+        }));
+        t_loops = std::min(t_loops, ms([&] { nest = std::make_unique<LoopNest>(*cfg, *dom); }));
+
+        blocks = cfg->size();
+        edges = cfg->edges();
+        loops = nest->size();
+        depth = 0;
+        for (uint32_t l = 0; l < nest->size(); ++l)
+            depth = std::max<size_t>(depth, (*nest)[l].depth);
+        rounds = dom->rounds();
+        post_rounds = post->rounds();
+    }
+    auto per = [&](double t) { return t * 1e6 / blocks; };
+    std::printf("%-14s %9zu %9zu %8zu %5zu %8.1f %8.1f %8.1f %8.1f   %u/%u\n", name, blocks, edges, loops, depth,
+                per(t_cfg), per(t_dom), per(t_post), per(t_loops), rounds, post_rounds);
+    std::fflush(stdout);
+}
+
+int main(int argc, char **argv)
+{
+    size_t target = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    int depth = argc > 2 ? std::atoi(argv[2]) : 10000;
+
+    check(64 << 10);
+
+    std::printf("%-14s %9s %9s %8s %5s %8s %8s %8s %8s   %s\n", "program", "blocks", "edges", "loops", "depth",
+                "cfg", "dom", "postdom", "loops", "rounds");
+    std::printf("%-14s %9s %9s %8s %5s %8s %8s %8s %8s\n", "", "", "", "", "", "ns/block", "ns/block",
+                "ns/block", "ns/block");
+    for (size_t mb = 1;; mb *= 2)
+    {
+        std::string text;
+        CorpusGenerator(12345).generate(text, mb << 20);
+        Program p(std::move(text));
+        std::string name = std::to_string(mb) + " MB";
+        row(name.c_str(), p);
+        if (ControlFlowGraph(p.ir).size() >= target)
+            break;
+    }
+    std::string text;
+    CorpusGenerator(12345).generate_nested(text, 4 << 20, depth);
+    Program nested(std::move(text));
+    std::string name = "nested " + std::to_string(depth);
+    row(name.c_str(), nested);
+    return 0;
+}
@@ -0,0 +1,190 @@
+// The compact IR, one array of 16-byte instructions with a side table of
+// immediates, against the layout it replaced: a shared_ptr to a polymorphic
+// instruction each, with operators and labels as strings. On a generated
+// program it reports the memory per instruction of both, the time to store
+// the instructions of the program in each, and the time of a walk that
+// reads them the way the code generator does. It also times IR generation
+// and code generation on the compact IR.
+//
+//   ./bench_compact_ir [megabytes=16]
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "codegen.hpp"
+#include "corpus.hpp"
+#include "ir.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
+#include "shared_ir.hpp"
+#include "timing.hpp"
+#include "token_store.hpp"
+
+namespace si = shared_ir;
+
+static size_t allocations = 0, allocated = 0;
+
+void *operator new(size_t size)
+{
+    ++allocations;
+    allocated += size;
+    if (void *p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+
+// Heap bytes and allocations requested while `body` runs.
+template <class F>
+static std::pair<size_t, size_t> heap(F body)
+{
+    size_t bytes = allocated, count = allocations;
+    body();
+    return {allocated - bytes, allocations - count};
+}
+
+static InterCodeArray copy_compact(const InterCodeArray &arr)
+{
+    InterCodeArray out;
+    out.code = arr.code;
+    out.immediates = arr.immediates;
+    return out;
+}
+
+// What the code generator reads of every instruction, summed into `sink`
+// so that the reads are not optimised away.
+static volatile uint64_t sink;
+
+static uint64_t read_compact(const InterCodeArray &arr)
+{
+    uint64_t sum = 0;
+    for (const IRInstr &ins : arr.code)
+    {
+        switch (ins.op)
+        {
+        case IROp::Label:
+        case IROp::Jump:
+            sum += ins.dst.id();
+            break;
+        case IROp::PrintInt:
+        case IROp::PrintString:
+            sum += ins.a.is_imm() ? uint64_t(arr.value(ins.a)) : ins.a.id();
+            break;
+        default:
+            sum += ins.dst.id() + uint64_t(ins.op);
+            sum += ins.a.is_imm() ? uint64_t(arr.value(ins.a)) : ins.a.id();
+            if (!ins.b.empty())
+                sum += ins.b.is_imm() ? uint64_t(arr.value(ins.b)) : ins.b.id();
+            break;
+        }
+    }
+    return sum;
+}
+
+static uint64_t operand_sum(const si::IROperand &o) { return o.is_imm ? uint64_t(o.imm) : o.sym; }
+
+static uint64_t read_shared(const si::InterCodeArray &arr)
+{
+    uint64_t sum = 0;
+    for (const auto &ins : arr)
+    {
+        switch (ins->kind())
+        {
+        case si::IRKind::Label:
+            sum += std::static_pointer_cast<si::LabelCode>(ins)->label.size();
+            break;
+        case si::IRKind::Jump:
+            sum += std::static_pointer_cast<si::JumpCode>(ins)->dist.size();
+            break;
+        case si::IRKind::Print:
+        {
+            auto p = std::static_pointer_cast<si::PrintCodeIR>(ins);
+            sum += p->type.size() + operand_sum(p->value);
+            break;
+        }
+        case si::IRKind::Assignment:
+        {
+            auto a = std::static_pointer_cast<si::AssignmentCode>(ins);
+            sum += a->var + a->op.size() + operand_sum(a->left);
+            if (!a->op.empty())
+                sum += operand_sum(a->right);
+            break;
+        }
+        case si::IRKind::Compare:
+        {
+            auto c = std::static_pointer_cast<si::CompareCodeIR>(ins);
+            sum += c->operation.size() + c->jump.size() + operand_sum(c->left) + operand_sum(c->right);
+            break;
+        }
+        }
+    }
+    return sum;
+}
+
+int main(int argc, char **argv)
+{
+    size_t mb = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 16;
+
+    std::string text;
+    CorpusGenerator(12345).generate(text, mb << 20);
+    Source source(text);
+    std::vector<Token> tokens = tokenize(source, best_simd_lexer());
+    TokenStore store(tokens);
+    std::vector<Token>().swap(tokens);
+    TokenStoreSource feed(store, source);
+    Arena ast;
+    SymbolTable parsed(source.symbols);
+    Parser parser(feed, source, ast, parsed);
+    const Node *root = parser.get_root();
+
+    // Each run starts from the symbols the parser left.
+    InterCodeArray arr;
+    double irgen = best_ms([&] {
+        SymbolTable symbols(parsed);
+        arr = IntermediateCodeGen(root, source, symbols).take().code;
+    });
+    SymbolTable symbols(parsed);
+    IntermediateCodeGen generated(root, source, symbols);
+    const size_t n = arr.code.size();
+
+    std::pair<size_t, size_t> compact_heap, shared_heap;
+    double store_compact = best_ms([&] {
+        InterCodeArray copy;
+        compact_heap = heap([&] { copy = copy_compact(arr); });
+    });
+    double store_shared = best_ms([&] {
+        si::InterCodeArray copy;
+        shared_heap = heap([&] { copy = si::clone(arr); });
+    });
+
+    si::InterCodeArray old = si::clone(arr);
+    double walk_compact = best_ms([&] { sink = read_compact(arr); });
+    double walk_shared = best_ms([&] { sink = read_shared(old); });
+    old = si::InterCodeArray();
+
+    const char *path = "bench_compact_ir.asm";
+    double codegen = best_ms([&] {
+        SymbolTable s(symbols);
+        CodeGenerator(GeneratedIR{copy_compact(arr)}, s).writeAsm(path);
+    });
+    std::remove(path);
+
+    std::printf("program: %zu MB, %zu IR instructions, %zu immediates\n", text.size() >> 20, n,
+                arr.immediates.size());
+    std::printf("                           %12s %12s\n", "shared_ptr", "compact");
+    std::printf("  heap bytes / instruction %12.1f %12.1f   %.1fx\n", double(shared_heap.first) / n,
+                double(compact_heap.first) / n, double(shared_heap.first) / compact_heap.first);
+    std::printf("  allocations              %12zu %12zu\n", shared_heap.second, compact_heap.second);
+    std::printf("  store (ms)               %12.2f %12.2f   %.1fx\n", store_shared, store_compact,
+                store_shared / store_compact);
+    std::printf("  read walk (ms)           %12.2f %12.2f   %.1fx\n", walk_shared, walk_compact,
+                walk_shared / walk_compact);
+    std::printf("IR generation %.1f ms (%.1f ns/instruction), code generation %.1f ms\n", irgen, irgen * 1e6 / n,
+                codegen);
+    return 0;
+}
@@ -0,0 +1,101 @@
+// Deep nesting: programs whose expressions or blocks nest `depth` levels,
+// far beyond what the native stack would take with one frame per level.
+// For each shape it times parsing into the Arena tree and into the flat
+// layout, and IR generation from both.
+//
+//   ./bench_deep [depth=1000000]
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "flat_ast.hpp"
+#include "ir.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
+#include "timing.hpp"
+#include "token_store.hpp"
+
+// x = ((( ... (1) ... )));
+static std::string parens(size_t depth)
+{
+    return "int x;\nx = " + std::string(depth, '(') + "1" + std::string(depth, ')') + ";\n";
+}
+
+// x = 1 - (2 - (3 - ... ));
+static std::string right_nested(size_t depth)
+{
+    std::string text = "int x;\nx = ";
+    for (size_t d = 0; d < depth; ++d)
+        text += std::to_string(d % 10) + " - (";
+    text += "x" + std::string(depth, ')') + ";\n";
+    return text;
+}
+
+// if (!!! ... !x < 1) { cout << x; }
+static std::string negations(size_t depth)
+{
+    return "int x;\nif (" + std::string(depth, '!') + "x < 1) {\n  cout << x;\n}\n";
+}
+
+// if and while blocks inside each other, each with a statement.
+static std::string blocks(size_t depth)
+{
+    std::string text = "int x;\n";
+    for (size_t d = 0; d < depth; ++d)
+    {
+        text += d % 2 ? "while (x < 1) {\n" : "if (x == 0 || x > 5) {\n";
+        text += "x = x + 1;\n";
+    }
+    for (size_t d = depth; d-- > 0;)
+        text += d % 6 ? "}\n" : "} else {\ncout << x;\n}\n";
+    return text;
+}
+
+static void bench(const char *name, const std::string &text, size_t depth)
+{
+    Source source(text);
+    std::vector<Token> tokens = tokenize(source, best_simd_lexer());
+    TokenStore store(tokens);
+    std::vector<Token>().swap(tokens);
+
+    Arena ast;
+    SymbolTable tree_symbols(source.symbols);
+    Node *root = nullptr;
+    double parse_tree = ms([&] {
+        TokenStoreSource feed(store, source);
+        Parser parser(feed, source, ast, tree_symbols);
+        root = parser.get_root();
+    });
+
+    SymbolTable flat_symbols(source.symbols);
+    FlatTree flat;
+    double parse_flat = ms([&] {
+        TokenStoreSource feed(store, source);
+        FlatBuilder builder(store.size() + 1);
+        Parser parser(feed, source, builder, flat_symbols);
+        parser.parse();
+        flat = builder.take();
+    });
+
+    size_t instrs = 0;
+    double ir_tree = ms([&] { instrs = IntermediateCodeGen(root, source, tree_symbols).take().code.code.size(); });
+    double ir_flat = ms([&] { IntermediateCodeGen(flat, source, flat_symbols).take(); });
+
+    std::printf("%-13s %8zu levels %9zu tokens %9zu IR   parse %8.2f / %8.2f ms   IR %8.2f / %8.2f ms\n", name,
+                depth, store.size(), instrs, parse_tree, parse_flat, ir_tree, ir_flat);
+    std::fflush(stdout);
+}
+
+int main(int argc, char **argv)
+{
+    size_t depth = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+
+    std::printf("times are for the arena tree / the flat layout\n");
+    bench("parentheses", parens(depth), depth);
+    bench("right-nested", right_nested(depth), depth);
+    bench("negations", negations(depth), depth);
+    bench("blocks", blocks(depth), depth);
+    return 0;
+}
@@ -0,0 +1,137 @@
+// AST layout: the linked Arena tree against the flat post-order array, both
+// produced by the same Parser run. For a large program and a deeply nested
+// one it reports parse time and memory per layout, the time of a bare
+// traversal, and the time of IR generation from each, and checks that both
+// give the same IR.
+//
+//   ./bench_flat_ast [megabytes=16] [depth=2000]
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "corpus.hpp"
+#include "flat_ast.hpp"
+#include "ir.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
+#include "timing.hpp"
+#include "token_store.hpp"
+
+// Counts what a traversal reports; the cheapest possible consumer.
+struct Counter
+{
+    size_t events{0};
+
+    void number(Token, int64_t) { ++events; }
+    void string_literal(Token) { ++events; }
+    void identifier(Token, uint32_t) { ++events; }
+    void unary(Token) { ++events; }
+    void short_circuit(Token) { ++events; }
+    void binary(Token) { ++events; }
+    void declaration(ValueType, Token, uint32_t) { ++events; }
+    void assignment(Token, uint32_t) { ++events; }
+    void print() { ++events; }
+    void block(uint32_t) { ++events; }
+    void while_start() { ++events; }
+    void condition() { ++events; }
+    void else_start() { ++events; }
+    void if_statement(bool) { ++events; }
+    void while_statement() { ++events; }
+};
+
+static bool same_ir(const InterCodeArray &a, const InterCodeArray &b)
+{
+    if (a.code.size() != b.code.size() || a.immediates != b.immediates)
+        return false;
+    for (size_t i = 0; i < a.code.size(); ++i)
+    {
+        const IRInstr &x = a.code[i], &y = b.code[i];
+        if (x.op != y.op || x.dst != y.dst || x.a != y.a || x.b != y.b)
+            return false;
+    }
+    return true;
+}
+
+static void bench(const char *name, const std::string &text)
+{
+    Source source(text);
+    std::vector<Token> tokens = tokenize(source, best_simd_lexer());
+    TokenStore store(tokens);
+    std::vector<Token>().swap(tokens);
+
+    Arena ast;
+    SymbolTable tree_symbols(source.symbols);
+    Node *root = nullptr;
+    double parse_tree = ms([&] {
+        TokenStoreSource feed(store, source);
+        Parser parser(feed, source, ast, tree_symbols);
+        root = parser.get_root();
+    });
+
+    SymbolTable flat_symbols(source.symbols);
+    FlatTree flat;
+    double parse_flat = ms([&] {
+        TokenStoreSource feed(store, source);
+        FlatBuilder builder(store.size() + 1);
+        Parser parser(feed, source, builder, flat_symbols);
+        parser.parse();
+        flat = builder.take();
+    });
+
+    Counter tree_count, flat_count;
+    replay(root, tree_count);
+    replay(flat, flat_count);
+    bool same = tree_count.events == flat_count.events;
+    {
+        SymbolTable s1(tree_symbols), s2(tree_symbols);
+        same = same && same_ir(IntermediateCodeGen(root, source, s1).take().code,
+                               IntermediateCodeGen(flat, source, s2).take().code);
+    }
+
+    // Best of three alternating runs. Each IR generation starts from the
+    // symbols the parser left, and its IR is freed before the next one runs.
+    double walk_tree = 1e300, walk_flat = 1e300, ir_tree = 1e300, ir_flat = 1e300;
+    for (int rep = 0; rep < 3; ++rep)
+    {
+        walk_tree = std::min(walk_tree, ms([&] { replay(root, tree_count); }));
+        walk_flat = std::min(walk_flat, ms([&] { replay(flat, flat_count); }));
+        {
+            SymbolTable s(tree_symbols);
+            GeneratedIR ir;
+            ir_tree = std::min(ir_tree, ms([&] { ir = IntermediateCodeGen(root, source, s).take(); }));
+        }
+        {
+            SymbolTable s(tree_symbols);
+            GeneratedIR ir;
+            ir_flat = std::min(ir_flat, ms([&] { ir = IntermediateCodeGen(flat, source, s).take(); }));
+        }
+    }
+
+    size_t nodes = flat.nodes.size();
+    std::printf("%s: %zu MB, %zu tokens, %zu flat nodes, same IR: %s\n", name, text.size() >> 20, store.size(),
+                nodes, same ? "yes" : "NO");
+    std::printf("                  %12s %12s\n", "arena tree", "flat");
+    std::printf("  memory (MB)     %12.1f %12.1f\n", ast.bytes() / 1048576.0, flat.bytes() / 1048576.0);
+    std::printf("  parse (ms)      %12.2f %12.2f\n", parse_tree, parse_flat);
+    std::printf("  traverse (ms)   %12.2f %12.2f   %.2fx\n", walk_tree, walk_flat, walk_tree / walk_flat);
+    std::printf("  IR gen (ms)     %12.2f %12.2f   %.2fx\n", ir_tree, ir_flat, ir_tree / ir_flat);
+    std::fflush(stdout);
+}
+
+int main(int argc, char **argv)
+{
+    size_t mb = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 16;
+    int depth = argc > 2 ? std::atoi(argv[2]) : 2000;
+
+    std::string text;
+    CorpusGenerator(12345).generate(text, mb << 20);
+    bench("program", text);
+    text = std::string();
+
+    CorpusGenerator(12345).generate_nested(text, mb << 20, depth);
+    bench("nested", text);
+    return 0;
+}
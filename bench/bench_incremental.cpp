@@ -0,0 +1,209 @@
+// Incremental reparsing: single-line edits of a large program. Each edit is
+// re-lexed by TokenBuffer and brought into the tree by
+// IncrementalParser::reparse(). For each kind of edit it reports the median
+// and worst time of both steps against a parse of the whole program, and
+// checks that the tree then matches a fresh parse of the edited text.
+//
+//   ./bench_incremental [lines=1000000] [edits=200]
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "corpus.hpp"
+#include "incremental_parser.hpp"
+#include "lexer.hpp"
+#include "timing.hpp"
+#include "token_buffer.hpp"
+
+// Hashes what a traversal reports, spelling variables by name: a fresh
+// parse numbers the symbols differently.
+struct Digest
+{
+    uint64_t hash{1469598103934665603ull};
+    size_t events{0};
+
+    void add(uint64_t x)
+    {
+        hash = (hash ^ x) * 1099511628211ull;
+        ++events;
+    }
+    void number(Token, int64_t value) { add(1), add(uint64_t(value)); }
+    void string_literal(Token tok) { add(2), add(tok.sym); }
+    void identifier(Token tok, uint32_t) { add(3), add(tok.sym); }
+    void unary(Token op) { add(4), add(uint64_t(op.type)); }
+    void short_circuit(Token op) { add(5), add(uint64_t(op.type)); }
+    void binary(Token op) { add(6), add(uint64_t(op.type)); }
+    void declaration(ValueType type, Token tok, uint32_t) { add(7), add(uint64_t(type)), add(tok.sym); }
+    void assignment(Token tok, uint32_t) { add(8), add(tok.sym); }
+    void print() { add(9); }
+    void block(uint32_t count) { add(10), add(count); }
+    void while_start() { add(11); }
+    void condition() { add(12); }
+    void else_start() { add(13); }
+    void if_statement(bool has_else) { add(14), add(has_else); }
+    void while_statement() { add(15); }
+};
+
+static double median(std::vector<double> v)
+{
+    std::sort(v.begin(), v.end());
+    return v.empty() ? 0 : v[v.size() / 2];
+}
+
+static bool is_comparison(TokenType t)
+{
+    return t == TokenType::Less || t == TokenType::Greater || t == TokenType::Equal || t == TokenType::NotEqual;
+}
+
+struct Session
+{
+    std::string text;
+    Source source;
+    TokenBuffer tokens;
+    IncrementalParser parser;
+    std::mt19937 rng{7};
+
+    explicit Session(std::string program)
+        : text(std::move(program)), source(text), tokens(tokenize(source, best_simd_lexer())),
+          parser(tokens, source)
+    {
+    }
+
+    // Index of the first token from a random place on that `want` accepts.
+    template <class Want>
+    size_t find(Want want)
+    {
+        for (;;)
+        {
+            for (size_t i = rng() % tokens.size(); i + 1 < tokens.size(); ++i)
+                if (want(i))
+                    return i;
+        }
+    }
+
+    // An assignment that is a statement of its own: [first, last] tokens.
+    std::pair<size_t, size_t> assignment()
+    {
+        size_t first = find([&](size_t i) {
+            if (i == 0 || tokens[i].type != TokenType::Var || tokens[i + 1].type != TokenType::Assign)
+                return false;
+            TokenType prev = tokens[i - 1].type;
+            return prev == TokenType::Semicolon || prev == TokenType::LBrace || prev == TokenType::RBrace;
+        });
+        size_t last = first;
+        while (tokens[last].type != TokenType::Semicolon)
+            ++last;
+        return {first, last};
+    }
+
+    // Replaces text[offset, offset + removed) and reparses; returns the
+    // times of the re-lex and of the reparse.
+    std::pair<double, double> edit(uint32_t offset, uint32_t removed, const std::string &inserted)
+    {
+        text.replace(offset, removed, inserted);
+        source.text = text;
+        std::pair<size_t, size_t> range;
+        double lex = ms([&] { range = tokens.apply(source, TextEdit{offset, removed, inserted}); });
+        double parse = ms([&] { parser.reparse(range.first, range.second); });
+        return {lex, parse};
+    }
+
+    std::pair<double, double> change_number()
+    {
+        Token t = tokens[find([&](size_t i) { return tokens[i].type == TokenType::IntLit; })];
+        return edit(t.offset, t.length, std::to_string(rng() % 100000));
+    }
+
+    std::pair<double, double> insert_statement()
+    {
+        auto [first, last] = assignment();
+        Token a = tokens[first], b = tokens[last];
+        std::string copy = text.substr(a.offset, b.offset + 1 - a.offset) + "\n";
+        return edit(a.offset, 0, copy);
+    }
+
+    std::pair<double, double> delete_statement()
+    {
+        auto [first, last] = assignment();
+        Token a = tokens[first], b = tokens[last];
+        return edit(a.offset, b.offset + 1 - a.offset, "");
+    }
+
+    // Flips the first comparison in the condition of an if or a while, so
+    // that the whole statement is reparsed around its unchanged blocks.
+    std::pair<double, double> edit_condition()
+    {
+        size_t i = find([&](size_t i) { return tokens[i].type == TokenType::If || tokens[i].type == TokenType::While; });
+        while (!is_comparison(tokens[i].type))
+            ++i;
+        static const char *flipped[] = {"<", ">", "==", "!="};
+        Token t = tokens[i];
+        const char *by = t.type == TokenType::Less      ? flipped[1]
+                         : t.type == TokenType::Greater ? flipped[0]
+                         : t.type == TokenType::Equal   ? flipped[3]
+                                                        : flipped[2];
+        return edit(t.offset, t.length, by);
+    }
+
+    bool matches_fresh_parse()
+    {
+        IncrementalParser fresh(tokens, source);
+        Digest x, y;
+        replay(parser.root(), x);
+        replay(fresh.parse(), y);
+        return x.hash == y.hash && x.events == y.events;
+    }
+};
+
+int main(int argc, char **argv)
+{
+    size_t lines = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    int edits = argc > 2 ? std::atoi(argv[2]) : 200;
+
+    std::string text;
+    CorpusGenerator corpus(12345);
+    while (std::count(text.begin(), text.end(), '\n') < std::ptrdiff_t(lines))
+        corpus.generate(text, text.size() + (1 << 20));
+
+    Session s(std::move(text));
+    double full = ms([&] { s.parser.parse(); });
+    std::printf("%zu lines, %zu MB, %zu tokens; whole-program parse %.1f ms\n", lines, s.text.size() >> 20,
+                s.tokens.size(), full);
+    std::printf("%-20s %12s %12s %12s %12s %8s %7s %s\n", "edit", "relex med", "relex max", "reparse med",
+                "reparse max", "reused", "whole", "same tree");
+
+    struct Kind
+    {
+        const char *name;
+        std::pair<double, double> (Session::*run)();
+    } kinds[] = {
+        {"change a number", &Session::change_number},
+        {"insert a statement", &Session::insert_statement},
+        {"delete a statement", &Session::delete_statement},
+        {"edit a condition", &Session::edit_condition},
+    };
+    for (const Kind &k : kinds)
+    {
+        std::vector<double> lex, parse;
+        size_t reused = 0, whole = 0;
+        for (int e = 0; e < edits; ++e)
+        {
+            auto [l, p] = (s.*k.run)();
+            lex.push_back(l);
+            parse.push_back(p);
+            reused += s.parser.stats().reused;
+            whole += s.parser.stats().whole;
+        }
+        bool same = s.matches_fresh_parse();
+        std::printf("%-20s %9.3f ms %9.3f ms %9.3f ms %9.3f ms %8.1f %7zu %s\n", k.name, median(lex),
+                    *std::max_element(lex.begin(), lex.end()), median(parse),
+                    *std::max_element(parse.begin(), parse.end()), double(reused) / edits, whole,
+                    same ? "yes" : "NO");
+        std::fflush(stdout);
+    }
+    return 0;
+}
@@ -0,0 +1,209 @@
+// AST dispatch during IR generation: the NodeKind switch against the chains
+// of dynamic_pointer_cast the IR generator used to run on every node. On a
+// generated program of the given number of statements it times
+// IntermediateCodeGen, then two walks that visit the nodes the way the IR
+// generator does and differ only in how they tell node types apart: one
+// over the tagged arena AST, one over the same tree copied to the old
+// polymorphic shared_ptr nodes.
+//
+//   ./bench_ir [statements=1000000]
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "corpus.hpp"
+#include "ir.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
+#include "shared_ast.hpp"
+#include "timing.hpp"
+#include "token_store.hpp"
+
+namespace sa = shared_ast;
+
+// Old dispatch: the same type tests, in the same order, as the former
+// exec_statement, exec_expr and emit_condition.
+static size_t rtti_expr(const std::shared_ptr<sa::Node> &n)
+{
+    if (auto id = std::dynamic_pointer_cast<sa::IdentifierNode>(n))
+        return 1;
+    if (auto num = std::dynamic_pointer_cast<sa::NumberNode>(n))
+        return 1;
+    if (auto un = std::dynamic_pointer_cast<sa::UnaryOpNode>(n))
+        return 1;
+    auto bin = std::dynamic_pointer_cast<sa::BinOpNode>(n);
+    return 1 + rtti_expr(bin->left) + rtti_expr(bin->right);
+}
+
+static size_t rtti_condition(const std::shared_ptr<sa::Node> &n)
+{
+    if (auto un = std::dynamic_pointer_cast<sa::UnaryOpNode>(n))
+        return 1 + rtti_condition(un->operand);
+    if (auto bin = std::dynamic_pointer_cast<sa::BinOpNode>(n))
+    {
+        switch (bin->op_tok.type)
+        {
+        case TokenType::Not:
+            return 1 + rtti_condition(bin->right);
+        case TokenType::And:
+        case TokenType::Or:
+            return 1 + rtti_condition(bin->left) + rtti_condition(bin->right);
+        case TokenType::Equal:
+        case TokenType::NotEqual:
+        case TokenType::Less:
+        case TokenType::Greater:
+            return 1 + rtti_expr(bin->left) + rtti_expr(bin->right);
+        default:
+            break;
+        }
+    }
+    return rtti_expr(n);
+}
+
+static size_t rtti_statement(const std::shared_ptr<sa::Node> &n)
+{
+    if (!n)
+        return 0;
+    if (auto blk = std::dynamic_pointer_cast<sa::BlockNode>(n))
+    {
+        size_t count = 1;
+        for (const auto &st : blk->statements)
+            count += rtti_statement(st);
+        return count;
+    }
+    if (auto iff = std::dynamic_pointer_cast<sa::IfNode>(n))
+        return 1 + rtti_condition(iff->condition) + rtti_statement(iff->then_branch) +
+               rtti_statement(iff->else_branch);
+    if (auto wh = std::dynamic_pointer_cast<sa::WhileNode>(n))
+        return 1 + rtti_condition(wh->condition) + rtti_statement(wh->body);
+    if (auto pr = std::dynamic_pointer_cast<sa::PrintNode>(n))
+        return 1 + rtti_expr(pr->value);
+    if (auto de = std::dynamic_pointer_cast<sa::DeclarationNode>(n))
+        return 1;
+    if (auto asg = std::dynamic_pointer_cast<sa::AssignmentNode>(n))
+        return 1 + rtti_expr(asg->expression);
+    return 0;
+}
+
+// New dispatch: one switch on the kind tag per node.
+static size_t tag_expr(const Node *n)
+{
+    if (n->kind != NodeKind::BinOp)
+        return 1;
+    auto bin = static_cast<const BinOpNode *>(n);
+    return 1 + tag_expr(bin->left) + tag_expr(bin->right);
+}
+
+static size_t tag_condition(const Node *n)
+{
+    if (auto un = node_cast<UnaryOpNode>(n))
+        return 1 + tag_condition(un->operand);
+    if (auto bin = node_cast<BinOpNode>(n))
+    {
+        switch (bin->op_tok.type)
+        {
+        case TokenType::Not:
+            return 1 + tag_condition(bin->right);
+        case TokenType::And:
+        case TokenType::Or:
+            return 1 + tag_condition(bin->left) + tag_condition(bin->right);
+        case TokenType::Equal:
+        case TokenType::NotEqual:
+        case TokenType::Less:
+        case TokenType::Greater:
+            return 1 + tag_expr(bin->left) + tag_expr(bin->right);
+        default:
+            break;
+        }
+    }
+    return tag_expr(n);
+}
+
+static size_t tag_statement(const Node *n)
+{
+    if (!n)
+        return 0;
+    switch (n->kind)
+    {
+    case NodeKind::Block:
+    {
+        size_t count = 1;
+        for (const Node *st : static_cast<const BlockNode *>(n)->statements)
+            count += tag_statement(st);
+        return count;
+    }
+    case NodeKind::If:
+    {
+        auto iff = static_cast<const IfNode *>(n);
+        return 1 + tag_condition(iff->condition) + tag_statement(iff->then_branch) +
+               tag_statement(iff->else_branch);
+    }
+    case NodeKind::While:
+    {
+        auto wh = static_cast<const WhileNode *>(n);
+        return 1 + tag_condition(wh->condition) + tag_statement(wh->body);
+    }
+    case NodeKind::Print:
+        return 1 + tag_expr(static_cast<const PrintNode *>(n)->value);
+    case NodeKind::Declaration:
+        return 1;
+    case NodeKind::Assignment:
+        return 1 + tag_expr(static_cast<const AssignmentNode *>(n)->expression);
+    default:
+        return 0;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    size_t statements = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+
+    // generate() stops after the first top-level statement that reaches the
+    // size. Statements are counted by their terminators, ';' or '}', so an
+    // if with an else counts twice.
+    std::string text;
+    CorpusGenerator gen(12345);
+    for (size_t count = 0; count < statements;)
+    {
+        size_t from = text.size();
+        gen.generate(text, from + 1);
+        for (size_t i = from; i < text.size(); ++i)
+            count += text[i] == ';' || text[i] == '}';
+    }
+
+    Source source(text);
+    std::vector<Token> tokens = tokenize(source, best_simd_lexer());
+    TokenStore store(tokens);
+    std::vector<Token>().swap(tokens);
+    TokenStoreSource feed(store, source);
+    Arena ast;
+    SymbolTable symbols(source.symbols);
+    Parser parser(feed, source, ast, symbols);
+    const Node *root = parser.get_root();
+
+    size_t nodes = 0;
+    std::shared_ptr<sa::Node> shared_root = sa::clone(root, nodes);
+
+    size_t instrs = 0;
+    double irgen = best_ms([&] {
+        IntermediateCodeGen ir(root, source, symbols);
+        instrs = ir.take().code.code.size();
+    });
+    size_t visited_rtti = 0, visited_tag = 0;
+    double rtti = best_ms([&] { visited_rtti = rtti_statement(shared_root); });
+    double tag = best_ms([&] { visited_tag = tag_statement(root); });
+
+    std::printf("%zu statements, %zu MB, %zu nodes, %zu IR instructions\n", statements, text.size() >> 20,
+                nodes, instrs);
+    std::printf("IR generation               %9.2f ms  %7.1f ns/node\n", irgen, irgen * 1e6 / nodes);
+    std::printf("walk, dynamic_pointer_cast  %9.2f ms  %7.1f ns/node  (%zu visits)\n", rtti,
+                rtti * 1e6 / nodes, visited_rtti);
+    std::printf("walk, NodeKind switch       %9.2f ms  %7.1f ns/node  (%zu visits)\n", tag, tag * 1e6 / nodes,
+                visited_tag);
+    std::printf("IR generation with the old dispatch, estimated: %.2f ms (%.2fx)\n", irgen - tag + rtti,
+                (irgen - tag + rtti) / irgen);
+    return 0;
+}
@@ -0,0 +1,75 @@
+// Keyword classification: perfect hash (keywords.hpp) against the
+// string-compare chain the identifier rule used before.
+//
+//   ./bench_keywords [identifiers=10000000]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "keywords.hpp"
+
+static TokenType chain_type(const char *text, size_t len)
+{
+    std::string s(text, len);
+    if      (s == "if")     return TokenType::If;
+    else if (s == "else")   return TokenType::Else;
+    else if (s == "while")  return TokenType::While;
+    else if (s == "cout")   return TokenType::Print;
+    else if (s == "int")    return TokenType::IntKw;
+    else if (s == "string") return TokenType::StringKw;
+    return TokenType::Var;
+}
+
+// Identifier-heavy text: mostly short variable names with keywords and
+// keyword look-alikes ("iff", "counter", "strings") mixed in.
+static std::vector<std::string_view> make_words(std::string &storage, size_t n)
+{
+    static const char *pool[] = {"if", "else", "while", "cout", "int", "string",
+                                 "i", "x", "iff", "counter", "strings", "whilst",
+                                 "elsewhere", "total", "tmp_value", "n2", "index",
+                                 "a_rather_long_identifier_name"};
+    std::mt19937 rng(12345);
+    std::vector<std::pair<size_t, size_t>> spans;
+    for (size_t i = 0; i < n; ++i)
+    {
+        const char *w = pool[rng() % (sizeof(pool) / sizeof(pool[0]))];
+        spans.emplace_back(storage.size(), std::char_traits<char>::length(w));
+        storage += w;
+        storage += ' ';
+    }
+    std::vector<std::string_view> words;
+    words.reserve(n);
+    for (auto &s : spans)
+        words.emplace_back(storage.data() + s.first, s.second);
+    return words;
+}
+
+template <class F>
+static double run(const char *name, const std::vector<std::string_view> &words, F classify)
+{
+    size_t keywords_seen = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (auto w : words)
+        keywords_seen += classify(w) != TokenType::Var;
+    auto t1 = std::chrono::steady_clock::now();
+    double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / words.size();
+    std::printf("%-14s %8.2f ns/identifier  (%zu keywords)\n", name, ns, keywords_seen);
+    return ns;
+}
+
+int main(int argc, char **argv)
+{
+    size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10000000;
+    std::string storage;
+    auto words = make_words(storage, n);
+
+    double chain = run("if-chain", words, [](std::string_view w) { return chain_type(w.data(), w.size()); });
+    double hashed = run("perfect-hash", words, [](std::string_view w) { return keyword_type(w); });
+    std::printf("speedup        %8.2fx\n", chain / hashed);
+    return 0;
+}
@@ -0,0 +1,188 @@
+// Lexer throughput on generated corpora: every scanner over every mix at
+// 1 KB, 1 MB, 100 MB and 1 GB. Reports MB/s, tokens/s, heap allocations per
+// token and peak RSS (with its growth during the run).
+//
+//   ./bench_lexer [--max-size=1G] [--mix=program|identifiers|literals|comments|strings]
+//                 [--lexer=flex|scalar|sse2|avx2|parallel]
+//
+// The 1 GB corpus needs about 6 GB of memory for the text and the tokens;
+// use --max-size to stop earlier.
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "corpus.hpp"
+#include "lexer.hpp"
+
+static std::atomic<size_t> allocations{0};
+
+void *operator new(size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+
+// VmRSS / VmHWM from /proc/self/status, in kB; 0 if unavailable.
+static size_t status_kb(const char *field)
+{
+    size_t kb = 0;
+    if (FILE *f = std::fopen("/proc/self/status", "r"))
+    {
+        char line[256];
+        size_t len = std::strlen(field);
+        while (std::fgets(line, sizeof(line), f))
+            if (std::strncmp(line, field, len) == 0)
+                kb = std::strtoull(line + len + 1, nullptr, 10);
+        std::fclose(f);
+    }
+    return kb;
+}
+
+// Lets VmHWM track the peak of the next run only (Linux >= 4.0).
+static void reset_peak_rss()
+{
+    if (FILE *f = std::fopen("/proc/self/clear_refs", "w"))
+    {
+        std::fputs("5", f);
+        std::fclose(f);
+    }
+}
+
+struct LexerChoice
+{
+    const char *name;
+    LexerKind kind;
+    bool parallel;
+};
+
+static const LexerChoice lexers[] = {
+    {"flex", LexerKind::Flex, false},
+    {"scalar", LexerKind::Scalar, false},
+    {"sse2", LexerKind::Sse2, false},
+    {"avx2", LexerKind::Avx2, false},
+    {"parallel", LexerKind::Avx2, true},
+};
+
+static const Mix mixes[] = {Mix::Program, Mix::Identifiers, Mix::Literals, Mix::Comments, Mix::Strings};
+
+static const size_t sizes[] = {size_t(1) << 10, size_t(1) << 20, size_t(100) << 20, size_t(1) << 30};
+
+static size_t parse_size(const char *s)
+{
+    char *end;
+    size_t n = std::strtoull(s, &end, 10);
+    switch (*end)
+    {
+        case 'k': case 'K': return n << 10;
+        case 'm': case 'M': return n << 20;
+        case 'g': case 'G': return n << 30;
+        default: return n;
+    }
+}
+
+static std::vector<Token> run_lexer(const LexerChoice &lx, Source &src)
+{
+    if (lx.parallel)
+        return lex_parallel(src, 0, lx.kind);
+    return tokenize(src, lx.kind);
+}
+
+// One corpus through one lexer. Small corpora are scanned repeatedly until
+// enough time has passed for a stable rate.
+static void bench(const LexerChoice &lx, Mix mix, const std::string &text, size_t size)
+{
+    std::string_view view(text.data(), size);
+    size_t reps = 0, tokens = 0, allocs = 0;
+    double seconds = 0;
+    size_t rss_before = status_kb("VmRSS:");
+    reset_peak_rss();
+    do
+    {
+        Source src(view, true);
+        size_t a0 = allocations.load(std::memory_order_relaxed);
+        auto t0 = std::chrono::steady_clock::now();
+        std::vector<Token> out = run_lexer(lx, src);
+        auto t1 = std::chrono::steady_clock::now();
+        allocs += allocations.load(std::memory_order_relaxed) - a0;
+        seconds += std::chrono::duration<double>(t1 - t0).count();
+        tokens += out.size();
+        ++reps;
+    } while (seconds < 0.5 && size < (size_t(100) << 20));
+    size_t peak = status_kb("VmHWM:");
+
+    double mb = double(size) * reps / (1 << 20);
+    std::printf("%-8s %-11s %10zu B %9.1f MB/s %8.2f Mtok/s %7.3f allocs/token %8zu MB peak (+%zu MB)\n",
+                lx.name, mix_name(mix), size, mb / seconds, tokens / seconds / 1e6,
+                double(allocs) / tokens, peak >> 10, peak > rss_before ? (peak - rss_before) >> 10 : 0);
+    std::fflush(stdout);
+}
+
+int main(int argc, char **argv)
+{
+    size_t max_size = size_t(1) << 30;
+    std::string only_mix, only_lexer;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg.rfind("--max-size=", 0) == 0)
+            max_size = parse_size(arg.c_str() + 11);
+        else if (arg.rfind("--mix=", 0) == 0)
+            only_mix = arg.substr(6);
+        else if (arg.rfind("--lexer=", 0) == 0)
+            only_lexer = arg.substr(8);
+        else
+        {
+            std::fprintf(stderr, "usage: %s [--max-size=N[K|M|G]] [--mix=name] [--lexer=name]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    for (Mix mix : mixes)
+    {
+        if (!only_mix.empty() && only_mix != mix_name(mix))
+            continue;
+        size_t largest = 0;
+        for (size_t s : sizes)
+            if (s <= max_size)
+                largest = s;
+        if (!largest)
+            break;
+
+        // One corpus per mix; smaller sizes scan a copy of its prefix, cut
+        // at a line end. Every copy is followed by two NULs so that flex
+        // scans it in place, like an mmap-ed input file.
+        std::string corpus;
+        corpus.reserve(largest + 4096);
+        CorpusGenerator(12345).generate(corpus, largest, mix);
+        for (size_t s : sizes)
+        {
+            if (s > largest)
+                break;
+            size_t cut = corpus.rfind('\n', s - 1);
+            size_t size = cut == std::string::npos ? s : cut + 1;
+            std::string text = s == largest ? std::move(corpus) : corpus.substr(0, size);
+            if (s == largest)
+                size = text.size();
+            text.append(2, '\0');
+            for (const LexerChoice &lx : lexers)
+            {
+                if (!only_lexer.empty() && only_lexer != lx.name)
+                    continue;
+                if (lx.kind > best_simd_lexer())
+                    continue;
+                bench(lx, mix, text, size);
+            }
+        }
+    }
+    return 0;
+}
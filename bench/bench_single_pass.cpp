@@ -0,0 +1,93 @@
+// Single-pass compilation: the parser reporting straight to
+// IntermediateCodeGen against building the AST, lowering it and freeing it.
+// Both runs go from the text to an assembly file; the report splits the
+// front end (lexing, parsing, IR) from code generation, and checks that
+// both write the same assembly.
+//
+//   ./bench_single_pass [megabytes=32]
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include "codegen.hpp"
+#include "corpus.hpp"
+#include "ir.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
+#include "timing.hpp"
+
+static std::string slurp(const char *path)
+{
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+struct Times
+{
+    double front{1e300};
+    double codegen{1e300};
+    size_t ast_bytes{0};
+};
+
+// Lex, parse and lower `source`, then write its assembly to `path`.
+static void compile(Source &source, bool single_pass, const char *path, Times &t)
+{
+    SymbolTable symbols(source.symbols);
+    GeneratedIR ir;
+    size_t ast_bytes = 0;
+    double front = ms([&] {
+        Lexer lx(source, best_simd_lexer());
+        LexerTokenSource tokens(lx);
+        if (single_pass)
+        {
+            IntermediateCodeGen irgen(source, symbols);
+            Parser(tokens, source, irgen, symbols).parse();
+            ir = irgen.take();
+        }
+        else
+        {
+            Arena ast;
+            Parser parser(tokens, source, ast, symbols);
+            Node *root = parser.get_root();
+            ir = IntermediateCodeGen(root, source, symbols).take();
+            ast_bytes = ast.bytes();
+        }
+    });
+    double codegen = ms([&] { CodeGenerator(std::move(ir), symbols).writeAsm(path); });
+    t.front = std::min(t.front, front);
+    t.codegen = std::min(t.codegen, codegen);
+    t.ast_bytes = ast_bytes;
+}
+
+int main(int argc, char **argv)
+{
+    size_t mb = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 32;
+
+    std::string text;
+    CorpusGenerator(12345).generate(text, mb << 20);
+    Source source(text);
+
+    const char *two_path = "bench_two_pass.asm", *one_path = "bench_single_pass.asm";
+    Times two, one;
+    for (int rep = 0; rep < 3; ++rep)
+    {
+        compile(source, false, two_path, two);
+        compile(source, true, one_path, one);
+    }
+    bool same = slurp(two_path) == slurp(one_path);
+    std::remove(two_path);
+    std::remove(one_path);
+
+    std::printf("program: %zu MB; AST of the two-pass run: %.1f MB; same assembly: %s\n", text.size() >> 20,
+                two.ast_bytes / 1048576.0, same ? "yes" : "NO");
+    std::printf("                   %12s %12s\n", "two-pass", "single-pass");
+    std::printf("  front end (ms)   %12.1f %12.1f   %.2fx\n", two.front, one.front, two.front / one.front);
+    std::printf("  codegen (ms)     %12.1f %12.1f\n", two.codegen, one.codegen);
+    std::printf("  total (ms)       %12.1f %12.1f   %.2fx\n", two.front + two.codegen, one.front + one.codegen,
+                (two.front + two.codegen) / (one.front + one.codegen));
+    return 0;
+}
@@ -0,0 +1,81 @@
+// SSA construction and destruction of the IR on generated programs of
+// doubling size up to the given number of instructions, and on towers of
+// nested if/while blocks. Reports the phis placed on the dominance
+// frontiers and kept by pruning, the copies going out of SSA, and the
+// time per instruction of the analyses SSA needs (CFG, dominators and
+// dominance frontier), of construction, of the verifier and of
+// destruction, which stays flat as the programs grow if they scale
+// linearly. The round trip and the verifier are checked by
+// tests/test_ssa.cpp.
+//
+//   ./bench_ssa [instructions=2000000] [depth=10000]
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "corpus.hpp"
+#include "program.hpp"
+#include "ssa.hpp"
+#include "timing.hpp"
+
+static void row(const char *name, Program &p)
+{
+    const std::vector<IRInstr> code = p.ir.code;
+    const uint32_t labels = p.ir.labels;
+    double t_flow = 1e300, t_build = 1e300, t_verify = 1e300, t_out = 1e300;
+    size_t instrs = code.size(), blocks = 0;
+    SsaForm::Stats stats;
+    size_t phis = 0;
+    for (int rep = 0; rep < 3; ++rep)
+    {
+        p.ir.code = code;
+        p.ir.labels = labels;
+        p.ir.changed();
+        FlowAnalysis flow(p.ir);
+        t_flow = std::min(t_flow, ms([&] { flow.frontiers(); }));
+        blocks = flow.cfg().size();
+        double t = ms([&] {
+            SsaForm ssa(p.ir, p.symbols, flow);
+            phis = ssa.size();
+            t_verify = std::min(t_verify, ms([&] { ssa.verify(flow); }));
+            t_out = std::min(t_out, ms([&] { ssa.destruct(flow); }));
+            stats = ssa.stats();
+        });
+        t_build = std::min(t_build, t - t_verify - t_out);
+    }
+    auto per = [&](double t) { return t * 1e6 / instrs; };
+    std::printf("%-14s %9zu %8zu %8zu %8zu %8zu %8zu %7zu %6zu %8.1f %8.1f %8.1f %8.1f\n", name, instrs, blocks,
+                stats.definitions, stats.placed, phis, stats.copies, stats.split, stats.cycles, per(t_flow),
+                per(t_build), per(t_verify), per(t_out));
+    std::fflush(stdout);
+}
+
+int main(int argc, char **argv)
+{
+    size_t target = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 2000000;
+    int depth = argc > 2 ? std::atoi(argv[2]) : 10000;
+
+    std::printf("%-14s %9s %8s %8s %8s %8s %8s %7s %6s %8s %8s %8s %8s\n", "program", "instrs", "blocks", "defs",
+                "placed", "phis", "copies", "split", "cycles", "analyses", "into", "verify", "out of");
+    std::printf("%-14s %9s %8s %8s %8s %8s %8s %7s %6s %8s %8s %8s %8s\n", "", "", "", "", "", "", "", "", "",
+                "ns/instr", "ns/instr", "ns/instr", "ns/instr");
+    for (size_t mb = 1;; mb *= 2)
+    {
+        std::string text;
+        CorpusGenerator(12345).generate(text, mb << 20);
+        Program p(std::move(text));
+        std::string name = std::to_string(mb) + " MB";
+        row(name.c_str(), p);
+        if (p.ir.code.size() >= target)
+            break;
+    }
+    std::string text;
+    CorpusGenerator(12345).generate_nested(text, 4 << 20, depth);
+    Program nested(std::move(text));
+    std::string name = "nested " + std::to_string(depth);
+    row(name.c_str(), nested);
+    return 0;
+}
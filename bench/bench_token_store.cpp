@@ -0,0 +1,101 @@
+// Token storage layout: array of Token structs against the columnar
+// TokenStore, on a generated program of the given size. Reports bytes per
+// token, then time and cache misses for a pass over the token kinds and for
+// a full parse fed from each layout.
+//
+//   ./bench_token_store [megabytes=64]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "corpus.hpp"
+#include "perf_counter.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
+#include "token_store.hpp"
+
+struct Sample
+{
+    double ms;
+    uint64_t misses;
+};
+
+template <class F>
+static Sample measure(PerfCounter &counter, F body)
+{
+    auto t0 = std::chrono::steady_clock::now();
+    counter.start();
+    body();
+    uint64_t misses = counter.stop();
+    auto t1 = std::chrono::steady_clock::now();
+    return {std::chrono::duration<double, std::milli>(t1 - t0).count(), misses};
+}
+
+static void report(const char *name, const Sample &s, size_t tokens, bool counted)
+{
+    std::printf("%-22s %9.2f ms  %7.2f ns/token", name, s.ms, s.ms * 1e6 / tokens);
+    if (counted)
+        std::printf("  %12llu cache misses  (%.3f/token)", (unsigned long long)s.misses,
+                    double(s.misses) / tokens);
+    std::printf("\n");
+}
+
+int main(int argc, char **argv)
+{
+    size_t mb = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 64;
+    std::string text;
+    CorpusGenerator(12345).generate(text, mb << 20);
+
+    Source source(text);
+    std::vector<Token> tokens = tokenize(source, best_simd_lexer());
+    TokenStore store(tokens);
+    const size_t n = tokens.size();
+
+    std::printf("%zu MB, %zu tokens\n", text.size() >> 20, n);
+    std::printf("array of Token        %6.2f bytes/token  (%zu MB)\n", double(sizeof(Token)),
+                sizeof(Token) * n >> 20);
+    std::printf("TokenStore            %6.2f bytes/token  (%zu MB)\n", double(store.bytes()) / n,
+                store.bytes() >> 20);
+
+    PerfCounter misses(PERF_COUNT_HW_CACHE_MISSES);
+    if (!misses.valid())
+        std::printf("(hardware counters unavailable: cache misses not reported)\n");
+
+    // Kind-only pass, the access pattern of a statement splitter or any
+    // scan that looks for particular tokens.
+    size_t found = 0;
+    Sample aos = measure(misses, [&] {
+        for (const Token &t : tokens)
+            found += t.type == TokenType::Semicolon || t.type == TokenType::LBrace;
+    });
+    Sample soa = measure(misses, [&] {
+        for (size_t i = 0; i < store.size(); ++i)
+            found += store.kind(i) == TokenType::Semicolon || store.kind(i) == TokenType::LBrace;
+    });
+    report("scan kinds: Token[]", aos, n, misses.valid());
+    report("scan kinds: TokenStore", soa, n, misses.valid());
+
+    // Full parse. The AoS source gets its own copy outside the timed region.
+    TokenArray copy(tokens);
+    Sample parse_aos = measure(misses, [&] {
+        Arena ast;
+        SymbolTable symbols(source.symbols);
+        Parser parser(std::move(copy), source, ast, symbols);
+        found += parser.get_root() != nullptr;
+    });
+    Sample parse_soa = measure(misses, [&] {
+        TokenStoreSource feed(store, source);
+        Arena ast;
+        SymbolTable symbols(source.symbols);
+        Parser parser(feed, source, ast, symbols);
+        found += parser.get_root() != nullptr;
+    });
+    report("parse: Token[]", parse_aos, n, misses.valid());
+    report("parse: TokenStore", parse_soa, n, misses.valid());
+
+    std::printf("(checksum %zu)\n", found);
+    return 0;
+}
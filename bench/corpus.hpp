@@ -0,0 +1,278 @@
+#pragma once
+// Synthetic, syntactically valid programs for the benchmarks.
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+// Program: a realistic mix of declarations, expressions, control flow,
+// prints and comments. The others stress one token class each while
+// staying valid programs.
+enum class Mix
+{
+    Program,
+    Identifiers,
+    Literals,
+    Comments,
+    Strings
+};
+
+inline const char *mix_name(Mix m)
+{
+    switch (m)
+    {
+        case Mix::Program: return "program";
+        case Mix::Identifiers: return "identifiers";
+        case Mix::Literals: return "literals";
+        case Mix::Comments: return "comments";
+        case Mix::Strings: return "strings";
+    }
+    return "?";
+}
+
+class CorpusGenerator
+{
+public:
+    explicit CorpusGenerator(uint32_t seed = 12345) : rng(seed) {}
+
+    // Appends top-level statements to `out` until it holds at least `bytes`.
+    void generate(std::string &out, size_t bytes, Mix mix = Mix::Program)
+    {
+        while (out.size() < bytes)
+        {
+            if (mix == Mix::Program || vars.size() < 8)
+                statement(out, 0);
+            else
+                skewed(out, mix);
+            out += '\n';
+        }
+    }
+
+    // Appends towers of `depth` nested if/while blocks, each level holding
+    // an assignment with a parenthesized expression, until `out` holds at
+    // least `bytes`. Stresses the recursion of the parser and tree walks.
+    void generate_nested(std::string &out, size_t bytes, int depth)
+    {
+        while (vars.size() < 8)
+        {
+            statement(out, 0);
+            out += '\n';
+        }
+        while (out.size() < bytes)
+        {
+            for (int d = 0; d < depth; ++d)
+            {
+                indent(out, d % 32);
+                out += d % 2 ? "while (" : "if (";
+                condition(out, 0);
+                out += ") {\n";
+                indent(out, d % 32);
+                out += vars[rng() % vars.size()];
+                out += " = (";
+                expression(out, 1);
+                out += ") * ";
+                operand(out);
+                out += ";\n";
+            }
+            for (int d = depth; d-- > 0;)
+            {
+                indent(out, d % 32);
+                out += "}\n";
+            }
+        }
+    }
+
+private:
+    void skewed(std::string &out, Mix mix)
+    {
+        static const char *words[] = {"lorem", "ipsum", "dolor", "sit", "amet", "while", "if",
+                                      "x = 1;", "\\n", "#", "42", "cout", "<<", "&&"};
+        unsigned r = rng() % 100;
+        switch (mix)
+        {
+        case Mix::Identifiers:
+            if (r < 5)
+                statement(out, 0);
+            else
+            {
+                out += vars[rng() % vars.size()];
+                out += " = ";
+                for (unsigned n = 2 + rng() % 5; n; --n)
+                {
+                    out += vars[rng() % vars.size()];
+                    out += n > 1 ? (rng() % 2 ? " + " : " * ") : ";";
+                }
+            }
+            break;
+        case Mix::Literals:
+            out += vars[rng() % vars.size()];
+            out += " = ";
+            for (unsigned n = 2 + rng() % 5; n; --n)
+            {
+                out += std::to_string(rng() % 1000000000);
+                out += n > 1 ? (rng() % 2 ? " + " : " - ") : ";";
+            }
+            break;
+        case Mix::Comments:
+            if (r < 15)
+                statement(out, 0);
+            else
+            {
+                out += "# ";
+                for (unsigned n = 4 + rng() % 12; n; --n)
+                {
+                    out += words[rng() % (sizeof(words) / sizeof(words[0]))];
+                    out += ' ';
+                }
+            }
+            break;
+        case Mix::Strings:
+            if (r < 10)
+                statement(out, 0);
+            else
+            {
+                out += "cout << \"";
+                for (unsigned n = 3 + rng() % 12; n; --n)
+                {
+                    out += words[rng() % (sizeof(words) / sizeof(words[0]))];
+                    out += ' ';
+                }
+                out += "\";";
+            }
+            break;
+        case Mix::Program:
+            statement(out, 0);
+            break;
+        }
+    }
+
+    void indent(std::string &out, int depth) { out.append(size_t(depth) * 2, ' '); }
+
+    void operand(std::string &out)
+    {
+        if (vars.empty() || rng() % 2)
+            out += std::to_string(rng() % 100000);
+        else
+            out += vars[rng() % vars.size()];
+    }
+
+    void expression(std::string &out, int depth)
+    {
+        unsigned r = rng() % 100;
+        if (depth > 3 || r < 35)
+            operand(out);
+        else if (r < 45)
+        {
+            out += '(';
+            expression(out, depth + 1);
+            out += ')';
+        }
+        else
+        {
+            static const char *ops[] = {" + ", " - ", " * ", " / "};
+            expression(out, depth + 1);
+            out += ops[rng() % 4];
+            expression(out, depth + 1);
+        }
+    }
+
+    void condition(std::string &out, int depth)
+    {
+        static const char *cmps[] = {" == ", " != ", " < ", " > "};
+        unsigned r = rng() % 100;
+        if (depth > 2 || r < 60)
+        {
+            if (r < 10)
+                out += '!';
+            expression(out, 2);
+            out += cmps[rng() % 4];
+            expression(out, 2);
+            return;
+        }
+        condition(out, depth + 1);
+        out += rng() % 2 ? " && " : " || ";
+        condition(out, depth + 1);
+    }
+
+    void block(std::string &out, int depth)
+    {
+        out += " {\n";
+        for (unsigned n = rng() % 5; n; --n)
+        {
+            statement(out, depth + 1);
+            out += '\n';
+        }
+        indent(out, depth);
+        out += '}';
+    }
+
+    void statement(std::string &out, int depth)
+    {
+        static const char *suffixes[] = {"a", "bb", "x_y", "Z9", "counter", "total_value"};
+        static const char *strings[] = {"hi", "a b c", "x\\ty", "#notcomment", "if while"};
+        unsigned r = rng() % 100;
+        indent(out, depth);
+        if (r < 12 || vars.empty())
+        {
+            std::string name = "v" + std::to_string(vars.size()) + "_" + suffixes[rng() % 6];
+            out += rng() % 3 ? "int " : "string ";
+            out += name;
+            out += ';';
+            vars.push_back(std::move(name));
+        }
+        else if (r < 45)
+        {
+            out += vars[rng() % vars.size()];
+            out += " = ";
+            expression(out, 0);
+            out += ';';
+        }
+        else if (r < 55)
+        {
+            out += "cout << \"";
+            out += strings[rng() % 5];
+            out += "\";";
+        }
+        else if (r < 62)
+        {
+            out += "cout << ";
+            expression(out, 0);
+            out += ';';
+        }
+        else if (r < 70)
+        {
+            out += "# comment ";
+            out += std::to_string(rng());
+        }
+        else if (depth < 3 && r < 85)
+        {
+            out += "if (";
+            condition(out, 0);
+            out += ')';
+            block(out, depth);
+            if (rng() % 2)
+            {
+                out += " else";
+                block(out, depth);
+            }
+        }
+        else if (depth < 3)
+        {
+            out += "while (";
+            condition(out, 0);
+            out += ')';
+            block(out, depth);
+        }
+        else
+        {
+            out += vars[rng() % vars.size()];
+            out += " = ";
+            expression(out, 0);
+            out += ';';
+        }
+    }
+
+    std::mt19937 rng;
+    std::vector<std::string> vars;
+};
@@ -0,0 +1,34 @@
+#pragma once
+// A program compiled to IR for the benchmarks of the passes that work on
+// it: lexed, put in a TokenStore and parsed in a single pass, without an
+// AST, as the compiler does with --single-pass.
+
+#include <string>
+#include <vector>
+
+#include "ir.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
+#include "token_store.hpp"
+
+struct Program
+{
+    std::string text;
+    Source source;
+    SymbolTable symbols;
+    InterCodeArray ir;
+    size_t whiles{0}; // while loops in the source
+
+    explicit Program(std::string program) : text(std::move(program)), source(text), symbols(source.symbols)
+    {
+        std::vector<Token> tokens = tokenize(source, best_simd_lexer());
+        for (const Token &t : tokens)
+            whiles += t.type == TokenType::While;
+        TokenStore store(tokens);
+        std::vector<Token>().swap(tokens);
+        TokenStoreSource feed(store, source);
+        IntermediateCodeGen irgen(source, symbols);
+        Parser(feed, source, irgen, symbols).parse();
+        ir = irgen.take().code;
+    }
+};
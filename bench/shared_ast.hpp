@@ -0,0 +1,163 @@
+#pragma once
+// The AST as it was before the arena and the kind tag: polymorphic nodes,
+// one make_shared allocation each, told apart with dynamic_pointer_cast.
+// The benchmarks copy a parsed tree into it to compare against.
+
+#include <memory>
+#include <vector>
+
+#include "ast.hpp"
+
+namespace shared_ast
+{
+struct Node
+{
+    virtual ~Node() = default;
+};
+struct NumberNode : Node
+{
+    Token tok;
+    int64_t value{0};
+};
+struct IdentifierNode : Node
+{
+    Token tok;
+};
+struct BinOpNode : Node
+{
+    std::shared_ptr<Node> left;
+    Token op_tok;
+    std::shared_ptr<Node> right;
+};
+struct UnaryOpNode : Node
+{
+    Token op_tok;
+    std::shared_ptr<Node> operand;
+};
+struct AssignmentNode : Node
+{
+    Token identifier;
+    std::shared_ptr<Node> expression;
+};
+struct BlockNode : Node
+{
+    std::vector<std::shared_ptr<Node>> statements;
+};
+struct IfNode : Node
+{
+    std::shared_ptr<Node> condition, then_branch, else_branch;
+};
+struct WhileNode : Node
+{
+    std::shared_ptr<Node> condition, body;
+};
+struct PrintNode : Node
+{
+    std::shared_ptr<Node> value;
+};
+struct DeclarationNode : Node
+{
+    ValueType var_type;
+    Token identifier;
+};
+
+// Copies `n`, allocating in pre-order like the parser does; counts the
+// nodes in `count`.
+inline std::shared_ptr<Node> clone(const ::Node *n, size_t &count)
+{
+    if (!n)
+        return nullptr;
+    ++count;
+    switch (n->kind)
+    {
+    case NodeKind::Number:
+    {
+        auto x = static_cast<const ::NumberNode *>(n);
+        auto c = std::make_shared<NumberNode>();
+        c->tok = x->tok;
+        c->value = x->value;
+        return c;
+    }
+    case NodeKind::Identifier:
+    {
+        auto c = std::make_shared<IdentifierNode>();
+        c->tok = static_cast<const ::IdentifierNode *>(n)->tok;
+        return c;
+    }
+    case NodeKind::BinOp:
+    {
+        auto x = static_cast<const ::BinOpNode *>(n);
+        auto c = std::make_shared<BinOpNode>();
+        c->op_tok = x->op_tok;
+        c->left = clone(x->left, count);
+        c->right = clone(x->right, count);
+        return c;
+    }
+    case NodeKind::UnaryOp:
+    {
+        auto x = static_cast<const ::UnaryOpNode *>(n);
+        auto c = std::make_shared<UnaryOpNode>();
+        c->op_tok = x->op_tok;
+        c->operand = clone(x->operand, count);
+        return c;
+    }
+    case NodeKind::Assignment:
+    {
+        auto x = static_cast<const ::AssignmentNode *>(n);
+        auto c = std::make_shared<AssignmentNode>();
+        c->identifier = x->identifier;
+        c->expression = clone(x->expression, count);
+        return c;
+    }
+    case NodeKind::Block:
+    {
+        auto c = std::make_shared<BlockNode>();
+        for (const ::Node *st : static_cast<const ::BlockNode *>(n)->statements)
+            c->statements.push_back(clone(st, count));
+        return c;
+    }
+    case NodeKind::Program:
+    {
+        auto c = std::make_shared<BlockNode>();
+        for (const ::Node *st : static_cast<const ::ProgramNode *>(n)->statements)
+            c->statements.push_back(clone(st, count));
+        return c;
+    }
+    case NodeKind::If:
+    {
+        auto x = static_cast<const ::IfNode *>(n);
+        auto c = std::make_shared<IfNode>();
+        c->condition = clone(x->condition, count);
+        c->then_branch = clone(x->then_branch, count);
+        c->else_branch = clone(x->else_branch, count);
+        return c;
+    }
+    case NodeKind::While:
+    {
+        auto x = static_cast<const ::WhileNode *>(n);
+        auto c = std::make_shared<WhileNode>();
+        c->condition = clone(x->condition, count);
+        c->body = clone(x->body, count);
+        return c;
+    }
+    case NodeKind::Print:
+    {
+        auto c = std::make_shared<PrintNode>();
+        c->value = clone(static_cast<const ::PrintNode *>(n)->value, count);
+        return c;
+    }
+    case NodeKind::Declaration:
+    {
+        auto x = static_cast<const ::DeclarationNode *>(n);
+        auto c = std::make_shared<DeclarationNode>();
+        c->var_type = x->var_type;
+        c->identifier = x->identifier;
+        return c;
+    }
+    default:
+        // The flat layout's markers; no Node has them.
+        break;
+    }
+    return nullptr;
+}
+}
@@ -0,0 +1,150 @@
+#pragma once
+// The IR as it was before the compact instruction array: polymorphic
+// instructions, one make_shared allocation each, with operators and labels
+// kept as strings and operands that carry their immediate inline. The
+// benchmarks copy generated IR into it to compare against.
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ir.hpp"
+
+namespace shared_ir
+{
+enum class IRKind
+{
+    Assignment,
+    Jump,
+    Label,
+    Compare,
+    Print
+};
+
+struct IROperand
+{
+    uint32_t sym{SymbolTable::none};
+    int64_t imm{0};
+    bool is_imm{false};
+};
+
+struct IRInstr
+{
+    virtual ~IRInstr() = default;
+    virtual IRKind kind() const = 0;
+};
+
+struct AssignmentCode : IRInstr
+{
+    uint32_t var;
+    IROperand left;
+    std::string op;
+    IROperand right;
+    IRKind kind() const override { return IRKind::Assignment; }
+};
+
+struct JumpCode : IRInstr
+{
+    std::string dist;
+    IRKind kind() const override { return IRKind::Jump; }
+};
+
+struct LabelCode : IRInstr
+{
+    std::string label;
+    IRKind kind() const override { return IRKind::Label; }
+};
+
+struct CompareCodeIR : IRInstr
+{
+    IROperand left;
+    std::string operation;
+    IROperand right;
+    std::string jump;
+    IRKind kind() const override { return IRKind::Compare; }
+};
+
+struct PrintCodeIR : IRInstr
+{
+    std::string type;
+    IROperand value;
+    IRKind kind() const override { return IRKind::Print; }
+};
+
+using InterCodeArray = std::vector<std::shared_ptr<IRInstr>>;
+
+inline IROperand operand(const ::InterCodeArray &arr, ::IROperand o)
+{
+    IROperand x;
+    if (o.is_imm())
+    {
+        x.imm = arr.value(o);
+        x.is_imm = true;
+    }
+    else
+        x.sym = o.id();
+    return x;
+}
+
+// Copies `arr` instruction by instruction, as the IR generator used to
+// build it, into an array of the right size.
+inline InterCodeArray clone(const ::InterCodeArray &arr)
+{
+    InterCodeArray out;
+    out.reserve(arr.code.size());
+    for (const ::IRInstr &ins : arr.code)
+    {
+        switch (ins.op)
+        {
+        case IROp::Copy:
+        case IROp::Add:
+        case IROp::Sub:
+        case IROp::Mul:
+        case IROp::Div:
+        {
+            auto a = std::make_shared<AssignmentCode>();
+            a->var = ins.dst.id();
+            a->left = operand(arr, ins.a);
+            a->op = ir_op_spelling(ins.op);
+            a->right = operand(arr, ins.b);
+            out.push_back(a);
+            break;
+        }
+        case IROp::Label:
+        {
+            auto l = std::make_shared<LabelCode>();
+            l->label = ir_label(ins.dst);
+            out.push_back(l);
+            break;
+        }
+        case IROp::Jump:
+        {
+            auto j = std::make_shared<JumpCode>();
+            j->dist = ir_label(ins.dst);
+            out.push_back(j);
+            break;
+        }
+        case IROp::PrintInt:
+        case IROp::PrintString:
+        {
+            auto p = std::make_shared<PrintCodeIR>();
+            p->type = ins.op == IROp::PrintString ? "string" : "int";
+            p->value = operand(arr, ins.a);
+            out.push_back(p);
+            break;
+        }
+        default:
+        {
+            auto c = std::make_shared<CompareCodeIR>();
+            c->left = operand(arr, ins.a);
+            c->operation = ir_op_spelling(ins.op);
+            c->right = operand(arr, ins.b);
+            c->jump = ir_label(ins.dst);
+            out.push_back(c);
+            break;
+        }
+        }
+    }
+    return out;
+}
+}
@@ -0,0 +1,25 @@
+#pragma once
+// Wall-clock timing for the benchmarks.
+
+#include <algorithm>
+#include <chrono>
+
+// Milliseconds `body` takes.
+template <class F>
+inline double ms(F body)
+{
+    auto t0 = std::chrono::steady_clock::now();
+    body();
+    auto t1 = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(t1 - t0).count();
+}
+
+// Best of three runs, in milliseconds.
+template <class F>
+inline double best_ms(F body)
+{
+    double best = 1e300;
+    for (int rep = 0; rep < 3; ++rep)
+        best = std::min(best, ms(body));
+    return best;
+}
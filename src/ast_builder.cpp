@@ -0,0 +1,85 @@
+#include "ast_builder.hpp"
+
+void TreeBuilder::number(Token tok, int64_t value)
+{
+    stack.push_back(arena.make<NumberNode>(tok, value));
+}
+
+void TreeBuilder::string_literal(Token tok)
+{
+    stack.push_back(arena.make<NumberNode>(tok));
+}
+
+void TreeBuilder::identifier(Token tok, uint32_t symbol)
+{
+    stack.push_back(arena.make<IdentifierNode>(tok, symbol));
+}
+
+void TreeBuilder::unary(Token op)
+{
+    auto node = arena.make<BinOpNode>();
+    node->op_tok = op;
+    node->right = pop();
+    stack.push_back(node);
+}
+
+void TreeBuilder::binary(Token op)
+{
+    auto node = arena.make<BinOpNode>();
+    node->op_tok = op;
+    node->right = pop();
+    node->left = pop();
+    stack.push_back(node);
+}
+
+void TreeBuilder::declaration(ValueType type, Token identifier, uint32_t symbol)
+{
+    auto node = arena.make<DeclarationNode>();
+    node->var_type = type;
+    node->identifier = identifier;
+    node->symbol = symbol;
+    stack.push_back(node);
+}
+
+void TreeBuilder::assignment(Token identifier, uint32_t symbol)
+{
+    auto node = arena.make<AssignmentNode>();
+    node->identifier = identifier;
+    node->symbol = symbol;
+    node->expression = pop();
+    stack.push_back(node);
+}
+
+void TreeBuilder::print()
+{
+    auto node = arena.make<PrintNode>();
+    node->value = pop();
+    stack.push_back(node);
+}
+
+void TreeBuilder::block(uint32_t count)
+{
+    auto node = arena.make<BlockNode>();
+    node->statements.count = count;
+    node->statements.items = arena.copy(stack.data() + stack.size() - count, count);
+    stack.resize(stack.size() - count);
+    stack.push_back(node);
+}
+
+void TreeBuilder::if_statement(bool has_else)
+{
+    auto node = arena.make<IfNode>();
+    if (has_else)
+        node->else_branch = pop();
+    node->then_branch = pop();
+    node->condition = pop();
+    stack.push_back(node);
+}
+
+void TreeBuilder::while_statement()
+{
+    auto node = arena.make<WhileNode>();
+    node->body = pop();
+    node->condition = pop();
+    stack.push_back(node);
+}
@@ -0,0 +1,74 @@
+#include "cfg.hpp"
+#include <stdexcept>
+
+static bool is_jump(IROp op) { return op == IROp::Jump || is_compare(op); }
+
+ControlFlowGraph::ControlFlowGraph(const InterCodeArray &ir)
+{
+    const std::vector<IRInstr> &code = ir.code;
+    const uint32_t size = static_cast<uint32_t>(code.size());
+
+    starts.push_back(0);
+    for (uint32_t i = 0; i < size; ++i)
+    {
+        if (code[i].op == IROp::Label && i != starts.back())
+            starts.push_back(i);
+        if (is_jump(code[i].op) && i + 1 < size)
+            starts.push_back(i + 1);
+    }
+    const uint32_t blocks = static_cast<uint32_t>(starts.size());
+    starts.push_back(size); // the exit
+    starts.push_back(size);
+
+    label_blocks.assign(ir.labels, none);
+    for (uint32_t b = 0; b < blocks; ++b)
+        if (starts[b] < size && code[starts[b]].op == IROp::Label)
+            label_blocks[code[starts[b]].dst.id()] = b;
+
+    auto target = [&](const IRInstr &jump) {
+        if (jump.dst.kind() != OperandKind::Label || label_blocks[jump.dst.id()] == none)
+            throw std::runtime_error("CFG: jump to a label that is not placed");
+        return label_blocks[jump.dst.id()];
+    };
+
+    succ.reserve(size_t(blocks) + blocks / 2);
+    succ_at.reserve(size_t(blocks) + 2);
+    for (uint32_t b = 0; b < blocks; ++b)
+    {
+        succ_at.push_back(static_cast<uint32_t>(succ.size()));
+        const uint32_t next = b + 1; // the exit after the last block
+        if (begin(b) == end(b))
+        {
+            succ.push_back(next);
+            continue;
+        }
+        const IRInstr &last = code[end(b) - 1];
+        if (last.op == IROp::Jump)
+            succ.push_back(target(last));
+        else if (is_compare(last.op))
+        {
+            const uint32_t t = target(last);
+            succ.push_back(t);
+            if (t != next)
+                succ.push_back(next);
+        }
+        else
+            succ.push_back(next);
+    }
+    succ_at.push_back(static_cast<uint32_t>(succ.size())); // the exit has none
+    succ_at.push_back(static_cast<uint32_t>(succ.size()));
+
+    // Predecessors by counting sort of the edges on their target, so that
+    // each block's predecessors are in increasing order.
+    const uint32_t n = this->size();
+    pred_at.assign(size_t(n) + 1, 0);
+    for (uint32_t s : succ)
+        ++pred_at[s + 1];
+    for (uint32_t b = 0; b < n; ++b)
+        pred_at[b + 1] += pred_at[b];
+    pred.resize(succ.size());
+    std::vector<uint32_t> fill(pred_at.begin(), pred_at.end() - 1);
+    for (uint32_t b = 0; b < n; ++b)
+        for (uint32_t s : successors(b))
+            pred[fill[s]++] = b;
+}
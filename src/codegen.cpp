@@ -1,42 +1,40 @@
 #include "codegen.hpp"
 #include <fstream>
 #include <cstdlib>
-#include <cctype>
+#include <cstdint>
 
-static bool is_int_literal(const std::string &s)
+// Immediates that most instructions accept in place of a register: a 32-bit
+// field sign-extended to 64 bits.
+static bool fits_imm32(int64_t v)
 {
-    if (s.empty()) return false;
-    size_t i = 0;
-    if (s[0] == '-' || s[0] == '+') i = 1;
-    if (i >= s.size()) return false;
-    for (; i < s.size(); ++i) if (!std::isdigit(static_cast<unsigned char>(s[i]))) return false;
-    return true;
+    return v >= INT32_MIN && v <= INT32_MAX;
 }
 
-static std::string op_to_asm(const std::string &op)
+static const char *op_to_asm(IROp op)
 {
-    if (op == "+") return "add";
-    if (op == "-") return "sub";
-    if (op == "*") return "imul";
-    return "";
+    switch (op)
+    {
+    case IROp::Add: return "add";
+    case IROp::Sub: return "sub";
+    default: return "imul";
+    }
 }
 
-static std::string cmp_to_jmp(const std::string &c)
+static const char *cmp_to_jmp(IROp op)
 {
-    if (c == "<")  return "jl";
-    if (c == "<=") return "jle";
-    if (c == ">")  return "jg";
-    if (c == ">=") return "jge";
-    if (c == "==") return "je";
-    if (c == "!=") return "jne";
-    return "";
+    switch (op)
+    {
+    case IROp::JumpLt: return "jl";
+    case IROp::JumpLe: return "jle";
+    case IROp::JumpGt: return "jg";
+    case IROp::JumpGe: return "jge";
+    case IROp::JumpEq: return "je";
+    default: return "jne";
+    }
 }
 
-CodeGenerator::CodeGenerator(const InterCodeArray &arr,
-                             const std::unordered_map<std::string, std::string> &identifiers,
-                             const std::unordered_map<std::string, std::string> &constants,
-                             const std::unordered_map<std::string, std::string> &tempmap)
-    : arr(arr), ids(identifiers), consts(constants), tempmap(tempmap) {}
+CodeGenerator::CodeGenerator(GeneratedIR ir, const SymbolTable &symbols)
+    : arr(std::move(ir.code)), symbols(symbols) {}
 
 void CodeGenerator::pr(const std::string &s)
 {
@@ -44,12 +42,40 @@ void CodeGenerator::pr(const std::string &s)
     out.push_back('\n');
 }
 
-std::string CodeGenerator::handleVar(const std::string &a,
-                                     const std::unordered_map<std::string, std::string> &tempmap)
+// Assembly name of a variable, temporary or string constant: temporaries
+// are "__tmp1", the others keep their IR name.
+std::string CodeGenerator::name(IROperand o) const
+{
+    if (o.kind() == OperandKind::Temp)
+        return "__tmp" + std::to_string(o.id() + 1);
+    return arr.str(o, symbols);
+}
+
+std::string CodeGenerator::operand(IROperand o) const
+{
+    if (o.is_imm())
+        return std::to_string(arr.value(o));
+    return "qword [" + name(o) + "]";
+}
+
+// Loads `o` into the 64-bit register `reg` (rax, rbx or rdi) with the
+// shortest encoding: writes to the 32-bit half clear the upper half, so
+// zero and unsigned 32-bit values need no REX prefix or imm64.
+void CodeGenerator::load(const std::string &reg, IROperand o)
 {
-    auto it = tempmap.find(a);
-    if (it != tempmap.end()) return it->second;
-    return a;
+    const std::string low = "e" + reg.substr(1);
+    if (!o.is_imm())
+    {
+        pr("\tmov " + reg + ", " + operand(o));
+        return;
+    }
+    const int64_t v = arr.value(o);
+    if (v == 0)
+        pr("\txor " + low + ", " + low);
+    else if (v > 0 && v <= int64_t(UINT32_MAX))
+        pr("\tmov " + low + ", " + std::to_string(v));
+    else
+        pr("\tmov " + reg + ", " + std::to_string(v));
 }
 
 void CodeGenerator::gen_variables()
@@ -62,21 +88,22 @@ void CodeGenerator::gen_variables()
         pr("");
     }
 
-    for (auto &kv : ids)
-        pr("\t" + kv.first + " resq 1");
+    for (uint32_t id = 0; id < symbols.size(); ++id)
+        if (symbols[id].declared)
+            pr("\t" + name(IROperand::variable(id)) + " resq 1");
 
-    for (auto &kv : tempmap)
-        pr("\t" + kv.second + " resq 1");
+    for (uint32_t id = 0; id < symbols.temps(); ++id)
+        pr("\t" + name(IROperand::temp(id)) + " resq 1");
 }
 
 void CodeGenerator::gen_start()
 {
     pr("section .data");
-    for (auto &kv : consts)
+    for (uint32_t id = 0; id < symbols.strings(); ++id)
     {
-
-        pr("\t" + kv.first + " db \"" + kv.second + "\",10");
-        pr("\t" + kv.first + "_len equ $-" + kv.first);
+        const auto s = name(IROperand::string(id));
+        pr("\t" + s + " db \"" + std::string(symbols.string_text(id)) + "\",10");
+        pr("\t" + s + "_len equ $-" + s);
     }
     pr("");
     pr("section .text");
@@ -85,113 +112,108 @@ void CodeGenerator::gen_start()
     pr("_start:");
 }
 
-void CodeGenerator::gen_assignment(const AssignmentCode &a)
+// An operand that most instructions accept as it is: memory, or an
+// immediate that fits in imm32.
+static bool direct(const InterCodeArray &arr, IROperand o)
+{
+    return !o.is_imm() || fits_imm32(arr.value(o));
+}
+
+void CodeGenerator::gen_assignment(const IRInstr &a)
 {
-    const auto dst = handleVar(a.var, tempmap);
+    const auto dst = name(a.dst);
 
-    if (a.op.empty())
+    if (a.op == IROp::Copy)
     {
-            if (is_int_literal(a.left)) pr("\tmov rax, " + a.left);
-    else pr("\tmov rax, qword [" + handleVar(a.left, tempmap) + "]");
+        if (a.a.is_imm() && fits_imm32(arr.value(a.a)))
+        {
+            pr("\tmov qword [" + dst + "], " + std::to_string(arr.value(a.a)));
+            return;
+        }
+        load("rax", a.a);
         pr("\tmov qword [" + dst + "], rax");
         return;
     }
 
-        if (is_int_literal(a.left)) pr("\tmov rax, " + a.left);
-    else pr("\tmov rax, qword [" + handleVar(a.left, tempmap) + "]");
+    load("rax", a.a);
 
-    if (a.op == "/" || a.op == "%")
+    if (a.op == IROp::Div)
     {
-            if (is_int_literal(a.right)) pr("\tmov rbx, " + a.right);
-    else pr("\tmov rbx, qword [" + handleVar(a.right, tempmap) + "]");
+        load("rbx", a.b);
         pr("\tcqo");
         pr("\tidiv rbx");
-        if (a.op == "%")
-            pr("\tmov qword [" + dst + "], rdx");
-        else
-            pr("\tmov qword [" + dst + "], rax");
+        pr("\tmov qword [" + dst + "], rax");
         return;
     }
 
-    const auto ins = op_to_asm(a.op);
-        if (is_int_literal(a.right)) pr("\tmov rbx, " + a.right);
-    else pr("\tmov rbx, qword [" + handleVar(a.right, tempmap) + "]");
-    if (ins.empty())
+    // add, sub and imul all take the right operand straight from memory or
+    // as a sign-extended imm32.
+    const std::string ins = op_to_asm(a.op);
+    if (direct(arr, a.b))
+        pr("\t" + ins + " rax, " + operand(a.b));
+    else
     {
-        pr("\t; unsupported op '" + a.op + "'");
-        pr("\tmov qword [" + dst + "], rax");
-        return;
+        load("rbx", a.b);
+        pr("\t" + ins + " rax, rbx");
     }
-    pr("\t" + ins + " rax, rbx");
     pr("\tmov qword [" + dst + "], rax");
 }
 
-void CodeGenerator::gen_jump(const JumpCode &j)
-{
-    pr("\tjmp " + j.dist);
-}
-
-void CodeGenerator::gen_label(const LabelCode &l)
+void CodeGenerator::gen_compare(const IRInstr &c)
 {
-    pr(l.label + ":");
-}
-
-void CodeGenerator::gen_compare(const CompareCodeIR &c)
-{
-    const auto jmp = cmp_to_jmp(c.operation);
-    if (jmp.empty())
+    load("rax", c.a);
+    if (c.b.is_imm() && arr.value(c.b) == 0)
+        pr("\ttest rax, rax");
+    else if (direct(arr, c.b))
+        pr("\tcmp rax, " + operand(c.b));
+    else
     {
-        pr("\t; unsupported compare '" + c.operation + "'");
-        return;
+        load("rbx", c.b);
+        pr("\tcmp rax, rbx");
     }
-
-        if (is_int_literal(c.left)) pr("\tmov rax, " + c.left);
-    else pr("\tmov rax, qword [" + handleVar(c.left, tempmap) + "]");
-        if (is_int_literal(c.right)) pr("\tmov rbx, " + c.right);
-    else pr("\tmov rbx, qword [" + handleVar(c.right, tempmap) + "]");
-    pr("\tcmp rax, rbx");
-    pr("\t" + jmp + " " + c.jump);
+    pr("\t" + std::string(cmp_to_jmp(c.op)) + " " + ir_label(c.dst));
 }
 
-void CodeGenerator::gen_print(const PrintCodeIR &p)
+void CodeGenerator::gen_print(const IRInstr &p)
 {
-    if (p.type == "string")
+    if (p.op == IROp::PrintString)
     {
-        need_print_string = true;
-        pr("\tmov rsi, " + p.value);
-        pr("\tmov rdx, " + p.value + "_len");
+        const auto s = name(p.a);
+        pr("\tmov rsi, " + s);
+        pr("\tmov rdx, " + s + "_len");
         pr("\tcall print_string");
         return;
     }
 
-    need_print_num = true;
-    if (is_int_literal(p.value))
-        pr("\tmov rdi, " + p.value);
-    else
-        pr("\tmov rdi, qword [" + handleVar(p.value, tempmap) + "]");
+    load("rdi", p.a);
     pr("\tcall print_num");
 }
 
 void CodeGenerator::gen_code()
 {
-    for (auto &ins : arr.code)
+    for (const IRInstr &ins : arr.code)
     {
-        switch (ins->kind())
+        switch (ins.op)
         {
-        case IRKind::Assignment:
-            gen_assignment(*std::static_pointer_cast<AssignmentCode>(ins));
+        case IROp::Copy:
+        case IROp::Add:
+        case IROp::Sub:
+        case IROp::Mul:
+        case IROp::Div:
+            gen_assignment(ins);
             break;
-        case IRKind::Jump:
-            gen_jump(*std::static_pointer_cast<JumpCode>(ins));
+        case IROp::Label:
+            pr(ir_label(ins.dst) + ":");
             break;
-        case IRKind::Label:
-            gen_label(*std::static_pointer_cast<LabelCode>(ins));
+        case IROp::Jump:
+            pr("\tjmp " + ir_label(ins.dst));
             break;
-        case IRKind::Compare:
-            gen_compare(*std::static_pointer_cast<CompareCodeIR>(ins));
+        case IROp::PrintInt:
+        case IROp::PrintString:
+            gen_print(ins);
             break;
-        case IRKind::Print:
-            gen_print(*std::static_pointer_cast<PrintCodeIR>(ins));
+        default:
+            gen_compare(ins);
             break;
         }
     }
@@ -289,16 +311,12 @@ void CodeGenerator::writeAsm(const std::string &path)
 {
     out.clear();
 
-    for (auto &ins : arr.code)
+    for (const IRInstr &ins : arr.code)
     {
-        if (ins->kind() == IRKind::Print)
-        {
-            auto print_ins = std::static_pointer_cast<PrintCodeIR>(ins);
-            if (print_ins->type == "string")
-                need_print_string = true;
-            else
-                need_print_num = true;
-        }
+        if (ins.op == IROp::PrintString)
+            need_print_string = true;
+        else if (ins.op == IROp::PrintInt)
+            need_print_num = true;
     }
 
     gen_variables();
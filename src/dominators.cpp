@@ -0,0 +1,159 @@
+#include "dominators.hpp"
+
+DominatorTree::DominatorTree(const ControlFlowGraph &cfg, Direction direction)
+{
+    const bool forward = direction == Direction::Forward;
+    const uint32_t n = cfg.size();
+    root_block = forward ? cfg.entry() : cfg.exit();
+    auto next = [&](uint32_t b) { return forward ? cfg.successors(b) : cfg.predecessors(b); };
+    auto prev = [&](uint32_t b) { return forward ? cfg.predecessors(b) : cfg.successors(b); };
+
+    // Post-order of the blocks the root reaches. The walk keeps its path on
+    // a heap stack, each entry with the number of its edges already taken.
+    std::vector<uint32_t> post;
+    std::vector<uint32_t> number(n, none); // post-order number
+    {
+        struct Step
+        {
+            uint32_t block;
+            uint32_t edge;
+        };
+        std::vector<uint8_t> seen(n, 0);
+        std::vector<Step> path{{root_block, 0}};
+        seen[root_block] = 1;
+        post.reserve(n);
+        while (!path.empty())
+        {
+            Step &at = path.back();
+            BlockList out = next(at.block);
+            if (at.edge < out.size())
+            {
+                uint32_t b = out[at.edge++];
+                if (!seen[b])
+                {
+                    seen[b] = 1;
+                    path.push_back(Step{b, 0});
+                }
+                continue;
+            }
+            number[at.block] = static_cast<uint32_t>(post.size());
+            post.push_back(at.block);
+            path.pop_back();
+        }
+    }
+
+    // The algorithm proper works on post-order numbers: the root has the
+    // highest, and walking up the tree only ever increases them.
+    const uint32_t m = static_cast<uint32_t>(post.size());
+    std::vector<uint32_t> doms(m, none);
+    doms[m - 1] = m - 1;
+    auto intersect = [&](uint32_t a, uint32_t b) {
+        while (a != b)
+        {
+            while (a < b)
+                a = doms[a];
+            while (b < a)
+                b = doms[b];
+        }
+        return a;
+    };
+    for (bool changed = true; changed;)
+    {
+        changed = false;
+        ++passes;
+        for (uint32_t k = m - 1; k-- > 0;)
+        {
+            uint32_t idom = none;
+            for (uint32_t p : prev(post[k]))
+            {
+                uint32_t q = number[p];
+                if (q == none || doms[q] == none)
+                    continue;
+                idom = idom == none ? q : intersect(q, idom);
+            }
+            if (doms[k] != idom)
+            {
+                doms[k] = idom;
+                changed = true;
+            }
+        }
+    }
+
+    idoms.assign(n, none);
+    for (uint32_t k = 0; k + 1 < m; ++k)
+        idoms[post[k]] = post[doms[k]];
+    rpo.assign(post.rbegin(), post.rend());
+
+    // Children, then enter and leave times of a walk of the tree.
+    kids_at.assign(size_t(n) + 1, 0);
+    for (uint32_t b = 0; b < n; ++b)
+        if (idoms[b] != none)
+            ++kids_at[idoms[b] + 1];
+    for (uint32_t b = 0; b < n; ++b)
+        kids_at[b + 1] += kids_at[b];
+    kids.resize(kids_at[n]);
+    {
+        std::vector<uint32_t> fill(kids_at.begin(), kids_at.end() - 1);
+        for (uint32_t b : rpo)
+            if (idoms[b] != none)
+                kids[fill[idoms[b]]++] = b;
+    }
+
+    enter.assign(n, 0);
+    leave.assign(n, 0);
+    uint32_t clock = 0;
+    std::vector<std::pair<uint32_t, uint32_t>> path{{root_block, 0}};
+    enter[root_block] = clock++;
+    while (!path.empty())
+    {
+        auto &[b, k] = path.back();
+        BlockList c = children(b);
+        if (k < c.size())
+        {
+            uint32_t child = c[k++];
+            enter[child] = clock++;
+            path.emplace_back(child, 0);
+            continue;
+        }
+        leave[b] = clock++;
+        path.pop_back();
+    }
+}
+
+DominanceFrontier::DominanceFrontier(const ControlFlowGraph &cfg, const DominatorTree &dom)
+{
+    const uint32_t n = cfg.size();
+    // (block, join) pairs, each once: the walks up from the predecessors of
+    // one join can meet, and `last` remembers which join a block was last
+    // given.
+    std::vector<std::pair<uint32_t, uint32_t>> pairs;
+    std::vector<uint32_t> last(n, DominatorTree::none);
+    for (uint32_t b : dom.order())
+    {
+        BlockList preds = cfg.predecessors(b);
+        if (preds.size() < 2)
+            continue;
+        for (uint32_t p : preds)
+        {
+            if (!dom.reachable(p))
+                continue;
+            for (uint32_t x = p; x != DominatorTree::none && x != dom.idom(b); x = dom.idom(x))
+            {
+                if (last[x] == b)
+                    break;
+                last[x] = b;
+                pairs.emplace_back(x, b);
+            }
+        }
+    }
+
+    at.assign(size_t(n) + 1, 0);
+    for (const auto &[x, b] : pairs)
+        ++at[x + 1];
+    for (uint32_t b = 0; b < n; ++b)
+        at[b + 1] += at[b];
+    blocks.resize(pairs.size());
+    std::vector<uint32_t> fill(at.begin(), at.end() - 1);
+    for (const auto &[x, b] : pairs)
+        blocks[fill[x]++] = b;
+}
@@ -0,0 +1,94 @@
+#include "flat_ast.hpp"
+
+FlatNode &FlatBuilder::add(NodeKind kind, Token tok, uint32_t operands)
+{
+    auto &nodes = tree.nodes;
+    size_t end = nodes.size();
+    size_t first = end;
+    for (uint32_t i = 0; i < operands; ++i)
+        first -= nodes[first - 1].size;
+
+    FlatNode n{};
+    n.kind = kind;
+    n.size = static_cast<uint32_t>(end - first + 1);
+    n.tok = tok;
+    nodes.push_back(n);
+    return nodes.back();
+}
+
+void FlatBuilder::number(Token tok, int64_t value)
+{
+    add(NodeKind::Number, tok, 0).value = value;
+}
+
+void FlatBuilder::string_literal(Token tok)
+{
+    add(NodeKind::Number, tok, 0);
+}
+
+void FlatBuilder::identifier(Token tok, uint32_t symbol)
+{
+    add(NodeKind::Identifier, tok, 0).symbol = symbol;
+}
+
+void FlatBuilder::unary(Token op)
+{
+    add(NodeKind::UnaryOp, op, 1);
+}
+
+void FlatBuilder::short_circuit(Token op)
+{
+    add(NodeKind::ShortCircuit, op, 1);
+}
+
+void FlatBuilder::binary(Token op)
+{
+    add(NodeKind::BinOp, op, 2);
+}
+
+void FlatBuilder::declaration(ValueType type, Token identifier, uint32_t symbol)
+{
+    FlatNode &n = add(NodeKind::Declaration, identifier, 0);
+    n.flag = static_cast<uint8_t>(type);
+    n.symbol = symbol;
+}
+
+void FlatBuilder::assignment(Token identifier, uint32_t symbol)
+{
+    add(NodeKind::Assignment, identifier, 1).symbol = symbol;
+}
+
+void FlatBuilder::print()
+{
+    add(NodeKind::Print, Token{}, 1);
+}
+
+void FlatBuilder::block(uint32_t count)
+{
+    add(NodeKind::Block, Token{}, count).count = count;
+}
+
+void FlatBuilder::while_start()
+{
+    add(NodeKind::WhileStart, Token{}, 0);
+}
+
+void FlatBuilder::condition()
+{
+    add(NodeKind::Condition, Token{}, 1);
+}
+
+void FlatBuilder::else_start()
+{
+    add(NodeKind::Else, Token{}, 0);
+}
+
+void FlatBuilder::if_statement(bool has_else)
+{
+    add(NodeKind::If, Token{}, has_else ? 4 : 2).flag = has_else;
+}
+
+void FlatBuilder::while_statement()
+{
+    add(NodeKind::While, Token{}, 3);
+}
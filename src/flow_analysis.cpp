@@ -0,0 +1,64 @@
+#include "flow_analysis.hpp"
+
+void FlowAnalysis::refresh()
+{
+    if (graph && revision == ir.revision)
+        return;
+    nest.reset();
+    frontier.reset();
+    post_dom.reset();
+    dom.reset();
+    graph = std::make_unique<ControlFlowGraph>(ir);
+    revision = ir.revision;
+    ++counts.cfg;
+}
+
+const ControlFlowGraph &FlowAnalysis::cfg()
+{
+    refresh();
+    return *graph;
+}
+
+const DominatorTree &FlowAnalysis::dominators()
+{
+    refresh();
+    if (!dom)
+    {
+        dom = std::make_unique<DominatorTree>(*graph, DominatorTree::Direction::Forward);
+        ++counts.dominators;
+    }
+    return *dom;
+}
+
+const DominatorTree &FlowAnalysis::post_dominators()
+{
+    refresh();
+    if (!post_dom)
+    {
+        post_dom = std::make_unique<DominatorTree>(*graph, DominatorTree::Direction::Reverse);
+        ++counts.post_dominators;
+    }
+    return *post_dom;
+}
+
+const DominanceFrontier &FlowAnalysis::frontiers()
+{
+    const DominatorTree &d = dominators();
+    if (!frontier)
+    {
+        frontier = std::make_unique<DominanceFrontier>(*graph, d);
+        ++counts.frontiers;
+    }
+    return *frontier;
+}
+
+const LoopNest &FlowAnalysis::loops()
+{
+    const DominatorTree &d = dominators();
+    if (!nest)
+    {
+        nest = std::make_unique<LoopNest>(*graph, d);
+        ++counts.loops;
+    }
+    return *nest;
+}
@@ -0,0 +1,363 @@
+#include "incremental_parser.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+IncrementalParser::IncrementalParser(const TokenBuffer &tokens, const Source &src)
+    : tokens(tokens), src(src), table(std::make_unique<SymbolTable>(src.symbols))
+{
+}
+
+Node *IncrementalParser::parse()
+{
+    arena.release();
+    blocks.clear();
+    first_decl.clear();
+    candidates.clear();
+    table = std::make_unique<SymbolTable>(src.symbols);
+    last_stats = Stats{};
+    last_stats.attempts = 1;
+    last_stats.whole = true;
+
+    whole = true;
+    try
+    {
+        run(0, tokens.size() - 1);
+    }
+    catch (...)
+    {
+        whole = false;
+        blocks.clear();
+        throw;
+    }
+    whole = false;
+    program = static_cast<uint32_t>(blocks.size() - 1);
+    known_size = tokens.size();
+    last_stats.parsed = tokens.size();
+    return root();
+}
+
+void IncrementalParser::run(size_t from, size_t to)
+{
+    TokenBufferSource feed(tokens, from, to);
+    TreeBuilder tree(arena);
+    builder = &tree;
+    origin = from;
+    done_stmts.clear();
+    done_blocks.clear();
+    Parser(feed, src, tree, *table, this).parse();
+    builder = nullptr;
+}
+
+uint32_t IncrementalParser::reuse(size_t position)
+{
+    if (candidates.empty())
+        return 0;
+    uint32_t at = static_cast<uint32_t>(origin + position);
+    auto it = candidates.find(at);
+    if (it == candidates.end())
+        return 0;
+    builder->reuse(it->second.node);
+    done_stmts.emplace_back(at, it->second);
+    ++last_stats.reused;
+    last_stats.parsed -= it->second.length;
+    return it->second.length;
+}
+
+void IncrementalParser::statement(size_t start, size_t end)
+{
+    const uint32_t at = static_cast<uint32_t>(origin + start);
+    Stmt s{builder->last(), static_cast<uint32_t>(end - start), {none, none}, {0, 0}};
+    switch (s.node->kind)
+    {
+    case NodeKind::Declaration:
+    {
+        // A reparse of part of the program cannot tell what a new
+        // declaration changes behind it; give up on the range.
+        if (!whole)
+        {
+            needs_whole = true;
+            throw std::runtime_error("declaration in a reparsed range");
+        }
+        uint32_t symbol = static_cast<DeclarationNode *>(s.node)->symbol;
+        if (first_decl.size() <= symbol)
+            first_decl.resize(table->size(), none);
+        first_decl[symbol] = std::min(first_decl[symbol], at);
+        break;
+    }
+    case NodeKind::Assignment:
+    {
+        // The parser only checks that the variable is declared somewhere.
+        uint32_t symbol = static_cast<AssignmentNode *>(s.node)->symbol;
+        if (!whole && (symbol >= first_decl.size() || first_decl[symbol] >= at))
+        {
+            needs_whole = true;
+            throw std::runtime_error("assignment in front of the declaration");
+        }
+        break;
+    }
+    case NodeKind::If:
+    case NodeKind::While:
+    {
+        auto x = node_cast<IfNode>(s.node);
+        size_t n = x && x->else_branch ? 2 : 1;
+        for (size_t k = 0; k < n; ++k)
+        {
+            const DoneBlock &b = done_blocks[done_blocks.size() - n + k];
+            s.blocks[k] = b.id;
+            s.block_at[k] = b.start - at;
+        }
+        done_blocks.resize(done_blocks.size() - n);
+        break;
+    }
+    default:
+        break;
+    }
+    done_stmts.emplace_back(at, s);
+}
+
+void IncrementalParser::block(size_t start, size_t end, uint32_t count)
+{
+    const uint32_t at = static_cast<uint32_t>(origin + start);
+    Block b;
+    b.node = static_cast<BlockNode *>(builder->last());
+    b.length = static_cast<uint32_t>(end - start);
+    b.capacity = count;
+    b.start.reserve(count);
+    b.stmts.reserve(count);
+    size_t from = done_stmts.size() - count;
+    for (size_t k = from; k < done_stmts.size(); ++k)
+    {
+        b.start.push_back(done_stmts[k].first - at);
+        b.stmts.push_back(done_stmts[k].second);
+    }
+    done_stmts.resize(from);
+    done_blocks.push_back(DoneBlock{static_cast<uint32_t>(blocks.size()), at});
+    blocks.push_back(std::move(b));
+}
+
+Node *IncrementalParser::reparse(size_t first, size_t last)
+{
+    if (blocks.empty())
+        return parse();
+
+    const int64_t delta = int64_t(tokens.size()) - int64_t(known_size);
+    shift = static_cast<uint32_t>(delta);
+    // The damaged tokens before the edit.
+    const uint32_t a = static_cast<uint32_t>(first);
+    const uint32_t b = static_cast<uint32_t>(int64_t(last) - delta);
+    last_stats = Stats{};
+    if (a == b && delta == 0)
+        return root();
+    // A '}' at the top level ends the program early; only a whole parse can
+    // tell what an edit from there on does.
+    if (b > blocks[program].length && blocks[program].length + 1 != known_size)
+        return parse();
+
+    // Go down to the innermost block in which [a, b] lies among the
+    // statements, away from the braces. The statements to reparse there are
+    // those touching the damage.
+    std::vector<Level> path;
+    uint32_t id = program, base = 0, i = 0, j = 0;
+    for (;;)
+    {
+        const Block &blk = blocks[id];
+        const auto &st = blk.start;
+        i = static_cast<uint32_t>(std::upper_bound(st.begin(), st.end(), a - base) - st.begin());
+        if (i > 0 && base + st[i - 1] + blk.stmts[i - 1].length >= a)
+            --i;
+        j = static_cast<uint32_t>(std::upper_bound(st.begin() + i, st.end(), b - base) - st.begin());
+        if (j != i + 1)
+            break;
+
+        const Stmt &s = blk.stmts[i];
+        const uint32_t at = base + st[i];
+        uint32_t slot = 0;
+        while (slot < 2 && s.blocks[slot] != none &&
+               !(at + s.block_at[slot] <= a && b <= at + s.block_at[slot] + blocks[s.blocks[slot]].length))
+            ++slot;
+        if (slot == 2 || s.blocks[slot] == none)
+            break;
+        path.push_back(Level{id, base, i, slot});
+        base = at + s.block_at[slot];
+        id = s.blocks[slot];
+    }
+
+    needs_whole = false;
+    for (;;)
+    {
+        const Block &blk = blocks[id];
+        uint32_t from = a, to = b;
+        if (i < j)
+        {
+            from = std::min(a, base + blk.start[i]);
+            to = std::max(b, base + blk.start[j - 1] + blk.stmts[j - 1].length);
+        }
+        // Only the program's range can reach its End.
+        to = std::min(to, base + blk.length);
+
+        ++last_stats.attempts;
+        if (try_range(path, id, base, i, j, from, to, a, b))
+        {
+            known_size = tokens.size();
+            return root();
+        }
+        if (needs_whole || path.empty())
+            break;
+        Level up = path.back();
+        path.pop_back();
+        id = up.block;
+        base = up.base;
+        i = up.index;
+        j = i + 1;
+    }
+
+    size_t attempts = last_stats.attempts;
+    parse();
+    last_stats.attempts += attempts;
+    return root();
+}
+
+bool IncrementalParser::try_range(const std::vector<Level> &path, uint32_t id, uint32_t base, uint32_t i,
+                                  uint32_t j, uint32_t from, uint32_t to, uint32_t a, uint32_t b)
+{
+    candidates.clear();
+    for (uint32_t k = i; k < j; ++k)
+        if (!collect(blocks[id].stmts[k], base + blocks[id].start[k], a, b))
+            return false;
+
+    const size_t mark = blocks.size();
+    const uint32_t end = to + shift;
+    last_stats.parsed += end - from;
+    bool ok = true;
+    try
+    {
+        run(from, end);
+        ok = blocks.back().length == end - from;
+    }
+    catch (const std::runtime_error &)
+    {
+        ok = false;
+    }
+    candidates.clear();
+
+    if (!ok)
+    {
+        blocks.erase(blocks.begin() + mark, blocks.end());
+        return false;
+    }
+    splice(path, id, base, i, j, from, b);
+    return true;
+}
+
+// Enters the statements under `s`, which starts at `at`, that the damage
+// [a, b) leaves alone. An if that ends right before the damage is parsed
+// again, since an else may have been added behind it. False if a
+// declaration would have to be parsed again.
+bool IncrementalParser::collect(const Stmt &s, uint32_t at, uint32_t a, uint32_t b)
+{
+    std::vector<std::pair<const Stmt *, uint32_t>> work{{&s, at}};
+    while (!work.empty())
+    {
+        auto [x, start] = work.back();
+        work.pop_back();
+        const uint32_t end = start + x->length;
+        if (end < a || (end == a && x->node->kind != NodeKind::If))
+        {
+            candidates.emplace(start, *x);
+            continue;
+        }
+        if (start >= b)
+        {
+            candidates.emplace(start + shift, *x);
+            continue;
+        }
+        if (x->node->kind == NodeKind::Declaration)
+        {
+            needs_whole = true;
+            return false;
+        }
+        for (int slot = 0; slot < 2 && x->blocks[slot] != none; ++slot)
+        {
+            const Block &inner = blocks[x->blocks[slot]];
+            const uint32_t base = start + x->block_at[slot];
+            for (size_t k = 0; k < inner.stmts.size(); ++k)
+                work.emplace_back(&inner.stmts[k], base + inner.start[k]);
+        }
+    }
+    return true;
+}
+
+// Replaces statements [i, j) of block `id` by those just parsed, and shifts
+// what follows the range in this block and in the blocks around it, and the
+// declarations behind the damage, which ends at `b`.
+void IncrementalParser::splice(const std::vector<Level> &path, uint32_t id, uint32_t base, uint32_t i,
+                               uint32_t j, uint32_t from, uint32_t b)
+{
+    Block fresh = std::move(blocks.back());
+    blocks.pop_back();
+    Block &blk = blocks[id];
+    const uint32_t k = static_cast<uint32_t>(fresh.stmts.size());
+    const uint32_t removed = j - i;
+
+    NodeList &list = blk.node->statements;
+    if (k != removed)
+    {
+        const uint32_t count = list.count - removed + k;
+        const uint32_t tail = list.count - j;
+        if (count > blk.capacity)
+        {
+            // Grow geometrically; the old array stays in the arena.
+            blk.capacity = std::max(count, blk.capacity * 2);
+            Node **items = static_cast<Node **>(arena.allocate(sizeof(Node *) * blk.capacity, alignof(Node *)));
+            if (i)
+                std::memcpy(items, list.items, sizeof(Node *) * i);
+            if (tail)
+                std::memcpy(items + i + k, list.items + j, sizeof(Node *) * tail);
+            list.items = items;
+        }
+        else if (tail)
+        {
+            std::memmove(list.items + i + k, list.items + j, sizeof(Node *) * tail);
+        }
+        list.count = count;
+    }
+    for (uint32_t x = 0; x < k; ++x)
+    {
+        list.items[i + x] = fresh.stmts[x].node;
+        fresh.start[x] += from - base;
+    }
+
+    if (k == removed)
+    {
+        std::copy(fresh.start.begin(), fresh.start.end(), blk.start.begin() + i);
+        std::copy(fresh.stmts.begin(), fresh.stmts.end(), blk.stmts.begin() + i);
+    }
+    else
+    {
+        blk.start.erase(blk.start.begin() + i, blk.start.begin() + j);
+        blk.start.insert(blk.start.begin() + i, fresh.start.begin(), fresh.start.end());
+        blk.stmts.erase(blk.stmts.begin() + i, blk.stmts.begin() + j);
+        blk.stmts.insert(blk.stmts.begin() + i, fresh.stmts.begin(), fresh.stmts.end());
+    }
+
+    if (shift == 0)
+        return;
+    for (size_t x = i + k; x < blk.start.size(); ++x)
+        blk.start[x] += shift;
+    blk.length += shift;
+    for (auto l = path.rbegin(); l != path.rend(); ++l)
+    {
+        Block &outer = blocks[l->block];
+        Stmt &s = outer.stmts[l->index];
+        s.length += shift;
+        if (l->slot == 0 && s.blocks[1] != none)
+            s.block_at[1] += shift;
+        for (size_t x = l->index + 1; x < outer.start.size(); ++x)
+            outer.start[x] += shift;
+        outer.length += shift;
+    }
+    for (uint32_t &d : first_decl)
+        if (d != none && d >= b)
+            d += shift;
+}
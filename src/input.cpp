@@ -0,0 +1,86 @@
+#include "input.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+InputBuffer::~InputBuffer() { release(); }
+
+void InputBuffer::release()
+{
+    if (mapped)
+        munmap(data, mapped);
+    mapped = 0;
+    data = nullptr;
+    size = 0;
+    owned.clear();
+}
+
+bool InputBuffer::load_file(const char *path)
+{
+    release();
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0)
+    {
+        bool ok = load_fd(fd);
+        close(fd);
+        return ok;
+    }
+
+    // Reserve the file size plus the two sentinel bytes as zeroed anonymous
+    // memory, then map the file privately over the front of it. Bytes past
+    // EOF read as zero either from the tail of the last file page or from the
+    // anonymous pages, and MAP_PRIVATE lets flex write its hold char in place.
+    const size_t len = static_cast<size_t>(st.st_size);
+    const size_t total = len + 2;
+    void *base = mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED)
+    {
+        close(fd);
+        return false;
+    }
+    void *file = mmap(base, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0);
+    close(fd);
+    if (file == MAP_FAILED)
+    {
+        munmap(base, total);
+        return false;
+    }
+    madvise(base, len, MADV_SEQUENTIAL);
+
+    data = static_cast<char *>(base);
+    size = len;
+    mapped = total;
+    return true;
+}
+
+bool InputBuffer::load_fd(int fd)
+{
+    release();
+    const size_t chunk = 1 << 16;
+    size_t used = 0;
+    for (;;)
+    {
+        owned.resize(used + chunk);
+        ssize_t n = read(fd, owned.data() + used, chunk);
+        if (n < 0)
+        {
+            owned.clear();
+            return false;
+        }
+        if (n == 0)
+            break;
+        used += static_cast<size_t>(n);
+    }
+    owned.resize(used + 2);
+    owned[used] = '\0';
+    owned[used + 1] = '\0';
+    data = owned.data();
+    size = used;
+    return true;
+}
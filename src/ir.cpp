@@ -1,281 +1,308 @@
 #include "ir.hpp"
 #include <stdexcept>
 
-static std::shared_ptr<AssignmentCode> make_assign(const std::string &v, const std::string &l,
-                                                   const std::string &op, const std::string &r)
+const char *ir_op_spelling(IROp op)
 {
-    auto a = std::make_shared<AssignmentCode>();
-    a->var = v;
-    a->left = l;
-    a->op = op;
-    a->right = r;
-    return a;
+    switch (op)
+    {
+    case IROp::Add: return "+";
+    case IROp::Sub: return "-";
+    case IROp::Mul: return "*";
+    case IROp::Div: return "/";
+    case IROp::JumpEq: return "==";
+    case IROp::JumpNe: return "!=";
+    case IROp::JumpLt: return "<";
+    case IROp::JumpLe: return "<=";
+    case IROp::JumpGt: return ">";
+    case IROp::JumpGe: return ">=";
+    default: return "";
+    }
 }
-static std::shared_ptr<JumpCode> make_jump(const std::string &d)
+
+std::string ir_label(IROperand label) { return "L" + std::to_string(label.id() + 1); }
+
+void IROperand::id_overflow(OperandKind kind, uint32_t id)
 {
-    auto j = std::make_shared<JumpCode>();
-    j->dist = d;
-    return j;
+    static const char *const kinds[] = {"none", "variable", "temporary", "immediate", "label", "string"};
+    throw std::runtime_error(std::string("IR ") + kinds[uint32_t(kind)] + " id " + std::to_string(id) +
+                             " does not fit in " + std::to_string(id_bits) + " bits");
 }
-static std::shared_ptr<LabelCode> make_label(const std::string &l)
+
+std::string InterCodeArray::str(IROperand o, const SymbolTable &symbols) const
 {
-    auto x = std::make_shared<LabelCode>();
-    x->label = l;
-    return x;
+    switch (o.kind())
+    {
+    case OperandKind::Variable: return "V" + std::string(symbols.name(o.id()));
+    case OperandKind::Temp: return "T" + std::to_string(o.id() + 1);
+    case OperandKind::Immediate: return std::to_string(value(o));
+    case OperandKind::Label: return ir_label(o);
+    case OperandKind::String: return "S" + std::to_string(o.id() + 1);
+    default: return std::string();
+    }
 }
-static std::shared_ptr<CompareCodeIR> make_compare(const std::string &l, const std::string &op,
-                                                   const std::string &r, const std::string &j)
+
+static IROp compare_op(TokenType t)
 {
-    auto c = std::make_shared<CompareCodeIR>();
-    c->left = l;
-    c->operation = op;
-    c->right = r;
-    c->jump = j;
-    return c;
+    switch (t)
+    {
+    case TokenType::Equal: return IROp::JumpEq;
+    case TokenType::NotEqual: return IROp::JumpNe;
+    case TokenType::Less: return IROp::JumpLt;
+    case TokenType::LessEq: return IROp::JumpLe;
+    case TokenType::Greater: return IROp::JumpGt;
+    default: return IROp::JumpGe;
+    }
 }
-static std::shared_ptr<PrintCodeIR> make_print(const std::string &t, const std::string &v)
+
+static IROp arithmetic_op(TokenType t)
 {
-    auto p = std::make_shared<PrintCodeIR>();
-    p->type = t;
-    p->value = v;
-    return p;
+    switch (t)
+    {
+    case TokenType::Plus: return IROp::Add;
+    case TokenType::Minus: return IROp::Sub;
+    case TokenType::Star: return IROp::Mul;
+    default: return IROp::Div;
+    }
 }
 
-IntermediateCodeGen::IntermediateCodeGen(const std::shared_ptr<Node> &root) : root(root)
+IntermediateCodeGen::IntermediateCodeGen(const Node *root, const Source &src, SymbolTable &symbols)
+    : src(src), symbols(symbols)
 {
-    exec_statement(root);
+    if (root)
+        replay(root, *this);
 }
 
-std::string IntermediateCodeGen::nextTemp()
+IntermediateCodeGen::IntermediateCodeGen(const FlatTree &tree, const Source &src, SymbolTable &symbols)
+    : src(src), symbols(symbols)
 {
-    std::string t = "T" + std::to_string(tCounter++);
-    std::string sym = "__tmp" + std::to_string(tCounter - 1);
-    tempmap[t] = sym;
-    return t;
+    replay(tree, *this);
 }
 
-std::string IntermediateCodeGen::nextLabel() { return "L" + std::to_string(lCounter++); }
-std::string IntermediateCodeGen::nextStringSym() { return "S" + std::to_string(sCounter++); }
+IntermediateCodeGen::IntermediateCodeGen(const Source &src, SymbolTable &symbols) : src(src), symbols(symbols) {}
 
-static bool is_arith_op(const std::string &op)
+uint32_t IntermediateCodeGen::emit(IROp op, IROperand dst, IROperand a, IROperand b)
 {
-    return op == "+" || op == "-" || op == "*" || op == "/";
+    arr.append(IRInstr{op, dst, a, b});
+    return static_cast<uint32_t>(arr.code.size() - 1);
 }
-static bool is_cmp_op(const std::string &op)
+
+IntermediateCodeGen::JumpList IntermediateCodeGen::jump_list(uint32_t instr)
 {
-    return op == "==" || op == "!=" || op == "<" || op == "<=" || op == ">" || op == ">=";
+    links.push_back(Link{instr, none});
+    uint32_t k = static_cast<uint32_t>(links.size() - 1);
+    return JumpList{k, k};
 }
 
-std::string IntermediateCodeGen::exec_expr(const std::shared_ptr<Node> &n)
+IntermediateCodeGen::JumpList IntermediateCodeGen::join(JumpList a, JumpList b)
 {
-    if (!n)
-        throw std::runtime_error("IR: null expression");
-
-    if (auto id = std::dynamic_pointer_cast<IdentifierNode>(n))
-        return id->getValue();
-
-    if (auto num = std::dynamic_pointer_cast<NumberNode>(n))
-        return num->getValue();
-
-    if (auto un = std::dynamic_pointer_cast<UnaryOpNode>(n))
-    {
-        throw std::runtime_error("IR: unary operator used as value expression: " + un->op_tok.value);
-    }
-
-    auto bin = std::dynamic_pointer_cast<BinOpNode>(n);
-    if (!bin)
-        throw std::runtime_error("IR: unsupported expression node");
-
-    if (!is_arith_op(bin->op_tok.value))
+    if (a.head == none)
+        return b;
+    if (b.head != none)
     {
-        throw std::runtime_error("IR: non-arithmetic operator used as value expression: " + bin->op_tok.value);
+        links[a.tail].next = b.head;
+        a.tail = b.tail;
     }
-
-    auto left = exec_expr(bin->left);
-    auto right = exec_expr(bin->right);
-
-    auto t = nextTemp();
-    arr.append(make_assign(t, left, bin->op_tok.value, right));
-    return t;
+    return a;
 }
 
-void IntermediateCodeGen::emit_condition(const std::shared_ptr<Node> &cond,
-                                         const std::string &trueLabel,
-                                         const std::string &falseLabel)
+void IntermediateCodeGen::patch(JumpList list, IROperand label)
 {
-    if (!cond)
-        throw std::runtime_error("IR: null condition");
-
-    if (auto un = std::dynamic_pointer_cast<UnaryOpNode>(cond))
-    {
-        if (un->op_tok.value != "!")
-            throw std::runtime_error("IR: unsupported unary condition op: " + un->op_tok.value);
-        emit_condition(un->operand, falseLabel, trueLabel);
-        return;
-    }
-    if (auto bin = std::dynamic_pointer_cast<BinOpNode>(cond))
-    {
-        const std::string op = bin->op_tok.value;
-
-        if (op == "!" && !bin->left)
-        {
-            emit_condition(bin->right, falseLabel, trueLabel);
-            return;
-        }
-
-        if (op == "&&")
-        {
-            auto mid = nextLabel();
-            emit_condition(bin->left, mid, falseLabel);
-            arr.append(make_label(mid));
-            emit_condition(bin->right, trueLabel, falseLabel);
-            return;
-        }
-        if (op == "||")
-        {
-            auto mid = nextLabel();
-            emit_condition(bin->left, trueLabel, mid);
-            arr.append(make_label(mid));
-            emit_condition(bin->right, trueLabel, falseLabel);
-            return;
-        }
-        if (is_cmp_op(op))
-        {
-            auto left = exec_expr(bin->left);
-            auto right = exec_expr(bin->right);
-            arr.append(make_compare(left, op, right, trueLabel));
-            arr.append(make_jump(falseLabel));
-            return;
-        }
-    }
+    for (uint32_t k = list.head; k != none; k = links[k].next)
+        arr.code[links[k].instr].dst = label;
+    arr.changed();
+}
 
-    auto v = exec_expr(cond);
-    arr.append(make_compare(v, "!=", "0", trueLabel));
-    arr.append(make_jump(falseLabel));
+IROperand IntermediateCodeGen::place_label()
+{
+    IROperand label = arr.new_label();
+    emit(IROp::Label, label);
+    return label;
 }
 
-void IntermediateCodeGen::exec_assignment(const std::shared_ptr<AssignmentNode> &a)
+IntermediateCodeGen::Lowered IntermediateCodeGen::pop()
 {
-    auto right = exec_expr(a->expression);
-    arr.append(make_assign(a->identifier.value, right, "", ""));
+    Lowered x = values.back();
+    values.pop_back();
+    return x;
 }
 
-void IntermediateCodeGen::exec_print(const std::shared_ptr<PrintNode> &p)
+IROperand IntermediateCodeGen::value_of(const Lowered &x)
 {
-    if (!p || !p->value)
-        return;
+    if (x.is_condition)
+        throw std::runtime_error("IR: condition used as value expression");
+    if (x.value.kind() == OperandKind::String)
+        throw std::runtime_error("IR: string constant used as value expression");
+    return x.value;
+}
 
-    if (auto lit = std::dynamic_pointer_cast<NumberNode>(p->value))
-    {
-        if (lit->tok.type == TokenType::String)
-        {
-            auto sym = nextStringSym();
-            constants[sym] = lit->tok.value;
-            arr.append(make_print("string", sym));
-            return;
-        }
-    }
+// A value tested as a condition is true when it is not 0.
+IntermediateCodeGen::Lowered IntermediateCodeGen::condition_of(const Lowered &x)
+{
+    if (x.is_condition)
+        return x;
+    Lowered c;
+    c.is_condition = true;
+    c.on_true = jump_list(emit(IROp::JumpNe, IROperand(), value_of(x), arr.immediate(0)));
+    c.on_false = jump_list(emit(IROp::Jump, IROperand()));
+    return c;
+}
 
-    auto v = exec_expr(p->value);
-    arr.append(make_print("int", v));
+void IntermediateCodeGen::number(Token, int64_t value)
+{
+    Lowered x;
+    x.value = arr.immediate(value);
+    values.push_back(x);
 }
 
-void IntermediateCodeGen::exec_declaration(const std::shared_ptr<DeclarationNode> &d)
+void IntermediateCodeGen::string_literal(Token tok)
 {
-    if (!d)
-        return;
-    identifiers[d->identifier.value] = (d->var_type == ValueType::Int) ? "int" : "string";
+    Lowered x;
+    x.value = IROperand::string(symbols.add_string(tok.sym));
+    values.push_back(x);
 }
 
-void IntermediateCodeGen::exec_block(const std::shared_ptr<BlockNode> &b)
+void IntermediateCodeGen::identifier(Token, uint32_t symbol)
 {
-    if (!b)
-        return;
-    for (const auto &st : b->statements)
-        exec_statement(st);
+    Lowered x;
+    x.value = IROperand::variable(symbol);
+    values.push_back(x);
 }
 
-void IntermediateCodeGen::exec_if(const std::shared_ptr<IfNode> &i)
+void IntermediateCodeGen::unary(Token op)
 {
-    auto thenL = nextLabel();
-    auto endL = nextLabel();
+    if (op.type != TokenType::Not)
+        throw std::runtime_error("IR: unsupported unary condition op: " + src.value(op));
+    Lowered c = condition_of(pop());
+    std::swap(c.on_true, c.on_false);
+    values.push_back(c);
+}
 
-    if (i->else_branch)
+// The right operand of && is only tested when the left one is true, that of
+// || only when it is false: that is where the label between them goes.
+void IntermediateCodeGen::short_circuit(Token op)
+{
+    Lowered c = condition_of(pop());
+    auto mid = place_label();
+    if (op.type == TokenType::And)
     {
-        auto elseL = nextLabel();
-        emit_condition(i->condition, thenL, elseL);
-
-        arr.append(make_label(thenL));
-        exec_statement(i->then_branch);
-        arr.append(make_jump(endL));
-
-        arr.append(make_label(elseL));
-        exec_statement(i->else_branch);
-
-        arr.append(make_label(endL));
+        patch(c.on_true, mid);
+        c.on_true = JumpList();
     }
     else
     {
-        emit_condition(i->condition, thenL, endL);
-
-        arr.append(make_label(thenL));
-        exec_statement(i->then_branch);
-
-        arr.append(make_label(endL));
+        patch(c.on_false, mid);
+        c.on_false = JumpList();
     }
+    values.push_back(c);
 }
 
-void IntermediateCodeGen::exec_while(const std::shared_ptr<WhileNode> &w)
-{
-    auto startL = nextLabel();
-    auto bodyL = nextLabel();
-    auto endL = nextLabel();
-
-    arr.append(make_label(startL));
-    emit_condition(w->condition, bodyL, endL);
-
-    arr.append(make_label(bodyL));
-    exec_statement(w->body);
-    arr.append(make_jump(startL));
-
-    arr.append(make_label(endL));
-}
-
-void IntermediateCodeGen::exec_statement(const std::shared_ptr<Node> &n)
+void IntermediateCodeGen::binary(Token op)
 {
-    if (!n)
-        return;
-
-    if (auto blk = std::dynamic_pointer_cast<BlockNode>(n))
-    {
-        exec_block(blk);
-        return;
-    }
-    if (auto iff = std::dynamic_pointer_cast<IfNode>(n))
+    switch (op.type)
     {
-        exec_if(iff);
-        return;
-    }
-    if (auto wh = std::dynamic_pointer_cast<WhileNode>(n))
+    case TokenType::And:
+    case TokenType::Or:
     {
-        exec_while(wh);
+        Lowered right = condition_of(pop());
+        Lowered left = pop();
+        left.on_true = join(left.on_true, right.on_true);
+        left.on_false = join(left.on_false, right.on_false);
+        values.push_back(left);
         return;
     }
-    if (auto pr = std::dynamic_pointer_cast<PrintNode>(n))
+    case TokenType::Equal:
+    case TokenType::NotEqual:
+    case TokenType::Less:
+    case TokenType::LessEq:
+    case TokenType::Greater:
+    case TokenType::GreaterEq:
     {
-        exec_print(pr);
+        auto right = value_of(pop());
+        auto left = value_of(pop());
+        Lowered c;
+        c.is_condition = true;
+        c.on_true = jump_list(emit(compare_op(op.type), IROperand(), left, right));
+        c.on_false = jump_list(emit(IROp::Jump, IROperand()));
+        values.push_back(c);
         return;
     }
-    if (auto de = std::dynamic_pointer_cast<DeclarationNode>(n))
+    case TokenType::Plus:
+    case TokenType::Minus:
+    case TokenType::Star:
+    case TokenType::Slash:
     {
-        exec_declaration(de);
+        auto right = value_of(pop());
+        auto left = value_of(pop());
+        auto t = IROperand::temp(symbols.add_temp());
+        emit(arithmetic_op(op.type), t, left, right);
+        Lowered x;
+        x.value = t;
+        values.push_back(x);
         return;
     }
-    if (auto asg = std::dynamic_pointer_cast<AssignmentNode>(n))
-    {
-        exec_assignment(asg);
-        return;
+    default:
+        throw std::runtime_error("IR: unsupported operator: " + src.value(op));
     }
+}
+
+void IntermediateCodeGen::declaration(ValueType, Token, uint32_t)
+{
+    // Already entered in the SymbolTable by the parser.
+}
 
-    throw std::runtime_error("IR: unsupported statement node");
+void IntermediateCodeGen::assignment(Token, uint32_t symbol)
+{
+    auto right = value_of(pop());
+    emit(IROp::Copy, IROperand::variable(symbol), right);
+}
+
+void IntermediateCodeGen::print()
+{
+    Lowered x = pop();
+    if (x.value.kind() == OperandKind::String)
+        emit(IROp::PrintString, IROperand(), x.value);
+    else
+        emit(IROp::PrintInt, IROperand(), value_of(x));
+}
+
+void IntermediateCodeGen::block(uint32_t)
+{
+    // Its statements have been lowered already.
+}
+
+void IntermediateCodeGen::while_start()
+{
+    control.push_back(Pending{place_label(), JumpList()});
+}
+
+// The then block or loop body starts here; the jumps taken when the
+// condition is false wait for the label after it.
+void IntermediateCodeGen::condition()
+{
+    Lowered c = condition_of(pop());
+    patch(c.on_true, place_label());
+    control.push_back(Pending{IROperand(), c.on_false});
+}
+
+void IntermediateCodeGen::else_start()
+{
+    Pending &p = control.back();
+    JumpList skip = jump_list(emit(IROp::Jump, IROperand()));
+    patch(p.jumps, place_label());
+    p.jumps = skip;
+}
+
+void IntermediateCodeGen::if_statement(bool)
+{
+    patch(control.back().jumps, place_label());
+    control.pop_back();
+}
+
+void IntermediateCodeGen::while_statement()
+{
+    JumpList exits = control.back().jumps;
+    control.pop_back();
+    emit(IROp::Jump, control.back().label);
+    control.pop_back();
+    patch(exits, place_label());
 }
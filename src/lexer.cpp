@@ -0,0 +1,353 @@
+#include "lexer.hpp"
+#include "keywords.hpp"
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define LEXER_X86 1
+#endif
+
+static bool is_id_start(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+static bool is_digit(char c) { return c >= '0' && c <= '9'; }
+static bool is_id_cont(char c) { return is_id_start(c) || is_digit(c); }
+static bool is_blank(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\n'; }
+
+// Block kernels. Each one advances `p` over a run of one character class and
+// returns the first position outside it.
+
+static const char *skip_blank_scalar(const char *p, const char *end)
+{
+    while (p < end && is_blank(*p))
+        ++p;
+    return p;
+}
+static const char *find_newline_scalar(const char *p, const char *end)
+{
+    const void *nl = std::memchr(p, '\n', static_cast<size_t>(end - p));
+    return nl ? static_cast<const char *>(nl) : end;
+}
+static const char *skip_ident_scalar(const char *p, const char *end)
+{
+    while (p < end && is_id_cont(*p))
+        ++p;
+    return p;
+}
+
+#ifdef LEXER_X86
+// Signed byte compares: bytes >= 0x80 are negative and never fall in a range.
+static inline __m128i in_range16(__m128i v, char lo, char hi)
+{
+    return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(static_cast<char>(lo - 1))),
+                         _mm_cmpgt_epi8(_mm_set1_epi8(static_cast<char>(hi + 1)), v));
+}
+
+__attribute__((target("sse2")))
+static const char *skip_blank_sse2(const char *p, const char *end)
+{
+    while (end - p >= 16)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        __m128i ws = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                                               _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'))),
+                                  _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\r')),
+                                                            _mm_cmpeq_epi8(v, _mm_set1_epi8('\f'))),
+                                               _mm_cmpeq_epi8(v, _mm_set1_epi8('\n'))));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(ws));
+        if (mask != 0xFFFFu)
+            return p + __builtin_ctz(~mask);
+        p += 16;
+    }
+    return skip_blank_scalar(p, end);
+}
+
+__attribute__((target("sse2")))
+static const char *find_newline_sse2(const char *p, const char *end)
+{
+    while (end - p >= 16)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n'))));
+        if (mask)
+            return p + __builtin_ctz(mask);
+        p += 16;
+    }
+    return find_newline_scalar(p, end);
+}
+
+__attribute__((target("sse2")))
+static const char *skip_ident_sse2(const char *p, const char *end)
+{
+    while (end - p >= 16)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+        __m128i id = _mm_or_si128(_mm_or_si128(in_range16(lower, 'a', 'z'), in_range16(v, '0', '9')),
+                                  _mm_cmpeq_epi8(v, _mm_set1_epi8('_')));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(id));
+        if (mask != 0xFFFFu)
+            return p + __builtin_ctz(~mask);
+        p += 16;
+    }
+    return skip_ident_scalar(p, end);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i in_range32(__m256i v, char lo, char hi)
+{
+    return _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8(static_cast<char>(lo - 1))),
+                            _mm256_cmpgt_epi8(_mm256_set1_epi8(static_cast<char>(hi + 1)), v));
+}
+
+__attribute__((target("avx2")))
+static const char *skip_blank_avx2(const char *p, const char *end)
+{
+    while (end - p >= 32)
+    {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        __m256i ws = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+                                                     _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t'))),
+                                     _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')),
+                                                                     _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\f'))),
+                                                     _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'))));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(ws));
+        if (mask != 0xFFFFFFFFu)
+            return p + __builtin_ctz(~mask);
+        p += 32;
+    }
+    return skip_blank_sse2(p, end);
+}
+
+__attribute__((target("avx2")))
+static const char *find_newline_avx2(const char *p, const char *end)
+{
+    while (end - p >= 32)
+    {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'))));
+        if (mask)
+            return p + __builtin_ctz(mask);
+        p += 32;
+    }
+    return find_newline_sse2(p, end);
+}
+
+__attribute__((target("avx2")))
+static const char *skip_ident_avx2(const char *p, const char *end)
+{
+    while (end - p >= 32)
+    {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+        __m256i id = _mm256_or_si256(_mm256_or_si256(in_range32(lower, 'a', 'z'), in_range32(v, '0', '9')),
+                                     _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_')));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(id));
+        if (mask != 0xFFFFFFFFu)
+            return p + __builtin_ctz(~mask);
+        p += 32;
+    }
+    return skip_ident_sse2(p, end);
+}
+#endif
+
+LexerKind best_simd_lexer()
+{
+#ifdef LEXER_X86
+    static const LexerKind best = __builtin_cpu_supports("avx2") ? LexerKind::Avx2
+                                  : __builtin_cpu_supports("sse2") ? LexerKind::Sse2
+                                  : LexerKind::Scalar;
+    return best;
+#else
+    return LexerKind::Scalar;
+#endif
+}
+
+// Never run a wider kernel than the CPU has; Flex means "any hand-written".
+static LexerKind resolve_kind(LexerKind k)
+{
+    const LexerKind best = best_simd_lexer();
+    if (k == LexerKind::Flex || static_cast<int>(k) > static_cast<int>(best))
+        return best;
+    return k;
+}
+
+Lexer::Lexer(Source &src, LexerKind kind)
+    : src(src), base(src.text.data()), cur(base), end(base + src.text.size()),
+      kind(resolve_kind(kind)) {}
+
+Lexer::Lexer(Source &src, uint32_t offset, LexerKind kind)
+    : src(src), base(src.text.data()), cur(base + offset), end(base + src.text.size()),
+      kind(resolve_kind(kind)) {}
+
+// Token spanning [start, cur).
+Token Lexer::make(TokenType type, const char *start, uint32_t sym) const
+{
+    return Token{type, static_cast<uint32_t>(start - base), static_cast<uint32_t>(cur - start), sym};
+}
+
+void Lexer::unknown_char() const
+{
+    int line = src.lines().line(static_cast<uint32_t>(cur - base));
+    throw std::runtime_error("Unknown char at line " + std::to_string(line));
+}
+
+Token Lexer::next()
+{
+    for (;;)
+    {
+        switch (kind)
+        {
+#ifdef LEXER_X86
+        case LexerKind::Avx2: cur = skip_blank_avx2(cur, end); break;
+        case LexerKind::Sse2: cur = skip_blank_sse2(cur, end); break;
+#endif
+        default: cur = skip_blank_scalar(cur, end); break;
+        }
+
+        if (cur >= end)
+            return make(TokenType::End, cur);
+
+        const char c = *cur;
+
+        if (c == '#')
+        {
+            switch (kind)
+            {
+#ifdef LEXER_X86
+            case LexerKind::Avx2: cur = find_newline_avx2(cur, end); break;
+            case LexerKind::Sse2: cur = find_newline_sse2(cur, end); break;
+#endif
+            default: cur = find_newline_scalar(cur, end); break;
+            }
+            continue;
+        }
+
+        if (is_id_start(c))
+        {
+            const char *start = cur;
+            switch (kind)
+            {
+#ifdef LEXER_X86
+            case LexerKind::Avx2: cur = skip_ident_avx2(cur + 1, end); break;
+            case LexerKind::Sse2: cur = skip_ident_sse2(cur + 1, end); break;
+#endif
+            default: cur = skip_ident_scalar(cur + 1, end); break;
+            }
+            std::string_view s(start, static_cast<size_t>(cur - start));
+            TokenType t = keyword_type(s);
+            if (t != TokenType::Var)
+                return make(t, start);
+            return make(TokenType::Var, start, src.symbols.intern(s));
+        }
+
+        if (is_digit(c))
+        {
+            const char *start = cur;
+            while (cur < end && is_digit(*cur))
+                ++cur;
+            return make(TokenType::IntLit, start,
+                        src.intern_int(static_cast<uint32_t>(start - base), static_cast<uint32_t>(cur - start)));
+        }
+
+        if (c == '"')
+        {
+            // Same as \"([^\"\\]|\\.)*\" : an escape never consumes a newline,
+            // and an unterminated literal leaves the quote as an unknown char.
+            const char *p = cur + 1;
+            while (p < end && *p != '"')
+            {
+                if (*p == '\\')
+                {
+                    if (p + 1 >= end || p[1] == '\n')
+                        break;
+                    ++p;
+                }
+                ++p;
+            }
+            if (p < end && *p == '"')
+            {
+                const char *start = cur;
+                cur = p + 1;
+                return make(TokenType::String, start,
+                            src.symbols.intern(std::string_view(start + 1, static_cast<size_t>(p - start - 1))));
+            }
+            unknown_char();
+        }
+
+        const char n = (cur + 1 < end) ? cur[1] : '\0';
+        TokenType t;
+        int len = 1;
+        switch (c)
+        {
+        case '=': if (n == '=') { t = TokenType::Equal; len = 2; } else t = TokenType::Assign; break;
+        case '!': if (n == '=') { t = TokenType::NotEqual; len = 2; } else t = TokenType::Not; break;
+        case '<':
+            if (n == '=')      { t = TokenType::LessEq; len = 2; }
+            else if (n == '<') { t = TokenType::PrintBrackets; len = 2; }
+            else               t = TokenType::Less;
+            break;
+        case '>': if (n == '=') { t = TokenType::GreaterEq; len = 2; } else t = TokenType::Greater; break;
+        case '&':
+        case '|':
+            if (n != c)
+                unknown_char();
+            t = (c == '&') ? TokenType::And : TokenType::Or;
+            len = 2;
+            break;
+        case ';': t = TokenType::Semicolon; break;
+        case ',': t = TokenType::Comma; break;
+        case '(': t = TokenType::LParen; break;
+        case ')': t = TokenType::RParen; break;
+        case '{': t = TokenType::LBrace; break;
+        case '}': t = TokenType::RBrace; break;
+        case '+': t = TokenType::Plus; break;
+        case '-': t = TokenType::Minus; break;
+        case '/': t = TokenType::Slash; break;
+        case '*': t = TokenType::Star; break;
+        default:
+            unknown_char();
+        }
+        const char *start = cur;
+        cur += len;
+        return make(t, start);
+    }
+}
+
+size_t LexerTokenSource::fill(Token *out, size_t max)
+{
+    size_t n = 0;
+    while (n < max)
+    {
+        out[n] = lexer.next();
+        if (out[n++].type == TokenType::End)
+            break;
+    }
+    return n;
+}
+
+std::vector<Token> lex_string_to_tokens(Source &src, LexerKind kind)
+{
+    std::vector<Token> out;
+    Lexer lx(src, kind);
+    for (;;)
+    {
+        out.push_back(lx.next());
+        if (out.back().type == TokenType::End)
+            break;
+    }
+    return out;
+}
+
+std::vector<Token> tokenize(Source &src, LexerKind kind)
+{
+    if (kind == LexerKind::Flex)
+    {
+        std::vector<Token> out;
+        scan_string_to_tokens(src, out);
+        return out;
+    }
+    return lex_string_to_tokens(src, kind);
+}
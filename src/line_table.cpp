@@ -0,0 +1,76 @@
+#include "line_table.hpp"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define LINES_X86 1
+#endif
+
+// Each kernel appends the start of every line that begins after a newline
+// in [p, end), where p sits at offset `at` of the text.
+
+static void scan_scalar(const char *p, const char *end, uint32_t at, std::vector<uint32_t> &starts)
+{
+    const char *from = p;
+    while (const void *nl = std::memchr(p, '\n', static_cast<size_t>(end - p)))
+    {
+        p = static_cast<const char *>(nl) + 1;
+        starts.push_back(at + static_cast<uint32_t>(p - from));
+    }
+}
+
+#ifdef LINES_X86
+__attribute__((target("sse2")))
+static void scan_sse2(const char *p, const char *end, uint32_t at, std::vector<uint32_t> &starts)
+{
+    const __m128i nl = _mm_set1_epi8('\n');
+    for (; end - p >= 16; p += 16, at += 16)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        for (unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, nl))); mask; mask &= mask - 1)
+            starts.push_back(at + static_cast<uint32_t>(__builtin_ctz(mask)) + 1);
+    }
+    scan_scalar(p, end, at, starts);
+}
+
+__attribute__((target("avx2")))
+static void scan_avx2(const char *p, const char *end, uint32_t at, std::vector<uint32_t> &starts)
+{
+    const __m256i nl = _mm256_set1_epi8('\n');
+    for (; end - p >= 32; p += 32, at += 32)
+    {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        for (unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, nl))); mask; mask &= mask - 1)
+            starts.push_back(at + static_cast<uint32_t>(__builtin_ctz(mask)) + 1);
+    }
+    scan_sse2(p, end, at, starts);
+}
+#endif
+
+LineTable::LineTable(std::string_view text) : text_data(text.data()), text_size(text.size())
+{
+    // Source text averages a few dozen bytes per line.
+    starts.reserve(text.size() / 32 + 1);
+    starts.push_back(0);
+    const char *p = text.data(), *end = p + text.size();
+#ifdef LINES_X86
+    if (__builtin_cpu_supports("avx2"))
+        scan_avx2(p, end, 0, starts);
+    else
+        scan_sse2(p, end, 0, starts);
+#else
+    scan_scalar(p, end, 0, starts);
+#endif
+}
+
+int LineTable::line(uint32_t offset) const
+{
+    return static_cast<int>(std::upper_bound(starts.begin(), starts.end(), offset) - starts.begin());
+}
+
+Position LineTable::position(uint32_t offset) const
+{
+    int l = line(offset);
+    return Position{l, static_cast<int>(offset - starts[l - 1]) + 1};
+}
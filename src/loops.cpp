@@ -0,0 +1,63 @@
+#include "loops.hpp"
+#include <numeric>
+
+LoopNest::LoopNest(const ControlFlowGraph &cfg, const DominatorTree &dom)
+{
+    const uint32_t n = cfg.size();
+    innermost.assign(n, none);
+
+    // Each block points towards the header of the outermost loop found so
+    // far that contains it; a block outside of them points to itself.
+    std::vector<uint32_t> outer(n);
+    std::iota(outer.begin(), outer.end(), 0u);
+    auto find = [&](uint32_t b) {
+        while (outer[b] != b)
+        {
+            outer[b] = outer[outer[b]];
+            b = outer[b];
+        }
+        return b;
+    };
+
+    std::vector<uint32_t> work;
+    const std::vector<uint32_t> &order = dom.order();
+    for (auto it = order.rbegin(); it != order.rend(); ++it)
+    {
+        const uint32_t h = *it;
+        for (uint32_t p : cfg.predecessors(h))
+            if (dom.dominates(h, p))
+                work.push_back(p);
+        if (work.empty())
+            continue;
+
+        const uint32_t id = static_cast<uint32_t>(loops.size());
+        loops.push_back(Loop{h, none, 0, 0});
+        innermost[h] = id;
+        while (!work.empty())
+        {
+            const uint32_t x = find(work.back());
+            work.pop_back();
+            if (x == h)
+                continue;
+            // A block of no loop yet, or the header of a finished inner loop.
+            if (innermost[x] == none)
+                innermost[x] = id;
+            else
+                loops[innermost[x]].parent = id;
+            outer[x] = h;
+            for (uint32_t p : cfg.predecessors(x))
+                if (dom.dominates(h, p))
+                    work.push_back(p);
+        }
+    }
+
+    // Parents come after their children.
+    for (uint32_t id = static_cast<uint32_t>(loops.size()); id-- > 0;)
+        loops[id].depth = loops[id].parent == none ? 1 : loops[loops[id].parent].depth + 1;
+    for (uint32_t b = 0; b < n; ++b)
+        if (innermost[b] != none)
+            ++loops[innermost[b]].blocks;
+    for (uint32_t id = 0; id < loops.size(); ++id)
+        if (loops[id].parent != none)
+            loops[loops[id].parent].blocks += loops[id].blocks;
+}
@@ -1,15 +1,17 @@
-#include <fstream>
-#include <sstream>
+#include <cstdlib>
 #include <iostream>
 #include <vector>
+#include <unistd.h>
 
+#include "input.hpp"
 #include "tokens.hpp"
+#include "lexer.hpp"
+#include "token_store.hpp"
 #include "parser.hpp"
 #include "ast.hpp"
 #include "ir.hpp"
 #include "codegen.hpp"
-
-extern void scan_string_to_tokens(const std::string&, std::vector<Token>&);
+#include "ssa.hpp"
 
 const char* value_type_to_string(ValueType t)
 {
@@ -59,186 +61,390 @@ const char* token_type_to_string(TokenType t)
     }
 }
 
-void print_tokens(const std::vector<Token>& tokens)
+static void print_token(const Token& t, const Source& src)
+{
+    std::cout << "(" << token_type_to_string(t.type)
+              << ", \"" << src.value(t)
+              << "\", line " << src.line(t) << ")\n";
+}
+
+void print_tokens(const std::vector<Token>& tokens, const Source& src)
 {
     std::cout << "=== TOKENS ===\n";
     for (const auto& t : tokens)
-    {
-        std::cout << "(" << token_type_to_string(t.type)
-                  << ", \"" << t.value
-                  << "\", line " << t.line << ")\n";
-    }
+        print_token(t, src);
     std::cout << "===============\n\n";
 }
 
-void print_ast(const std::shared_ptr<Node>& node, int indent = 0)
+// Hands the tokens of a TokenSource on to the parser and prints each one as
+// it goes by, so that the streaming path dumps its tokens from the scan it
+// parses from. The dump is opened here and closed by finish().
+class TokenDump : public TokenSource
 {
-    if (!node) return;
-
-    auto pad = [&]() {
-        for (int i = 0; i < indent; ++i)
-            std::cout << "  ";
-    };
-
-    if (auto n = std::dynamic_pointer_cast<NumberNode>(node))
-    {
-        pad(); std::cout << "Number(" << n->getValue() << ")\n";
-    }
-    else if (auto id = std::dynamic_pointer_cast<IdentifierNode>(node))
-    {
-        pad(); std::cout << "Identifier(" << id->getValue() << ")\n";
-    }
-    else if (auto bin = std::dynamic_pointer_cast<BinOpNode>(node))
-    {
-        pad(); std::cout << "BinOp(" << bin->op_tok.value << ")\n";
-        print_ast(bin->left, indent + 1);
-        print_ast(bin->right, indent + 1);
-    }
-    else if (auto asg = std::dynamic_pointer_cast<AssignmentNode>(node))
-    {
-        pad(); std::cout << "Assignment(" << asg->identifier.value << ")\n";
-        print_ast(asg->expression, indent + 1);
-    }
-    else if (auto dec = std::dynamic_pointer_cast<DeclarationNode>(node))
+public:
+    TokenDump(TokenSource& tokens, const Source& src) : tokens(tokens), src(src)
     {
-        pad(); std::cout << "Declaration(type=" << value_type_to_string(dec->var_type) << ", name=" << dec->identifier.value << ")\n";
+        std::cout << "=== TOKENS ===\n";
     }
 
-    else if (auto p = std::dynamic_pointer_cast<PrintNode>(node))
+    size_t fill(Token* out, size_t max) override
     {
-        pad(); std::cout << "Print\n";
-        print_ast(p->value, indent + 1);
-    }
-    else if (auto blk = std::dynamic_pointer_cast<BlockNode>(node))
-    {
-        pad(); std::cout << "Block\n";
-        for (auto &st : blk->statements)
+        size_t n;
+        try
         {
-            print_ast(st, indent + 1);
+            n = tokens.fill(out, max);
         }
-    }
-    else if (auto iff = std::dynamic_pointer_cast<IfNode>(node))
-    {
-        pad(); std::cout << "If\n";
-
-        pad(); std::cout << "Condition:\n";
-        print_ast(iff->condition, indent + 1);
-
-        pad(); std::cout << "Then:\n";
-        print_ast(iff->then_branch, indent + 1);
-
-        if (iff->else_branch)
+        catch (...)
         {
-            pad(); std::cout << "Else:\n";
-            print_ast(iff->else_branch, indent + 1);
+            failed = true;
+            throw;
         }
+        for (size_t i = 0; i < n && !ended; ++i)
+        {
+            print_token(out[i], src);
+            ended = out[i].type == TokenType::End;
+        }
+        return n;
     }
-    else if (auto wh = std::dynamic_pointer_cast<WhileNode>(node))
-    {
-        pad(); std::cout << "While\n";
-
-        pad(); std::cout << "Condition:\n";
-        print_ast(wh->condition, indent + 1);
 
-        pad(); std::cout << "Body:\n";
-        print_ast(wh->body, indent + 1);
+    // Prints what the parser did not read, which is everything after a
+    // syntax error and nothing otherwise, and closes the dump. Does nothing
+    // once the dump is closed or the lexer has failed.
+    void finish()
+    {
+        if (closed || failed)
+            return;
+        Token t;
+        while (!ended)
+            fill(&t, 1);
+        closed = true;
+        std::cout << "===============\n\n";
     }
-}
 
-void print_ir(const GeneratedIR& ir)
+private:
+    TokenSource& tokens;
+    const Source& src;
+    bool ended{false};
+    bool closed{false};
+    bool failed{false};
+};
+
+// Prints the tree in pre-order from a stack of what is still to be printed,
+// so that deep nesting cannot overflow the native stack. Children and the
+// headings between them are pushed in reverse. Past `max_indent` levels a
+// line starts with its level instead of the blanks, which would make the
+// dump of deep nesting quadratic in its depth.
+void print_ast(const Node* root, const Source& src)
 {
-    std::cout << "=== IR ===\n";
-    if (!ir.constants.empty())
+    const int max_indent = 256;
+    struct Item
     {
-        std::cout << "[constants]\n";
-        for (const auto& kv : ir.constants)
-            std::cout << "  " << kv.first << " = " << kv.second << "\n";
-    }
+        const Node* node;
+        const char* heading; // printed instead of a node when set
+        int indent;
+    };
+    std::vector<Item> todo;
+    todo.push_back({root, nullptr, 0});
 
-    std::cout << "[code]\n";
-    for (const auto& instr : ir.code.code)
+    while (!todo.empty())
     {
-        switch (instr->kind())
+        Item item = todo.back();
+        todo.pop_back();
+        if (!item.node && !item.heading)
+            continue;
+
+        int indent = item.indent;
+        auto pad = [&]() {
+            if (indent > max_indent)
+            {
+                std::cout << "[" << indent << "] ";
+                return;
+            }
+            for (int i = 0; i < indent; ++i)
+                std::cout << "  ";
+        };
+        if (item.heading)
         {
-            case IRKind::Label:
+            pad(); std::cout << item.heading << "\n";
+            continue;
+        }
+
+        const Node* node = item.node;
+        switch (node->kind)
+        {
+            case NodeKind::Number:
+            {
+                auto n = static_cast<const NumberNode*>(node);
+                pad(); std::cout << "Number(" << n->getValue(src) << ")\n";
+                break;
+            }
+            case NodeKind::Identifier:
+            {
+                auto id = static_cast<const IdentifierNode*>(node);
+                pad(); std::cout << "Identifier(" << id->getValue(src) << ")\n";
+                break;
+            }
+            case NodeKind::BinOp:
+            {
+                auto bin = static_cast<const BinOpNode*>(node);
+                pad(); std::cout << "BinOp(" << src.value(bin->op_tok) << ")\n";
+                todo.push_back({bin->right, nullptr, indent + 1});
+                todo.push_back({bin->left, nullptr, indent + 1});
+                break;
+            }
+            case NodeKind::Assignment:
+            {
+                auto asg = static_cast<const AssignmentNode*>(node);
+                pad(); std::cout << "Assignment(" << src.value(asg->identifier) << ")\n";
+                todo.push_back({asg->expression, nullptr, indent + 1});
+                break;
+            }
+            case NodeKind::Declaration:
             {
-                auto& l = *static_cast<LabelCode*>(instr.get());
-                std::cout << l.label << ":\n";
+                auto dec = static_cast<const DeclarationNode*>(node);
+                pad(); std::cout << "Declaration(type=" << value_type_to_string(dec->var_type) << ", name=" << src.value(dec->identifier) << ")\n";
                 break;
             }
-            case IRKind::Jump:
+            case NodeKind::Print:
             {
-                auto& j = *static_cast<JumpCode*>(instr.get());
-                std::cout << "  goto " << j.dist << "\n";
+                auto p = static_cast<const PrintNode*>(node);
+                pad(); std::cout << "Print\n";
+                todo.push_back({p->value, nullptr, indent + 1});
                 break;
             }
-            case IRKind::Compare:
+            case NodeKind::Block:
             {
-                auto& c = *static_cast<CompareCodeIR*>(instr.get());
-                std::cout << "  if " << c.left << " " << c.operation << " " << c.right
-                          << " goto " << c.jump << "\n";
+                auto blk = static_cast<const BlockNode*>(node);
+                pad(); std::cout << "Block\n";
+                for (uint32_t i = blk->statements.size(); i-- > 0;)
+                    todo.push_back({blk->statements.items[i], nullptr, indent + 1});
                 break;
             }
-            case IRKind::Assignment:
+            case NodeKind::If:
             {
-                auto& a = *static_cast<AssignmentCode*>(instr.get());
-                if (a.op.empty())
-                    std::cout << "  " << a.var << " = " << a.left << "\n";
-                else
-                    std::cout << "  " << a.var << " = " << a.left << " " << a.op << " " << a.right << "\n";
+                auto iff = static_cast<const IfNode*>(node);
+                pad(); std::cout << "If\n";
+                if (iff->else_branch)
+                {
+                    todo.push_back({iff->else_branch, nullptr, indent + 1});
+                    todo.push_back({nullptr, "Else:", indent});
+                }
+                todo.push_back({iff->then_branch, nullptr, indent + 1});
+                todo.push_back({nullptr, "Then:", indent});
+                todo.push_back({iff->condition, nullptr, indent + 1});
+                todo.push_back({nullptr, "Condition:", indent});
                 break;
             }
-            case IRKind::Print:
+            case NodeKind::While:
             {
-                auto& p = *static_cast<PrintCodeIR*>(instr.get());
-                std::cout << "  print_" << p.type << " " << p.value << "\n";
+                auto wh = static_cast<const WhileNode*>(node);
+                pad(); std::cout << "While\n";
+                todo.push_back({wh->body, nullptr, indent + 1});
+                todo.push_back({nullptr, "Body:", indent});
+                todo.push_back({wh->condition, nullptr, indent + 1});
+                todo.push_back({nullptr, "Condition:", indent});
                 break;
             }
+            default:
+                break;
         }
     }
-    std::cout << "==========\n";
 }
 
-int main(int argc, char** argv)
+void print_ir(const GeneratedIR& ir, const SymbolTable& symbols)
 {
-    if(argc < 2)
+    std::cout << "=== IR ===\n";
+    bool header = false;
+    for (uint32_t id = 0; id < symbols.strings(); ++id)
     {
-        std::cerr << "usage: ./mini_compiler file.txt\n";
-        return 1;
+        if (!header)
+            std::cout << "[constants]\n";
+        header = true;
+        std::cout << "  " << ir.code.str(IROperand::string(id), symbols) << " = " << symbols.string_text(id) << "\n";
     }
 
-    std::ifstream in(argv[1]);
-    if (!in)
+    std::cout << "[code]\n";
+    const InterCodeArray& arr = ir.code;
+    for (const IRInstr& instr : arr.code)
     {
-        std::cerr << "Cannot open file\n";
-        return 1;
+        switch (instr.op)
+        {
+            case IROp::Label:
+                std::cout << ir_label(instr.dst) << ":\n";
+                break;
+            case IROp::Jump:
+                std::cout << "  goto " << ir_label(instr.dst) << "\n";
+                break;
+            case IROp::Copy:
+                std::cout << "  " << arr.str(instr.dst, symbols) << " = " << arr.str(instr.a, symbols) << "\n";
+                break;
+            case IROp::Add:
+            case IROp::Sub:
+            case IROp::Mul:
+            case IROp::Div:
+                std::cout << "  " << arr.str(instr.dst, symbols) << " = " << arr.str(instr.a, symbols) << " "
+                          << ir_op_spelling(instr.op) << " " << arr.str(instr.b, symbols) << "\n";
+                break;
+            case IROp::PrintInt:
+                std::cout << "  print_int " << arr.str(instr.a, symbols) << "\n";
+                break;
+            case IROp::PrintString:
+                std::cout << "  print_string " << arr.str(instr.a, symbols) << "\n";
+                break;
+            default:
+                std::cout << "  if " << arr.str(instr.a, symbols) << " " << ir_op_spelling(instr.op) << " "
+                          << arr.str(instr.b, symbols) << " goto " << ir_label(instr.dst) << "\n";
+                break;
+        }
     }
+    std::cout << "==========\n";
+}
+
+// The AST lives in an arena until the IR is generated and is then freed in
+// one go. With `single_pass` the parser reports straight to the IR
+// generator instead, so no AST is built or dumped; the IR and the assembly
+// are the same. With `ssa` the IR is taken into SSA form, checked, and
+// taken back out before it is dumped and code is generated from it. A
+// `dump` the tokens pass through is closed once they are parsed.
+static void compile(TokenSource& tokens, const Source& source, bool single_pass, bool ssa,
+                    TokenDump* dump = nullptr)
+{
+    SymbolTable symbols(source.symbols);
+    GeneratedIR ir;
+    if (single_pass)
+    {
+        IntermediateCodeGen irgen(source, symbols);
+        Parser(tokens, source, irgen, symbols).parse();
+        ir = irgen.take();
+    }
+    else
+    {
+        Arena ast;
+        Parser parser(tokens, source, ast, symbols);
+        auto root = parser.get_root();
+        if (dump)
+            dump->finish();
 
-    std::stringstream buffer;
-    buffer << in.rdbuf();
-    std::string src = buffer.str();
+        std::cout << "=== AST ===\n";
+        print_ast(root, source);
+        std::cout << "===========\n";
 
-    std::vector<Token> toks;
-    scan_string_to_tokens(src, toks);
+        ir = IntermediateCodeGen(root, source, symbols).take();
+    }
+    if (ssa)
+    {
+        FlowAnalysis flow(ir.code);
+        SsaForm form(ir.code, symbols, flow);
+        form.verify(flow);
+        form.destruct(flow);
+    }
+    print_ir(ir, symbols);
 
-    print_tokens(toks);
+    CodeGenerator cg(std::move(ir), symbols);
+    cg.writeAsm("output.asm");
+    std::cout << "\n[codegen] wrote NASM assembly to output.asm\n";
+}
 
-    TokenArray arr(std::move(toks));
-    Parser parser(arr);
+static bool parse_lexer_kind(const std::string& name, LexerKind& kind)
+{
+    if (name == "flex")        kind = LexerKind::Flex;
+    else if (name == "simd")   kind = best_simd_lexer();
+    else if (name == "scalar") kind = LexerKind::Scalar;
+    else if (name == "sse2")   kind = LexerKind::Sse2;
+    else if (name == "avx2")   kind = LexerKind::Avx2;
+    else return false;
+    return true;
+}
 
-    auto root = parser.get_root();
+int main(int argc, char** argv)
+{
+    const char* usage = "usage: ./mini_compiler [--lexer=simd|scalar|sse2|avx2|flex] [--jobs=N] [--single-pass] "
+                        "[--ssa] file.txt|-\n";
+    // The hand-written lexer on one job streams tokens to the parser, so the
+    // memory they take stays bounded however long the program is. Flex and
+    // --jobs other than 1 produce every token before parsing starts.
+    LexerKind lexer = best_simd_lexer();
+    unsigned jobs = 1;
+    // Batch mode: no token or AST dump, IR generated during parsing.
+    bool single_pass = false;
+    // Round trip through SSA form before code generation.
+    bool ssa = false;
+    const char* path = nullptr;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg.rfind("--lexer=", 0) == 0)
+        {
+            if (!parse_lexer_kind(arg.substr(8), lexer))
+            {
+                std::cerr << usage;
+                return 1;
+            }
+        }
+        else if (arg.rfind("--jobs=", 0) == 0)
+            jobs = static_cast<unsigned>(std::strtoul(arg.c_str() + 7, nullptr, 10));
+        else if (arg == "--single-pass")
+            single_pass = true;
+        else if (arg == "--ssa")
+            ssa = true;
+        else
+            path = argv[i];
+    }
+    if (!path)
+    {
+        std::cerr << usage;
+        return 1;
+    }
 
-    std::cout << "=== AST ===\n";
-    print_ast(root);
-    std::cout << "===========\n";
+    InputBuffer input;
+    bool loaded = std::string(path) == "-" ? input.load_fd(STDIN_FILENO) : input.load_file(path);
+    if (!loaded)
+    {
+        std::cerr << "Cannot open file\n";
+        return 1;
+    }
 
-    IntermediateCodeGen irgen(root);
-    auto ir = irgen.get();
-    print_ir(ir);
+    Source source(input.text(), true);
+    // Flex and the parallel lexer both produce the whole token vector first;
+    // --jobs only applies to the hand-written lexer (0: one job per core).
+    if (lexer == LexerKind::Flex || jobs != 1)
+    {
+        std::vector<Token> toks = lexer == LexerKind::Flex ? tokenize(source, lexer)
+                                                           : lex_parallel(source, jobs, lexer);
+        if (!single_pass)
+            print_tokens(toks, source);
 
-    CodeGenerator cg(ir.code, ir.identifiers, ir.constants, ir.tempmap);
-    cg.writeAsm("output.asm");
-    std::cout << "\n[codegen] wrote NASM assembly to output.asm\n";
+        // Parse from the columnar store; the Token vector is released first.
+        TokenStore store(toks);
+        std::vector<Token>().swap(toks);
+        TokenStoreSource tokens(store, source);
+        compile(tokens, source, single_pass, ssa);
+    }
+    else
+    {
+        // The hand-written lexer feeds the parser directly, and the token
+        // dump is printed from that one scan as the parser pulls the tokens.
+        // A syntax error stops the parse early; the rest of the tokens are
+        // then printed before it is reported, as a dump made ahead of the
+        // parse would have them.
+        Lexer lx(source, lexer);
+        LexerTokenSource tokens(lx);
+        if (single_pass)
+            compile(tokens, source, single_pass, ssa);
+        else
+        {
+            TokenDump dump(tokens, source);
+            try
+            {
+                compile(dump, source, single_pass, ssa, &dump);
+            }
+            catch (...)
+            {
+                dump.finish();
+                throw;
+            }
+        }
+    }
 
     return 0;
 }
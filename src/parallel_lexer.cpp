@@ -0,0 +1,163 @@
+#include "lexer.hpp"
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <thread>
+
+// Chunks smaller than this are not worth a thread.
+static constexpr size_t min_chunk = 1 << 20;
+
+namespace
+{
+// One speculatively lexed piece of the text. The chunk lexes into its own
+// Source so that threads never share an Interner; offsets are absolute
+// because every Lexer runs over the full text.
+struct Chunk
+{
+    Chunk(std::string_view text, uint32_t begin, uint64_t limit) : local(text), begin(begin), limit(limit) {}
+
+    Source local;
+    uint32_t begin;
+    uint64_t limit;  // tokens starting at or after this belong to the next chunk
+    std::vector<Token> tokens;
+    std::exception_ptr error;
+};
+}
+
+// Lexes from the chunk start as if no token were open there, which holds
+// unless a multi-line string literal runs across the boundary.
+static void lex_chunk(Chunk &c, LexerKind kind)
+{
+    try
+    {
+        Lexer lx(c.local, c.begin, kind);
+        for (;;)
+        {
+            Token t = lx.next();
+            if (t.offset >= c.limit)
+                break;
+            c.tokens.push_back(t);
+            if (t.type == TokenType::End)
+                break;
+        }
+    }
+    catch (...)
+    {
+        c.error = std::current_exception();
+    }
+}
+
+// Chunk boundaries: roughly equal pieces, each starting right after a
+// newline. A line start is never inside a comment, so only strings can
+// make the speculative start wrong.
+static std::vector<uint32_t> split_points(std::string_view text, unsigned jobs)
+{
+    std::vector<uint32_t> starts{0};
+    for (unsigned i = 1; i < jobs; ++i)
+    {
+        size_t target = text.size() / jobs * i;
+        if (target <= starts.back())
+            continue;
+        const void *nl = std::memchr(text.data() + target, '\n', text.size() - target);
+        if (!nl)
+            break;
+        size_t start = static_cast<const char *>(nl) - text.data() + 1;
+        if (start < text.size())
+            starts.push_back(static_cast<uint32_t>(start));
+    }
+    return starts;
+}
+
+std::vector<Token> lex_parallel(Source &src, unsigned jobs, LexerKind kind)
+{
+    if (jobs == 0)
+        jobs = std::thread::hardware_concurrency();
+    if (jobs > src.text.size() / min_chunk)
+        jobs = static_cast<unsigned>(src.text.size() / min_chunk);
+    if (jobs <= 1)
+        return lex_string_to_tokens(src, kind);
+
+    std::vector<uint32_t> starts = split_points(src.text, jobs);
+    std::vector<std::unique_ptr<Chunk>> chunks;
+    for (size_t i = 0; i < starts.size(); ++i)
+    {
+        uint64_t limit = i + 1 < starts.size() ? starts[i + 1] : uint64_t(src.text.size()) + 1;
+        chunks.push_back(std::make_unique<Chunk>(src.text, starts[i], limit));
+    }
+
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < chunks.size(); ++i)
+        workers.emplace_back(lex_chunk, std::ref(*chunks[i]), kind);
+    lex_chunk(*chunks[0], kind);
+    for (auto &w : workers)
+        w.join();
+
+    // Stitch the chunks together in text order. A chunk is taken as is when
+    // the tokens so far end at or before its start; otherwise it is
+    // re-lexed from where they end until a token lines up with one of its
+    // own, after which the speculative tokens agree with a serial scan.
+    size_t total = 0;
+    for (auto &c : chunks)
+        total += c->tokens.size();
+    std::vector<Token> out;
+    out.reserve(total);
+    uint64_t reach = 0;
+    for (auto &chunk : chunks)
+    {
+        Chunk &c = *chunk;
+        // Integer literals get their own map: a string "12" shares its symbol
+        // with the literal 12, but only the literal needs a parsed value.
+        std::vector<uint32_t> ids(c.local.symbols.size(), Interner::none);
+        std::vector<uint32_t> int_ids(c.local.symbols.size(), Interner::none);
+        auto append_from = [&](size_t j) {
+            for (; j < c.tokens.size(); ++j)
+            {
+                Token t = c.tokens[j];
+                if (t.type == TokenType::IntLit)
+                {
+                    uint32_t &id = int_ids[t.sym];
+                    if (id == Interner::none)
+                        id = src.intern_int(t.offset, t.length);
+                    t.sym = id;
+                }
+                else if (t.sym != Interner::none)
+                {
+                    uint32_t &id = ids[t.sym];
+                    if (id == Interner::none)
+                        id = src.symbols.intern(c.local.symbols.name(t.sym));
+                    t.sym = id;
+                }
+                out.push_back(t);
+            }
+            if (c.error)
+                std::rethrow_exception(c.error);
+        };
+
+        if (reach <= c.begin)
+            append_from(0);
+        else
+        {
+            Lexer lx(src, static_cast<uint32_t>(reach), kind);
+            size_t j = 0;
+            for (;;)
+            {
+                Token t = lx.next();
+                if (t.offset >= c.limit)
+                    break;
+                while (j < c.tokens.size() && c.tokens[j].offset < t.offset)
+                    ++j;
+                if (j < c.tokens.size() && c.tokens[j].offset == t.offset)
+                {
+                    append_from(j);
+                    break;
+                }
+                out.push_back(t);
+                if (t.type == TokenType::End)
+                    break;
+            }
+        }
+        if (!out.empty())
+            reach = uint64_t(out.back().offset) + out.back().length;
+    }
+    return out;
+}
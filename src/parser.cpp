@@ -1,254 +1,271 @@
 #include "parser.hpp"
+#include <array>
 #include <stdexcept>
 
-static bool is_value(const Token &t, const char *v) { return t.value == v; }
+Parser::Parser(TokenArray tokens, const Source &src, Arena &arena, SymbolTable &symbols)
+    : src(src), tree(std::make_unique<TreeBuilder>(arena)), out(*tree), symbols(symbols),
+      owned(std::make_unique<ArrayTokenSource>(std::move(tokens))), tokens(*owned) {}
 
-Parser::Parser(TokenArray tokens) : tokens(std::move(tokens)) {
-    this->tokens.appendEndIfMissing();
-}
+Parser::Parser(TokenSource &tokens, const Source &src, Arena &arena, SymbolTable &symbols)
+    : src(src), tree(std::make_unique<TreeBuilder>(arena)), out(*tree), symbols(symbols), tokens(tokens) {}
+
+Parser::Parser(TokenSource &tokens, const Source &src, AstBuilder &out, SymbolTable &symbols,
+               StatementCache *cache)
+    : src(src), out(out), symbols(symbols), cache(cache), tokens(tokens) {}
 
-void Parser::read_token_pass(const std::string &expected, const std::string &message) {
+void Parser::read_token_pass(TokenType expected, const char *message) {
     const Token &t = tokens.current();
-    if (t.value != expected)
-        throw std::runtime_error(message + " in line " + std::to_string(t.line));
+    if (t.type != expected)
+        throw std::runtime_error(std::string(message) + " in line " + std::to_string(src.line(t)));
     tokens.next();
 }
 
-std::shared_ptr<Node> Parser::factor() {
-    const Token &tok = tokens.current();
-    if (tok.type == TokenType::IntLit) {
-        tokens.next();
-        return std::make_shared<NumberNode>(tok);
-    }
-    if (tok.type == TokenType::Var) {
+// Binding power of each binary operator; 0 for tokens that cannot continue
+// an expression. A binary operator parses its right operand at one above its
+// own power, so every level is left-associative. Prefix '!' sits between
+// the logical and the comparison operators: its operand is a comparison or
+// another '!', and it may only start an operand of && or ||.
+enum : uint8_t { bp_none, bp_or, bp_and, bp_not, bp_compare, bp_add, bp_mul };
+
+static constexpr std::array<uint8_t, static_cast<size_t>(TokenType::End) + 1> binding_power = [] {
+    std::array<uint8_t, static_cast<size_t>(TokenType::End) + 1> bp{};
+    bp[static_cast<size_t>(TokenType::Or)] = bp_or;
+    bp[static_cast<size_t>(TokenType::And)] = bp_and;
+    for (TokenType t : {TokenType::Equal, TokenType::NotEqual, TokenType::Less, TokenType::LessEq,
+                        TokenType::Greater, TokenType::GreaterEq})
+        bp[static_cast<size_t>(t)] = bp_compare;
+    bp[static_cast<size_t>(TokenType::Plus)] = bp_add;
+    bp[static_cast<size_t>(TokenType::Minus)] = bp_add;
+    bp[static_cast<size_t>(TokenType::Star)] = bp_mul;
+    bp[static_cast<size_t>(TokenType::Slash)] = bp_mul;
+    return bp;
+}();
+
+// An operand that is a single token.
+void Parser::factor() {
+    Token tok = tokens.current();
+    switch (tok.type) {
+    case TokenType::IntLit:
         tokens.next();
-        return std::make_shared<IdentifierNode>(tok);
-    }
-    if (is_value(tok, "(")) {
-        tokens.next();
-        auto e = expr();
-        read_token_pass(")", "Expected )");
-        return e;
-    }
-    throw std::runtime_error("Syntax Error");
-}
-
-std::shared_ptr<Node> Parser::term() {
-    auto left = factor();
-    while (tokens.current().value == "*" || tokens.current().value == "/") {
-        Token op = tokens.current();
-        tokens.next();
-        auto right = factor();
-        auto bin = std::make_shared<BinOpNode>();
-        bin->left = left;
-        bin->op_tok = op;
-        bin->right = right;
-        left = bin;
-    }
-    return left;
-}
-
-std::shared_ptr<Node> Parser::expr() {
-    auto left = term();
-    while (tokens.current().value == "+" || tokens.current().value == "-") {
-        Token op = tokens.current();
+        out.number(tok, src.int_value(tok));
+        return;
+    case TokenType::Var:
         tokens.next();
-        auto right = term();
-        auto bin = std::make_shared<BinOpNode>();
-        bin->left = left;
-        bin->op_tok = op;
-        bin->right = right;
-        left = bin;
+        out.identifier(tok, symbols.variable(tok.sym));
+        return;
+    default:
+        throw std::runtime_error("Syntax Error");
     }
-    return left;
 }
 
-std::shared_ptr<Node> Parser::comparison() {
-    auto left = expr();
-    while (tokens.current().value == "==" || tokens.current().value == "!=" ||
-           tokens.current().value == "<" || tokens.current().value == ">") {
-        Token op = tokens.current();
-        tokens.next();
-        auto right = expr();
-        auto bin = std::make_shared<BinOpNode>();
-        bin->left = left;
-        bin->op_tok = op;
-        bin->right = right;
-        left = bin;
+// Parses the operators that bind at least as tightly as `min_bp`: bp_or for
+// a condition, bp_add for an arithmetic expression. Each operator, '!' and
+// '(' whose operand is still to come waits on `ops`; an operand of the
+// inner expression starts at its own min_bp, and when that expression ends
+// the construct it belongs to is completed and the outer one resumes.
+void Parser::expression(int min_bp) {
+    size_t base = ops.size();
+    for (;;) {
+        Token tok = tokens.current();
+        if (min_bp <= bp_not && tok.type == TokenType::Not) {
+            tokens.next();
+            ops.push_back(PendingOp{PendingOp::Not, min_bp, tok});
+            min_bp = bp_not;
+            continue;
+        }
+        if (tok.type == TokenType::LParen) {
+            tokens.next();
+            ops.push_back(PendingOp{PendingOp::Paren, min_bp, tok});
+            min_bp = bp_add;
+            continue;
+        }
+        factor();
+
+        for (;;) {
+            Token op = tokens.current();
+            int bp = binding_power[static_cast<size_t>(op.type)];
+            if (bp != bp_none && bp >= min_bp) {
+                tokens.next();
+                if (bp == bp_or || bp == bp_and)
+                    out.short_circuit(op);
+                ops.push_back(PendingOp{PendingOp::Binary, min_bp, op});
+                min_bp = bp + 1;
+                break;
+            }
+            if (ops.size() == base)
+                return;
+
+            PendingOp done = ops.back();
+            ops.pop_back();
+            if (done.kind == PendingOp::Binary)
+                out.binary(done.op);
+            else if (done.kind == PendingOp::Not)
+                out.unary(done.op);
+            else
+                read_token_pass(TokenType::RParen, "Expected )");
+            min_bp = done.min_bp;
+        }
     }
-    return left;
 }
 
-std::shared_ptr<Node> Parser::unary()
+// Reads the head of the if and opens its then block.
+void Parser::if_statement()
 {
-    if (tokens.current().value == "!")
-    {
-        Token op = tokens.current();
-        tokens.next();
-        auto right = unary();
+    size_t start = tokens.position();
+    read_token_pass(TokenType::If, "Expected 'if'");
+    read_token_pass(TokenType::LParen, "Expected '('");
 
-        auto node = std::make_shared<BinOpNode>();
-        node->op_tok = op;
-        node->left = nullptr;
-        node->right = right;
-        return node;
-    }
-    return comparison();
-}
+    expression(bp_or);
 
-std::shared_ptr<Node> Parser::logical_and()
-{
-    auto left = unary();
+    read_token_pass(TokenType::RParen, "Expected ')'");
+    out.condition();
+    read_token_pass(TokenType::LBrace, "Expected '{'");
 
-    while (tokens.current().value == "&&")
-    {
-        Token op = tokens.current();
-        tokens.next();
-        auto right = unary();
-
-        auto bin = std::make_shared<BinOpNode>();
-        bin->left = left;
-        bin->op_tok = op;
-        bin->right = right;
-        left = bin;
-    }
-    return left;
+    blocks.push_back(OpenBlock{OpenBlock::Then, 0, start, tokens.position()});
 }
 
-std::shared_ptr<Node> Parser::logical_or()
+void Parser::printing()
 {
-    auto left = logical_and();
-
-    while (tokens.current().value == "||")
-    {
-        Token op = tokens.current();
-        tokens.next();
-        auto right = logical_and();
-
-        auto bin = std::make_shared<BinOpNode>();
-        bin->left = left;
-        bin->op_tok = op;
-        bin->right = right;
-        left = bin;
-    }
-    return left;
-}
-
-std::shared_ptr<Node> Parser::if_statement()
-{
-    read_token_pass("if", "Expected 'if'");
-    read_token_pass("(", "Expected '('");
-
-    auto cond = logical_or();
-
-    read_token_pass(")", "Expected ')'");
-    read_token_pass("{", "Expected '{'");
-
-    auto then_block = statements();
-
-    read_token_pass("}", "Expected '}'");
-
-    auto node = std::make_shared<IfNode>();
-    node->condition = cond;
-    node->then_branch = then_block;
-    node->else_branch = nullptr;
-
-    if (tokens.current().type == TokenType::Else)
-    {
-        tokens.next();
-        read_token_pass("{", "Expected '{' after else'");
-        node->else_branch = statements();
-        read_token_pass("}", "Expected '}' after else");
-    }
-
-    return node;
-}
-
-std::shared_ptr<Node> Parser::printing()
-{
-    read_token_pass("cout", "Expected 'cout'");
-    read_token_pass("<<", "Expected '<<'");
-
-    std::shared_ptr<Node> value;
+    read_token_pass(TokenType::Print, "Expected 'cout'");
+    read_token_pass(TokenType::PrintBrackets, "Expected '<<'");
 
     if (tokens.current().type == TokenType::String)
     {
         Token t = tokens.current();
         tokens.next();
-        value = std::make_shared<NumberNode>(t);
+        out.string_literal(t);
     }
     else
     {
-        value = expr();
+        expression(bp_add);
     }
 
-    read_token_pass(";", "Expected ';'");
+    read_token_pass(TokenType::Semicolon, "Expected ';'");
 
-    auto node = std::make_shared<PrintNode>();
-    node->value = value;
-    return node;
+    out.print();
 }
 
-std::shared_ptr<Node> Parser::while_statement() {
-    read_token_pass("while", "Expected while");
-    read_token_pass("(", "Expected (");
-    auto cond = logical_or();
-    read_token_pass(")", "Expected )");
-    read_token_pass("{", "Expected {");
-    auto body = statements();
-    read_token_pass("}", "Expected }");
-
-    auto node = std::make_shared<WhileNode>();
-    node->condition = cond;
-    node->body = body;
-    return node;
+// Reads the head of the loop and opens its body.
+void Parser::while_statement() {
+    size_t start = tokens.position();
+    read_token_pass(TokenType::While, "Expected while");
+    out.while_start();
+    read_token_pass(TokenType::LParen, "Expected (");
+    expression(bp_or);
+    read_token_pass(TokenType::RParen, "Expected )");
+    out.condition();
+    read_token_pass(TokenType::LBrace, "Expected {");
+
+    blocks.push_back(OpenBlock{OpenBlock::Body, 0, start, tokens.position()});
 }
 
-std::shared_ptr<Node> Parser::assignment()
+void Parser::assignment()
 {
     Token ident = tokens.current();
 
-    if (!symbol_table.count(ident.value))
-        throw std::runtime_error("Undeclared variable: " + ident.value);
+    uint32_t symbol = symbols.find_variable(ident.sym);
+    if (symbol == SymbolTable::none || !symbols[symbol].declared)
+        throw std::runtime_error("Undeclared variable: " + src.value(ident));
 
     tokens.next();
-    read_token_pass("=", "Expected '='");
+    read_token_pass(TokenType::Assign, "Expected '='");
 
-    auto expr_node = expr();
+    expression(bp_add);
 
-    read_token_pass(";", "Expected ';'");
+    read_token_pass(TokenType::Semicolon, "Expected ';'");
 
-    auto node = std::make_shared<AssignmentNode>();
-    node->identifier = ident;
-    node->expression = expr_node;
-    return node;
+    out.assignment(ident, symbol);
 }
 
-std::shared_ptr<Node> Parser::get_root() {
-    return statements();
+// Statements of the innermost open block are parsed until a '}' or the end
+// of input closes it; a closed if or while then counts as one statement of
+// the block around it. With a StatementCache, every statement is first
+// offered to it for reuse.
+void Parser::parse() {
+    blocks.assign(1, OpenBlock{OpenBlock::Program, 0, 0, tokens.position()});
+    for (;;) {
+        TokenType type = tokens.current().type;
+        if (type == TokenType::End || type == TokenType::RBrace) {
+            if (close_block())
+                return;
+            continue;
+        }
+        size_t start = tokens.position();
+        if (cache) {
+            if (uint32_t reused = cache->reuse(start)) {
+                tokens.skip(reused);
+                ++blocks.back().count;
+                continue;
+            }
+        }
+        if (type == TokenType::If) {
+            if_statement();
+            continue;
+        }
+        if (type == TokenType::While) {
+            while_statement();
+            continue;
+        }
+        if (type == TokenType::IntKw || type == TokenType::StringKw)
+            declarations();
+        else if (type == TokenType::Var)
+            assignment();
+        else if (type == TokenType::Print)
+            printing();
+        else
+            throw std::runtime_error("Syntax error");
+        ++blocks.back().count;
+        if (cache)
+            cache->statement(start, tokens.position());
+    }
 }
 
+Node *Parser::get_root() {
+    if (!tree)
+        throw std::runtime_error("Parser: get_root() needs a Parser that builds into an Arena");
+    parse();
+    return tree->root();
+}
 
-std::shared_ptr<Node> Parser::statements() {
-    auto block = std::make_shared<BlockNode>();
-    while (tokens.current().value != "END" && tokens.current().value != "}") {
-        if (tokens.current().type == TokenType::If)
-            block->statements.push_back(if_statement());
-        else if (tokens.current().type == TokenType::IntKw || tokens.current().type == TokenType::StringKw)
-            block->statements.push_back(declarations());
-        else if (tokens.current().type == TokenType::While)
-            block->statements.push_back(while_statement());
-        else if (tokens.current().type == TokenType::Var)
-            block->statements.push_back(assignment());
-        else if (tokens.current().type == TokenType::Print)
-            block->statements.push_back(printing());
-        else
-            throw std::runtime_error("Syntax error");
+// Ends the innermost block and the statement it belongs to; true once that
+// is the program.
+bool Parser::close_block() {
+    OpenBlock block = blocks.back();
+    blocks.pop_back();
+    out.block(block.count);
+    if (cache)
+        cache->block(block.body, tokens.position(), block.count);
+
+    switch (block.kind) {
+    case OpenBlock::Program:
+        return true;
+    case OpenBlock::Then:
+        read_token_pass(TokenType::RBrace, "Expected '}'");
+        if (tokens.current().type == TokenType::Else) {
+            tokens.next();
+            read_token_pass(TokenType::LBrace, "Expected '{' after else'");
+            out.else_start();
+            blocks.push_back(OpenBlock{OpenBlock::Else, 0, block.start, tokens.position()});
+            return false;
+        }
+        out.if_statement(false);
+        break;
+    case OpenBlock::Else:
+        read_token_pass(TokenType::RBrace, "Expected '}' after else");
+        out.if_statement(true);
+        break;
+    case OpenBlock::Body:
+        read_token_pass(TokenType::RBrace, "Expected }");
+        out.while_statement();
+        break;
     }
-    return block;
+    ++blocks.back().count;
+    if (cache)
+        cache->statement(block.start, tokens.position());
+    return false;
 }
 
-std::shared_ptr<Node> Parser::declarations()
+void Parser::declarations()
 {
     ValueType type;
 
@@ -266,12 +283,9 @@ std::shared_ptr<Node> Parser::declarations()
         throw std::runtime_error("Expected identifier");
     tokens.next();
 
-    read_token_pass(";", "Expected ';'");
+    read_token_pass(TokenType::Semicolon, "Expected ';'");
 
-    symbol_table[ident.value] = type;
+    uint32_t symbol = symbols.declare(ident.sym, type);
 
-    auto node = std::make_shared<DeclarationNode>();
-    node->var_type = type;
-    node->identifier = ident;
-    return node;
+    out.declaration(type, ident, symbol);
 }
\ No newline at end of file
@@ -164,27 +164,8 @@ extern FILE *yyin, *yyout;
 #define EOB_ACT_END_OF_FILE 1
 #define EOB_ACT_LAST_MATCH 2
     
-    /* Note: We specifically omit the test for yy_rule_can_match_eol because it requires
-     *       access to the local variable yy_act. Since yyless() is a macro, it would break
-     *       existing scanners that call yyless() from OUTSIDE yylex.
-     *       One obvious solution it to make yy_act a global. I tried that, and saw
-     *       a 5% performance hit in a non-yylineno scanner, because yy_act is
-     *       normally declared as a register variable-- so it is not worth it.
-     */
-    #define  YY_LESS_LINENO(n) \
-            do { \
-                yy_size_t yyl;\
-                for ( yyl = n; yyl < yyleng; ++yyl )\
-                    if ( yytext[yyl] == '\n' )\
-                        --yylineno;\
-            }while(0)
-    #define YY_LINENO_REWIND_TO(dst) \
-            do {\
-                const char *p;\
-                for ( p = yy_cp-1; p >= (dst); --p)\
-                    if ( *p == '\n' )\
-                        --yylineno;\
-            }while(0)
+    #define YY_LESS_LINENO(n)
+    #define YY_LINENO_REWIND_TO(ptr)
     
 /* Return all but the first "n" matched characters back to the input stream. */
 #define yyless(n) \
@@ -474,12 +455,6 @@ static const flex_int16_t yy_chk[74] =
        41,   41,   41
     } ;
 
-/* Table of booleans, true if rule could match eol. */
-static const flex_int32_t yy_rule_can_match_eol[30] =
-    {   0,
-0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 
-    0, 0, 0, 0, 1, 0, 0, 1, 0, 0,     };
-
 static yy_state_type yy_last_accepting_state;
 static char *yy_last_accepting_cpos;
 
@@ -497,38 +472,52 @@ char *yytext;
 #line 1 "src/scanner.lx"
 #line 4 "src/scanner.lx"
 #include <string>
+#include <string_view>
 #include <vector>
 #include <stdexcept>
 #include "tokens.hpp"
+#include "keywords.hpp"
 #include <cstdio>
 
 // Match Flex-generated declarations (C++ linkage) DO NOT EDIT
 
 typedef struct yy_buffer_state *YY_BUFFER_STATE;
 int yylex(void);
-void yyrestart(FILE*);
-YY_BUFFER_STATE yy_scan_string(const char* str);
+YY_BUFFER_STATE yy_scan_bytes(const char* bytes, size_t len);
+YY_BUFFER_STATE yy_scan_buffer(char* base, size_t size);
 void yy_delete_buffer(YY_BUFFER_STATE b);
 
 static std::vector<Token>* g_tokens = nullptr;
+static Source* g_src = nullptr;
+static const char* g_base = nullptr;
 static YY_BUFFER_STATE g_buf = nullptr;
 
-void scan_to_tokens(std::vector<Token>& out) {
-    g_tokens = &out;
-    yyrestart(nullptr);
-    yylex();
+// Tokens record where they sit in the source instead of copying yytext.
+// Lines are not tracked here; see Source::lines().
+static void emit(TokenType type, uint32_t sym = Interner::none) {
+    g_tokens->push_back(Token{type, static_cast<uint32_t>(yytext - g_base),
+                              static_cast<uint32_t>(yyleng), sym});
 }
 
-void scan_string_to_tokens(const std::string& src, std::vector<Token>& out) {
+static uint32_t intern(size_t skip, size_t len) {
+    return g_src->symbols.intern(g_src->text.substr(yytext - g_base + skip, len));
+}
+
+void scan_string_to_tokens(Source& src, std::vector<Token>& out) {
     g_tokens = &out;
-    g_buf = yy_scan_string(src.c_str());
+    g_src = &src;
+    if (src.padded)
+        g_buf = yy_scan_buffer(const_cast<char*>(src.text.data()), src.text.size() + 2);
+    else
+        g_buf = yy_scan_bytes(src.text.data(), src.text.size());
+    g_base = g_buf->yy_ch_buf;
     yylex();
     yy_delete_buffer(g_buf);
     g_buf = nullptr;
 }
 
-#line 530 "src/scanner.cpp"
-#line 531 "src/scanner.cpp"
+#line 519 "src/scanner.cpp"
+#line 520 "src/scanner.cpp"
 
 #define INITIAL 0
 
@@ -743,10 +732,10 @@ YY_DECL
 		}
 
 	{
-#line 43 "src/scanner.lx"
+#line 57 "src/scanner.lx"
 
 
-#line 749 "src/scanner.cpp"
+#line 738 "src/scanner.cpp"
 
 	while ( /*CONSTCOND*/1 )		/* loops until end-of-file is reached */
 		{
@@ -792,16 +781,6 @@ yy_find_action:
 
 		YY_DO_BEFORE_ACTION;
 
-		if ( yy_act != YY_END_OF_BUFFER && yy_rule_can_match_eol[yy_act] )
-			{
-			yy_size_t yyl;
-			for ( yyl = 0; yyl < yyleng; ++yyl )
-				if ( yytext[yyl] == '\n' )
-					
-    yylineno++;
-;
-			}
-
 do_action:	/* This label is used only to access EOF actions. */
 
 		switch ( yy_act )
@@ -815,178 +794,171 @@ do_action:	/* This label is used only to access EOF actions. */
 
 case 1:
 YY_RULE_SETUP
-#line 45 "src/scanner.lx"
+#line 59 "src/scanner.lx"
 ;   // Comment
 	YY_BREAK
 case 2:
 YY_RULE_SETUP
-#line 47 "src/scanner.lx"
-{ g_tokens->push_back(Token{TokenType::Equal, yytext, yylineno}); }
+#line 61 "src/scanner.lx"
+{ emit(TokenType::Equal); }
 	YY_BREAK
 case 3:
 YY_RULE_SETUP
-#line 48 "src/scanner.lx"
-{ g_tokens->push_back(Token{TokenType::NotEqual, yytext, yylineno}); }
+#line 62 "src/scanner.lx"
+{ emit(TokenType::NotEqual); }
 	YY_BREAK
 case 4:
 YY_RULE_SETUP
-#line 49 "src/scanner.lx"
-{ g_tokens->push_back(Token{TokenType::LessEq, yytext, yylineno}); }
+#line 63 "src/scanner.lx"
+{ emit(TokenType::LessEq); }
 	YY_BREAK
 case 5:
 YY_RULE_SETUP
-#line 50 "src/scanner.lx"
-{ g_tokens->push_back(Token{TokenType::GreaterEq, yytext, yylineno}); }
+#line 64 "src/scanner.lx"
+{ emit(TokenType::GreaterEq); }
 	YY_BREAK
 case 6:
 YY_RULE_SETUP
-#line 52 "src/scanner.lx"
-{ g_tokens->push_back(Token{TokenType::And, yytext, yylineno}); }
+#line 66 "src/scanner.lx"
+{ emit(TokenType::And); }
 	YY_BREAK
 case 7:
 YY_RULE_SETUP
-#line 53 "src/scanner.lx"
-{ g_tokens->push_back(Token{TokenType::Or, yytext, yylineno}); }
+#line 67 "src/scanner.lx"
+{ emit(TokenType::Or); }
 	YY_BREAK
 case 8:
 YY_RULE_SETUP
-#line 54 "src/scanner.lx"
-{ g_tokens->push_back(Token{TokenType::Not, yytext, yylineno}); }
+#line 68 "src/scanner.lx"
+{ emit(TokenType::Not); }
 	YY_BREAK
 case 9:
 YY_RULE_SETUP
-#line 55 "src/scanner.lx"
-{ g_tokens->push_back(Token{TokenType::Less, yytext, yylineno}); }
+#line 69 "src/scanner.lx"
+{ emit(TokenType::Less); }
 	YY_BREAK
 case 10:
 YY_RULE_SETUP
-#line 56 "src/scanner.lx"
-{ g_tokens->push_back(Token{TokenType::Greater, yytext, yylineno}); }
+#line 70 "src/scanner.lx"
+{ emit(TokenType::Greater); }
 	YY_BREAK
 case 11:
 YY_RULE_SETUP
-#line 58 "src/scanner.lx"
-{ g_tokens->push_back(Token{TokenType::Semicolon, yytext, yylineno}); }
+#line 72 "src/scanner.lx"
+{ emit(TokenType::Semicolon); }
 	YY_BREAK
 case 12:
 YY_RULE_SETUP
-#line 59 "src/scanner.lx"
-{ g_tokens->push_back(Token{TokenType::Comma, yytext, yylineno}); }
+#line 73 "src/scanner.lx"
+{ emit(TokenType::Comma); }
 	YY_BREAK
 case 13:
 YY_RULE_SETUP
-#line 60 "src/scanner.lx"
-{ g_tokens->push_back(Token{TokenType::LParen, yytext, yylineno}); }
+#line 74 "src/scanner.lx"
+{ emit(TokenType::LParen); }
 	YY_BREAK
 case 14:
 YY_RULE_SETUP
-#line 61 "src/scanner.lx"
-{ g_tokens->push_back(Token{TokenType::RParen, yytext, yylineno}); }    
+#line 75 "src/scanner.lx"
+{ emit(TokenType::RParen); }    
 	YY_BREAK
 case 15:
 YY_RULE_SETUP
-#line 62 "src/scanner.lx"
-{ g_tokens->push_back(Token{TokenType::LBrace, yytext, yylineno}); }
+#line 76 "src/scanner.lx"
+{ emit(TokenType::LBrace); }
 	YY_BREAK
 case 16:
 YY_RULE_SETUP
-#line 63 "src/scanner.lx"
-{ g_tokens->push_back(Token{TokenType::RBrace, yytext, yylineno}); }
+#line 77 "src/scanner.lx"
+{ emit(TokenType::RBrace); }
 	YY_BREAK
 case 17:
 YY_RULE_SETUP
-#line 64 "src/scanner.lx"
-{ g_tokens->push_back(Token{TokenType::Assign, yytext, yylineno}); }
+#line 78 "src/scanner.lx"
+{ emit(TokenType::Assign); }
 	YY_BREAK
 case 18:
 YY_RULE_SETUP
-#line 66 "src/scanner.lx"
-{ g_tokens->push_back(Token{TokenType::Plus, yytext, yylineno}); }
+#line 80 "src/scanner.lx"
+{ emit(TokenType::Plus); }
 	YY_BREAK
 case 19:
 YY_RULE_SETUP
-#line 67 "src/scanner.lx"
-{ g_tokens->push_back(Token{TokenType::Minus, yytext, yylineno}); }
+#line 81 "src/scanner.lx"
+{ emit(TokenType::Minus); }
 	YY_BREAK
 case 20:
 YY_RULE_SETUP
-#line 68 "src/scanner.lx"
-{ g_tokens->push_back(Token{TokenType::Slash, yytext, yylineno}); }
+#line 82 "src/scanner.lx"
+{ emit(TokenType::Slash); }
 	YY_BREAK
 case 21:
 YY_RULE_SETUP
-#line 69 "src/scanner.lx"
-{ g_tokens->push_back(Token{TokenType::Star, yytext, yylineno}); }
+#line 83 "src/scanner.lx"
+{ emit(TokenType::Star); }
 	YY_BREAK
 case 22:
 YY_RULE_SETUP
-#line 71 "src/scanner.lx"
-{ g_tokens->push_back(Token{TokenType::PrintBrackets, yytext, yylineno}); }
+#line 85 "src/scanner.lx"
+{ emit(TokenType::PrintBrackets); }
 	YY_BREAK
 case 23:
 YY_RULE_SETUP
-#line 74 "src/scanner.lx"
+#line 88 "src/scanner.lx"
 {
-    std::string s(yytext, yyleng);
-    if      (s == "if")     g_tokens->push_back(Token{TokenType::If, s, yylineno});
-    else if (s == "else")   g_tokens->push_back(Token{TokenType::Else, s, yylineno});
-    else if (s == "while")  g_tokens->push_back(Token{TokenType::While, s, yylineno});
-    else if (s == "cout")  g_tokens->push_back(Token{TokenType::Print, s, yylineno});
-    else if (s == "int")    g_tokens->push_back(Token{TokenType::IntKw, s, yylineno});
-    else if (s == "string") g_tokens->push_back(Token{TokenType::StringKw, s, yylineno});
-
-    else                    g_tokens->push_back(Token{TokenType::Var, "V" + s, yylineno});
+    TokenType t = keyword_type(std::string_view(yytext, yyleng));
+    if (t == TokenType::Var) emit(t, intern(0, yyleng));
+    else                     emit(t);
 }
 	YY_BREAK
 case 24:
 /* rule 24 can match eol */
 YY_RULE_SETUP
-#line 86 "src/scanner.lx"
+#line 94 "src/scanner.lx"
 {
-    std::string s(yytext + 1, yyleng - 2);
-    g_tokens->push_back(Token{TokenType::String, s, yylineno});
+    emit(TokenType::String, intern(1, yyleng - 2));
 }
 	YY_BREAK
 case 25:
 YY_RULE_SETUP
-#line 91 "src/scanner.lx"
+#line 98 "src/scanner.lx"
 {
-    g_tokens->push_back(Token{TokenType::IntLit,
-                              std::string(yytext, yyleng), yylineno});
+    emit(TokenType::IntLit, g_src->intern_int(yytext - g_base, yyleng));
 }
 	YY_BREAK
 case 26:
 YY_RULE_SETUP
-#line 96 "src/scanner.lx"
+#line 102 "src/scanner.lx"
 ;   // Ignore whitespace
 	YY_BREAK
 case 27:
 /* rule 27 can match eol */
 YY_RULE_SETUP
-#line 97 "src/scanner.lx"
+#line 103 "src/scanner.lx"
 ;   // Ignore newlines
 	YY_BREAK
 case 28:
 YY_RULE_SETUP
-#line 99 "src/scanner.lx"
+#line 105 "src/scanner.lx"
 {
-    throw std::runtime_error("Unknown char at line " +
-                             std::to_string(yylineno));
+    int line = g_src->lines().line(static_cast<uint32_t>(yytext - g_base));
+    throw std::runtime_error("Unknown char at line " + std::to_string(line));
 }
 	YY_BREAK
 case YY_STATE_EOF(INITIAL):
-#line 104 "src/scanner.lx"
+#line 110 "src/scanner.lx"
 {
-    g_tokens->push_back(Token{TokenType::End, "END", yylineno});
+    g_tokens->push_back(Token{TokenType::End, static_cast<uint32_t>(g_src->text.size()),
+                              0, Interner::none});
     return 0;
 }
 	YY_BREAK
 case 29:
 YY_RULE_SETUP
-#line 109 "src/scanner.lx"
+#line 116 "src/scanner.lx"
 YY_FATAL_ERROR( "flex scanner jammed" );
 	YY_BREAK
-#line 989 "src/scanner.cpp"
+#line 961 "src/scanner.cpp"
 
 	case YY_END_OF_BUFFER:
 		{
@@ -1392,11 +1364,6 @@ static int yy_get_next_buffer (void)
 	*(yy_c_buf_p) = '\0';	/* preserve yytext */
 	(yy_hold_char) = *++(yy_c_buf_p);
 
-	if ( c == '\n' )
-		
-    yylineno++;
-;
-
 	return c;
 }
 #endif	/* ifndef YY_NO_INPUT */
@@ -1863,9 +1830,6 @@ static int yy_init_globals (void)
      * This function is called from yylex_destroy(), so don't allocate here.
      */
 
-    /* We do not touch yylineno unless the option is enabled. */
-    yylineno =  1;
-    
     (yy_buffer_stack) = NULL;
     (yy_buffer_stack_top) = 0;
     (yy_buffer_stack_max) = 0;
@@ -1960,6 +1924,6 @@ void yyfree (void * ptr )
 
 #define YYTABLES_NAME "yytables"
 
-#line 109 "src/scanner.lx"
+#line 116 "src/scanner.lx"
 
 
@@ -0,0 +1,474 @@
+#include "ssa.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+constexpr uint32_t none = UINT32_MAX;
+
+// Position of `p` among the predecessors of `b`, which are sorted.
+uint32_t predecessor_index(const ControlFlowGraph &cfg, uint32_t b, uint32_t p)
+{
+    BlockList preds = cfg.predecessors(b);
+    return static_cast<uint32_t>(std::lower_bound(preds.begin(), preds.end(), p) - preds.begin());
+}
+} // namespace
+
+SsaForm::SsaForm(InterCodeArray &ir, SymbolTable &symbols, FlowAnalysis &flow) : ir(ir), symbols(symbols)
+{
+    if (!flow.cfg().predecessors(flow.cfg().entry()).empty())
+    {
+        ir.code.insert(ir.code.begin(), IRInstr{IROp::Label, ir.new_label(), {}, {}});
+        ir.changed();
+    }
+    place(flow);
+    const uint32_t first_phi_temp = symbols.temps() + static_cast<uint32_t>(counts.definitions);
+    rename(flow);
+    prune(first_phi_temp);
+    ir.changed();
+}
+
+// Phis for each variable on the iterated dominance frontier of the blocks
+// assigning it, by the worklist of Cytron et al. They get provisional
+// temporaries numbered after the ones renaming will create, which prune()
+// replaces with dense ones for those that stay.
+void SsaForm::place(FlowAnalysis &flow)
+{
+    const ControlFlowGraph &cfg = flow.cfg();
+    const DominatorTree &dom = flow.dominators();
+    const DominanceFrontier &frontier = flow.frontiers();
+    const uint32_t n = cfg.size();
+    const uint32_t variables = static_cast<uint32_t>(symbols.size());
+
+    // Blocks assigning each variable, each once, grouped by variable.
+    std::vector<std::pair<uint32_t, uint32_t>> assigned; // (variable, block)
+    std::vector<uint32_t> last(variables, none);
+    for (uint32_t b : dom.order())
+        for (uint32_t i = cfg.begin(b); i < cfg.end(b); ++i)
+        {
+            const IRInstr &ins = ir.code[i];
+            if (!assigns(ins.op) || ins.dst.kind() != OperandKind::Variable)
+                continue;
+            ++counts.definitions;
+            if (last[ins.dst.id()] != b)
+            {
+                last[ins.dst.id()] = b;
+                assigned.emplace_back(ins.dst.id(), b);
+            }
+        }
+    std::vector<uint32_t> def_at(size_t(variables) + 1, 0), defs(assigned.size());
+    for (const auto &[v, b] : assigned)
+        ++def_at[v + 1];
+    for (uint32_t v = 0; v < variables; ++v)
+        def_at[v + 1] += def_at[v];
+    {
+        std::vector<uint32_t> fill(def_at.begin(), def_at.end() - 1);
+        for (const auto &[v, b] : assigned)
+            defs[fill[v]++] = b;
+    }
+
+    // For the variable being placed, v + 1 marks the blocks given a phi and
+    // those put on the worklist.
+    std::vector<uint32_t> has_phi(n, 0), queued(n, 0);
+    std::vector<uint32_t> work;
+    std::vector<Phi> placed;
+    for (uint32_t v = 0; v < variables; ++v)
+    {
+        const uint32_t mark = v + 1;
+        for (uint32_t i = def_at[v]; i < def_at[v + 1]; ++i)
+        {
+            queued[defs[i]] = mark;
+            work.push_back(defs[i]);
+        }
+        while (!work.empty())
+        {
+            const uint32_t x = work.back();
+            work.pop_back();
+            for (uint32_t y : frontier[x])
+            {
+                if (has_phi[y] == mark)
+                    continue;
+                has_phi[y] = mark;
+                placed.push_back(Phi{IROperand(), v, y, 0, cfg.predecessors(y).size()});
+                if (queued[y] != mark)
+                {
+                    queued[y] = mark;
+                    work.push_back(y);
+                }
+            }
+        }
+    }
+    counts.placed = placed.size();
+
+    // Group by block; each variable's value on entry stands in for every
+    // argument until renaming finds the one that reaches it.
+    phi_at.assign(size_t(n) + 1, 0);
+    for (const Phi &phi : placed)
+        ++phi_at[phi.block + 1];
+    for (uint32_t b = 0; b < n; ++b)
+        phi_at[b + 1] += phi_at[b];
+    phis.resize(placed.size());
+    {
+        std::vector<uint32_t> fill(phi_at.begin(), phi_at.end() - 1);
+        for (const Phi &phi : placed)
+            phis[fill[phi.block]++] = phi;
+    }
+    const uint32_t first_temp = symbols.temps() + static_cast<uint32_t>(counts.definitions);
+    for (uint32_t i = 0; i < phis.size(); ++i)
+    {
+        Phi &phi = phis[i];
+        phi.dst = IROperand::temp(first_temp + i);
+        phi.args = static_cast<uint32_t>(args.size());
+        args.insert(args.end(), phi.count, IROperand::variable(phi.variable));
+    }
+}
+
+// Walks the dominator tree keeping the temporary that holds each variable
+// on the way down; what a block defines is logged with the value it
+// replaced, and put back on the way up.
+void SsaForm::rename(FlowAnalysis &flow)
+{
+    const ControlFlowGraph &cfg = flow.cfg();
+    const DominatorTree &dom = flow.dominators();
+
+    std::vector<IROperand> current(symbols.size());
+    for (uint32_t v = 0; v < current.size(); ++v)
+        current[v] = IROperand::variable(v);
+    struct Saved
+    {
+        uint32_t variable;
+        IROperand value;
+    };
+    std::vector<Saved> saved;
+    auto define = [&](uint32_t v, IROperand value) {
+        saved.push_back(Saved{v, current[v]});
+        current[v] = value;
+    };
+    auto use = [&](IROperand &o) {
+        if (o.kind() == OperandKind::Variable)
+            o = current[o.id()];
+    };
+
+    struct Step
+    {
+        uint32_t block;
+        uint32_t child;
+        size_t saved;
+    };
+    std::vector<Step> path;
+    auto enter = [&](uint32_t b) {
+        path.push_back(Step{b, 0, saved.size()});
+        for (uint32_t i = phi_at[b]; i < phi_at[b + 1]; ++i)
+            define(phis[i].variable, phis[i].dst);
+        for (uint32_t i = cfg.begin(b); i < cfg.end(b); ++i)
+        {
+            IRInstr &ins = ir.code[i];
+            use(ins.a);
+            use(ins.b);
+            if (assigns(ins.op) && ins.dst.kind() == OperandKind::Variable)
+            {
+                IROperand t = IROperand::temp(symbols.add_temp());
+                define(ins.dst.id(), t);
+                ins.dst = t;
+            }
+        }
+        for (uint32_t s : cfg.successors(b))
+        {
+            const uint32_t k = predecessor_index(cfg, s, b);
+            for (uint32_t i = phi_at[s]; i < phi_at[s + 1]; ++i)
+                args[phis[i].args + k] = current[phis[i].variable];
+        }
+    };
+
+    enter(dom.root());
+    while (!path.empty())
+    {
+        Step &at = path.back();
+        BlockList kids = dom.children(at.block);
+        if (at.child < kids.size())
+        {
+            enter(kids[at.child++]);
+            continue;
+        }
+        for (size_t i = saved.size(); i-- > at.saved;)
+            current[saved[i].variable] = saved[i].value;
+        saved.resize(at.saved);
+        path.pop_back();
+    }
+}
+
+// Keeps the phis whose value some instruction reads, directly or through
+// other phis kept, and renumbers their temporaries densely after those of
+// the instructions.
+void SsaForm::prune(uint32_t first_phi_temp)
+{
+    auto phi_of = [&](IROperand o) {
+        return o.kind() == OperandKind::Temp && o.id() >= first_phi_temp ? o.id() - first_phi_temp : none;
+    };
+    std::vector<uint8_t> live(phis.size(), 0);
+    std::vector<uint32_t> work;
+    auto reach = [&](IROperand o) {
+        uint32_t p = phi_of(o);
+        if (p != none && !live[p])
+        {
+            live[p] = 1;
+            work.push_back(p);
+        }
+    };
+    for (const IRInstr &ins : ir.code)
+    {
+        reach(ins.a);
+        reach(ins.b);
+    }
+    while (!work.empty())
+    {
+        const Phi &phi = phis[work.back()];
+        work.pop_back();
+        for (uint32_t k = 0; k < phi.count; ++k)
+            reach(args[phi.args + k]);
+    }
+
+    std::vector<uint32_t> renumber(phis.size(), none);
+    std::vector<Phi> kept;
+    std::vector<IROperand> kept_args;
+    for (uint32_t b = 0; b + 1 < phi_at.size(); ++b)
+    {
+        const uint32_t from = phi_at[b], to = phi_at[b + 1];
+        phi_at[b] = static_cast<uint32_t>(kept.size());
+        for (uint32_t i = from; i < to; ++i)
+        {
+            if (!live[i])
+                continue;
+            Phi phi = phis[i];
+            renumber[i] = symbols.add_temp();
+            phi.dst = IROperand::temp(renumber[i]);
+            phi.args = static_cast<uint32_t>(kept_args.size());
+            kept_args.insert(kept_args.end(), args.begin() + phis[i].args,
+                             args.begin() + phis[i].args + phi.count);
+            kept.push_back(phi);
+        }
+    }
+    phi_at.back() = static_cast<uint32_t>(kept.size());
+    phis = std::move(kept);
+    args = std::move(kept_args);
+
+    auto update = [&](IROperand &o) {
+        uint32_t p = phi_of(o);
+        if (p != none)
+            o = IROperand::temp(renumber[p]);
+    };
+    for (IRInstr &ins : ir.code)
+    {
+        update(ins.a);
+        update(ins.b);
+    }
+    for (IROperand &o : args)
+        update(o);
+}
+
+void SsaForm::verify(FlowAnalysis &flow) const
+{
+    const ControlFlowGraph &cfg = flow.cfg();
+    const DominatorTree &dom = flow.dominators();
+    auto fail = [&](const std::string &what) { throw std::runtime_error("SSA: " + what); };
+
+    // Block of each temporary's definition, and its place there: 0 for a
+    // phi, the instruction's index + 1 otherwise.
+    std::vector<uint32_t> def_block(symbols.temps(), none), def_pos(symbols.temps(), 0);
+    auto define = [&](IROperand t, uint32_t b, uint32_t pos) {
+        if (t.kind() != OperandKind::Temp)
+            fail(ir.str(t, symbols) + " is assigned");
+        if (def_block[t.id()] != none)
+            fail(ir.str(t, symbols) + " is defined twice");
+        def_block[t.id()] = b;
+        def_pos[t.id()] = pos;
+    };
+
+    std::vector<uint32_t> phi_for(symbols.size(), none); // block of the variable's last phi
+    for (uint32_t b : dom.order())
+    {
+        for (uint32_t i = phi_at[b]; i < phi_at[b + 1]; ++i)
+        {
+            const Phi &phi = phis[i];
+            if (phi.count != cfg.predecessors(b).size())
+                fail("phi for " + ir.str(phi.dst, symbols) + " has " + std::to_string(phi.count) +
+                     " arguments for " + std::to_string(cfg.predecessors(b).size()) + " predecessors");
+            if (phi_for[phi.variable] == b)
+                fail("two phis join " + ir.str(IROperand::variable(phi.variable), symbols) + " in one block");
+            phi_for[phi.variable] = b;
+            define(phi.dst, b, 0);
+        }
+        for (uint32_t i = cfg.begin(b); i < cfg.end(b); ++i)
+            if (assigns(ir.code[i].op))
+                define(ir.code[i].dst, b, i + 1);
+    }
+
+    auto check = [&](IROperand o, uint32_t b, uint32_t pos) {
+        if (o.kind() != OperandKind::Temp)
+            return;
+        const uint32_t d = def_block[o.id()];
+        if (d == none)
+            fail(ir.str(o, symbols) + " is used but never defined");
+        if (d == b ? def_pos[o.id()] >= pos : !dom.dominates(d, b))
+            fail(ir.str(o, symbols) + " is used where its definition does not dominate");
+    };
+    for (uint32_t b : dom.order())
+    {
+        for (uint32_t i = cfg.begin(b); i < cfg.end(b); ++i)
+        {
+            check(ir.code[i].a, b, i + 1);
+            check(ir.code[i].b, b, i + 1);
+        }
+        // An argument is used at the very end of its predecessor.
+        BlockList preds = cfg.predecessors(b);
+        for (uint32_t i = phi_at[b]; i < phi_at[b + 1]; ++i)
+            for (uint32_t k = 0; k < phis[i].count; ++k)
+                if (dom.reachable(preds[k]))
+                    check(arg(phis[i], k), preds[k], none);
+    }
+}
+
+// Parallel copy sequentialization, Algorithm 1 of Boissinot et al. A
+// temporary copied from is looked for where `loc` says its value is now;
+// variables and immediates are never overwritten and stay where they are.
+void SsaForm::copies_into(uint32_t block, uint32_t k, std::vector<IRInstr> &out)
+{
+    moves.clear();
+    for (uint32_t i = phi_at[block]; i < phi_at[block + 1]; ++i)
+        if (phis[i].dst != arg(phis[i], k))
+            moves.push_back(Move{phis[i].dst, arg(phis[i], k)});
+    if (moves.empty())
+        return;
+
+    auto is_temp = [](IROperand o) { return o.kind() == OperandKind::Temp; };
+    auto copy = [&](IROperand dst, IROperand src) {
+        out.push_back(IRInstr{IROp::Copy, dst, src, IROperand()});
+        ++counts.copies;
+    };
+    for (const Move &m : moves)
+    {
+        loc[m.dst.id()] = IROperand();
+        if (is_temp(m.src))
+            pred[m.src.id()] = IROperand();
+    }
+    ready.clear();
+    todo.clear();
+    for (const Move &m : moves)
+    {
+        if (is_temp(m.src))
+            loc[m.src.id()] = m.src;
+        pred[m.dst.id()] = m.src;
+        todo.push_back(m.dst);
+    }
+    for (const Move &m : moves)
+        if (loc[m.dst.id()].empty())
+            ready.push_back(m.dst);
+
+    while (!todo.empty())
+    {
+        while (!ready.empty())
+        {
+            const IROperand b = ready.back();
+            ready.pop_back();
+            const IROperand a = pred[b.id()];
+            if (!is_temp(a))
+            {
+                copy(b, a);
+                continue;
+            }
+            const IROperand c = loc[a.id()];
+            copy(b, c);
+            loc[a.id()] = b;
+            if (a == c && !pred[a.id()].empty())
+                ready.push_back(a);
+        }
+        const IROperand b = todo.back();
+        todo.pop_back();
+        const IROperand a = pred[b.id()];
+        // Not copied yet, so its old value is still needed: a cycle.
+        if (is_temp(a) && b != loc[a.id()])
+        {
+            if (spare.empty())
+            {
+                spare = IROperand::temp(symbols.add_temp());
+                loc.emplace_back();
+                pred.emplace_back();
+            }
+            copy(spare, b);
+            loc[b.id()] = spare;
+            ready.push_back(b);
+            ++counts.cycles;
+        }
+    }
+}
+
+void SsaForm::destruct(FlowAnalysis &flow)
+{
+    const ControlFlowGraph &cfg = flow.cfg();
+    const std::vector<IRInstr> &code = ir.code;
+    loc.assign(symbols.temps(), IROperand());
+    pred.assign(symbols.temps(), IROperand());
+    auto has_phis = [&](uint32_t b) { return phi_at[b] != phi_at[b + 1]; };
+
+    std::vector<IRInstr> out, tail;
+    out.reserve(code.size() + code.size() / 8);
+    for (uint32_t b = 0; b < cfg.exit(); ++b)
+    {
+        const uint32_t begin = cfg.begin(b), end = cfg.end(b);
+        if (begin == end)
+            continue; // the entry of an empty program
+        const IROp last = code[end - 1].op;
+        if (!is_compare(last))
+        {
+            const bool jumps = last == IROp::Jump;
+            out.insert(out.end(), code.begin() + begin, code.begin() + end - jumps);
+            const uint32_t s = cfg.successors(b)[0];
+            if (has_phis(s))
+                copies_into(s, predecessor_index(cfg, s, b), out);
+            if (jumps)
+                out.push_back(code[end - 1]);
+            continue;
+        }
+
+        out.insert(out.end(), code.begin() + begin, code.begin() + end - 1);
+        IRInstr branch = code[end - 1];
+        const uint32_t target = cfg.block_of_label(branch.dst), next = b + 1;
+        if (target != next && has_phis(target))
+        {
+            const IROperand split = ir.new_label();
+            tail.push_back(IRInstr{IROp::Label, split, {}, {}});
+            copies_into(target, predecessor_index(cfg, target, b), tail);
+            tail.push_back(IRInstr{IROp::Jump, branch.dst, {}, {}});
+            branch.dst = split;
+            ++counts.split;
+        }
+        if (has_phis(next))
+        {
+            // Both ways lead here when the jump's target is the next block.
+            const bool both = target == next;
+            const IROperand split = both ? ir.new_label() : IROperand();
+            if (both)
+                branch.dst = split;
+            out.push_back(branch);
+            if (both)
+                out.push_back(IRInstr{IROp::Label, split, {}, {}});
+            copies_into(next, predecessor_index(cfg, next, b), out);
+            ++counts.split;
+        }
+        else
+            out.push_back(branch);
+    }
+    if (!tail.empty())
+    {
+        const IROperand done = ir.new_label();
+        out.push_back(IRInstr{IROp::Jump, done, {}, {}});
+        out.insert(out.end(), tail.begin(), tail.end());
+        out.push_back(IRInstr{IROp::Label, done, {}, {}});
+    }
+
+    ir.code = std::move(out);
+    ir.changed();
+    phis.clear();
+    args.clear();
+    std::fill(phi_at.begin(), phi_at.end(), 0);
+}
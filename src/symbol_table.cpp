@@ -0,0 +1,29 @@
+#include "symbol_table.hpp"
+
+uint32_t SymbolTable::variable(uint32_t name)
+{
+    if (name >= by_name.size())
+        by_name.resize(names.size() > name ? names.size() : name + 1, none);
+    uint32_t &id = by_name[name];
+    if (id == none)
+    {
+        id = next_id(entries.size(), "variables");
+        entries.push_back(Symbol{ValueType::Int, false, name});
+    }
+    return id;
+}
+
+uint32_t SymbolTable::declare(uint32_t name, ValueType type)
+{
+    uint32_t id = variable(name);
+    entries[id].type = type;
+    entries[id].declared = true;
+    return id;
+}
+
+uint32_t SymbolTable::add_string(uint32_t text)
+{
+    uint32_t id = next_id(contents.size(), "string constants");
+    contents.push_back(text);
+    return id;
+}
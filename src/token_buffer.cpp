@@ -0,0 +1,135 @@
+#include "token_buffer.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+TokenBuffer::TokenBuffer(std::vector<Token> tokens) : buf(std::move(tokens))
+{
+    if (buf.empty() || buf.back().type != TokenType::End)
+        throw std::runtime_error("TokenBuffer: token stream must end with End");
+    text_size = buf.back().offset;
+    // Start with some slack so that typical edits never reallocate.
+    gap_begin = buf.size();
+    buf.resize(buf.size() + initial_gap);
+    gap_end = buf.size();
+}
+
+Token TokenBuffer::operator[](size_t i) const
+{
+    if (i < gap_begin)
+        return buf[i];
+    Token t = buf[i + gap_len()];
+    t.offset = text_size - t.offset;
+    return t;
+}
+
+std::vector<Token> TokenBuffer::to_vector() const
+{
+    std::vector<Token> out;
+    out.reserve(size());
+    for (size_t i = 0; i < size(); ++i)
+        out.push_back((*this)[i]);
+    return out;
+}
+
+// Tokens crossing the gap switch between absolute and end-relative form.
+void TokenBuffer::move_gap(size_t pos)
+{
+    while (gap_begin > pos)
+    {
+        Token t = buf[--gap_begin];
+        t.offset = text_size - t.offset;
+        buf[--gap_end] = t;
+    }
+    while (gap_begin < pos)
+    {
+        Token t = buf[gap_end++];
+        t.offset = text_size - t.offset;
+        buf[gap_begin++] = t;
+    }
+}
+
+void TokenBuffer::replace(size_t first, size_t last, const std::vector<Token> &fresh)
+{
+    move_gap(first);
+    gap_end += last - first;
+
+    if (gap_len() < fresh.size())
+    {
+        const size_t tail = buf.size() - gap_end;
+        const size_t grown = buf.size() + fresh.size() + buf.size() / 8 + 64;
+        std::vector<Token> next(grown);
+        std::copy(buf.begin(), buf.begin() + gap_begin, next.begin());
+        std::copy(buf.begin() + gap_end, buf.end(), next.end() - tail);
+        gap_end = grown - tail;
+        buf.swap(next);
+    }
+    std::copy(fresh.begin(), fresh.end(), buf.begin() + gap_begin);
+    gap_begin += fresh.size();
+}
+
+std::pair<size_t, size_t> TokenBuffer::apply(Source &src, const TextEdit &edit, LexerKind kind)
+{
+    const uint64_t edit_end = uint64_t(edit.offset) + edit.removed;
+    if (edit_end > text_size || src.text.size() != text_size - edit.removed + edit.inserted.size())
+        throw std::runtime_error("TokenBuffer: edit does not match the source text");
+    src.text_changed();
+    const int64_t shift = int64_t(edit.inserted.size()) - int64_t(edit.removed);
+    const size_t n = size();
+
+    // Tokens that end strictly before the edit cannot change: the byte that
+    // terminated them is still there. Restart right after the last of them.
+    size_t lo = 0, hi = n;
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        Token t = (*this)[mid];
+        if (t.offset + t.length < edit.offset)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    const size_t first = lo;
+    uint32_t start = 0;
+    if (first)
+    {
+        Token prev = (*this)[first - 1];
+        start = prev.offset + prev.length;
+    }
+
+    Lexer lx(src, start, kind);
+    std::vector<Token> fresh;
+    size_t j = first;
+    bool synced = false;
+    for (;;)
+    {
+        Token t = lx.next();
+        Token old{};
+        while (j < n && ((old = (*this)[j]).offset < edit_end || int64_t(old.offset) + shift < int64_t(t.offset)))
+            ++j;
+        if (j < n && int64_t(old.offset) + shift == int64_t(t.offset))
+        {
+            synced = true;
+            break;
+        }
+        fresh.push_back(t);
+        if (t.type == TokenType::End)
+            break;
+    }
+
+    replace(first, synced ? j : n, fresh);
+    text_size = static_cast<uint32_t>(src.text.size());
+    return {first, first + fresh.size()};
+}
+
+size_t TokenBufferSource::fill(Token *out, size_t max)
+{
+    size_t n = 0;
+    while (n < max && next < last)
+        out[n++] = tokens[next++];
+    if (n < max && next >= last)
+    {
+        Token end = tokens[last];
+        out[n++] = Token{TokenType::End, end.offset, 0, Interner::none};
+    }
+    return n;
+}
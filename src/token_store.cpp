@@ -0,0 +1,101 @@
+#include "token_store.hpp"
+
+// Spelled length of every kind that has a fixed spelling.
+static constexpr uint8_t fixed_length[] = {
+    2, 4, 5, 3, 6, 4, 2,           // if else while int string cout <<
+    0, 0, 0,                       // Var String IntLit: from the symbol
+    1, 2, 2, 1, 2, 1, 2, 2, 2, 1,  // = == != < <= > >= && || !
+    1, 1, 1, 1, 1, 1,              // ; , ( ) { }
+    1, 1, 1, 1,                    // + - / *
+    0,                             // End
+};
+static_assert(sizeof(fixed_length) == size_t(TokenType::End) + 1,
+              "fixed_length must cover every TokenType");
+
+TokenStore::TokenStore(const std::vector<Token> &tokens)
+{
+    kinds.reserve(tokens.size());
+    offsets.reserve(tokens.size());
+    for (const Token &t : tokens)
+        push_back(t);
+}
+
+void TokenStore::push_back(const Token &t)
+{
+    if (kinds.size() % checkpoint == 0)
+        payload_base.push_back(static_cast<uint32_t>(payloads.size()));
+    kinds.push_back(static_cast<uint8_t>(t.type));
+    offsets.push_back(t.offset);
+    if (has_payload(t.type))
+        payloads.push_back(t.sym);
+}
+
+// Payload slot of token i: the checkpoint's slot plus the payload-carrying
+// tokens between the checkpoint and i.
+size_t TokenStore::payload_index(size_t i) const
+{
+    size_t base = i / checkpoint;
+    size_t index = payload_base[base];
+    for (size_t k = base * checkpoint; k < i; ++k)
+        index += has_payload(static_cast<TokenType>(kinds[k]));
+    return index;
+}
+
+uint32_t TokenStore::sym(size_t i) const
+{
+    return has_payload(kind(i)) ? payloads[payload_index(i)] : Interner::none;
+}
+
+uint32_t TokenStore::length(size_t i, const Source &src) const
+{
+    TokenType t = kind(i);
+    if (!has_payload(t))
+        return fixed_length[kinds[i]];
+    uint32_t len = static_cast<uint32_t>(src.symbols.name(sym(i)).size());
+    return t == TokenType::String ? len + 2 : len;
+}
+
+int TokenStore::line(size_t i, const Source &src) const
+{
+    return src.lines().line(offsets[i] + length(i, src));
+}
+
+Token TokenStore::get(size_t i, const Source &src) const
+{
+    return Token{kind(i), offsets[i], length(i, src), sym(i)};
+}
+
+size_t TokenStore::bytes() const
+{
+    return kinds.capacity() * sizeof(uint8_t) + offsets.capacity() * sizeof(uint32_t) +
+           payloads.capacity() * sizeof(uint32_t) + payload_base.capacity() * sizeof(uint32_t);
+}
+
+size_t TokenStoreSource::fill(Token *out, size_t max)
+{
+    size_t n = 0;
+    while (n < max)
+    {
+        if (next == store.size())
+        {
+            // A store without a trailing End still ends the stream.
+            out[n++] = Token{TokenType::End, static_cast<uint32_t>(src.text.size()), 0, Interner::none};
+            break;
+        }
+        TokenType kind = store.kind(next);
+        Token t{kind, store.offsets[next], 0, Interner::none};
+        if (TokenStore::has_payload(kind))
+        {
+            // Walking in order, the payload column is consumed in order too.
+            t.sym = store.payloads[payload++];
+            t.length = static_cast<uint32_t>(src.symbols.name(t.sym).size()) + (kind == TokenType::String ? 2 : 0);
+        }
+        else
+            t.length = fixed_length[size_t(kind)];
+        out[n++] = t;
+        if (kind == TokenType::End)
+            break;
+        ++next;
+    }
+    return n;
+}
@@ -0,0 +1,38 @@
+#include "token_stream.hpp"
+#include <algorithm>
+
+static_assert((TokenStream::capacity & (TokenStream::capacity - 1)) == 0,
+              "TokenStream capacity must be a power of two");
+
+void TokenSource::skip(size_t n)
+{
+    Token scratch[64];
+    while (n)
+        n -= fill(scratch, n < 64 ? n : 64);
+}
+
+ArrayTokenSource::ArrayTokenSource(TokenArray tokens) : arr(std::move(tokens))
+{
+    arr.appendEndIfMissing();
+}
+
+size_t ArrayTokenSource::fill(Token *out, size_t max)
+{
+    size_t n = 0;
+    while (n < max)
+    {
+        out[n++] = arr.current();
+        if (arr.current().type == TokenType::End)
+            break;
+        arr.next();
+    }
+    return n;
+}
+
+void TokenStream::refill()
+{
+    // Fill the contiguous free run after the last buffered token.
+    size_t tail = (head + count) & (capacity - 1);
+    size_t room = std::min(capacity - count, capacity - tail);
+    count += source.fill(buf + tail, room);
+}
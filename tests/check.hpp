@@ -0,0 +1,64 @@
+#pragma once
+// What the tests share. Each test is a program that prints every check that
+// failed and exits non-zero if there was one; ctest runs them.
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "tokens.hpp"
+
+inline int &failures()
+{
+    static int count = 0;
+    return count;
+}
+
+inline void check(bool ok, const std::string &what)
+{
+    if (!ok)
+    {
+        std::fprintf(stderr, "FAIL: %s\n", what.c_str());
+        ++failures();
+    }
+}
+
+// Prints a summary line and gives the exit status.
+inline int report(const char *test)
+{
+    if (failures())
+        std::fprintf(stderr, "%s: %d check(s) failed\n", test, failures());
+    else
+        std::printf("%s: ok\n", test);
+    return failures() ? 1 : 0;
+}
+
+// Whether two token streams are the same, each read against its own Source:
+// symbol ids are per Source, so symbols are compared by spelling, and
+// integer literals by value as well. `why` says where they first differ.
+inline bool same_tokens(const Source &a, const std::vector<Token> &x, const Source &b,
+                        const std::vector<Token> &y, std::string &why)
+{
+    for (size_t i = 0; i < x.size() && i < y.size(); ++i)
+    {
+        const Token &s = x[i], &t = y[i];
+        bool same = s.type == t.type && s.offset == t.offset && s.length == t.length &&
+                    (s.sym == Interner::none) == (t.sym == Interner::none);
+        if (same && s.sym != Interner::none)
+            same = a.name(s) == b.name(t);
+        if (same && s.type == TokenType::IntLit)
+            same = a.int_value(s) == b.int_value(t);
+        if (!same)
+        {
+            why = "token " + std::to_string(i) + " at offset " + std::to_string(s.offset) + ": \"" +
+                  std::string(a.spelling(s)) + "\" vs \"" + std::string(b.spelling(t)) + "\"";
+            return false;
+        }
+    }
+    if (x.size() != y.size())
+    {
+        why = std::to_string(x.size()) + " tokens vs " + std::to_string(y.size());
+        return false;
+    }
+    return true;
+}
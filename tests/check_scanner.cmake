@@ -0,0 +1,16 @@
+# Runs flex on src/scanner.lx and fails unless the output is the committed
+# src/scanner.cpp, byte for byte. flex names its output file in #line
+# directives; writing to stdout it says <stdout> instead.
+execute_process(COMMAND ${FLEX} -t src/scanner.lx
+                WORKING_DIRECTORY ${SOURCE_DIR}
+                OUTPUT_VARIABLE generated
+                RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+  message(FATAL_ERROR "flex failed on src/scanner.lx")
+endif()
+string(REPLACE "\"<stdout>\"" "\"src/scanner.cpp\"" generated "${generated}")
+file(READ ${SOURCE_DIR}/src/scanner.cpp committed)
+if(NOT generated STREQUAL committed)
+  message(FATAL_ERROR "src/scanner.cpp is not flex's output for src/scanner.lx; "
+                      "rebuild it with the regen_scanner target")
+endif()
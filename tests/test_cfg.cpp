@@ -0,0 +1,295 @@
+// The control-flow analyses on small programs written as IR, whose answers
+// are known: a diamond, two nested loops, a block no jump reaches, and a
+// loop left from two places. For each, the blocks and edges of the
+// ControlFlowGraph, the immediate dominators and post-dominators, the
+// dominance frontiers and the loops of the LoopNest are checked against
+// the numbering in the comment above it. FlowAnalysis must compute each of
+// them once, however often it is asked, and again after changed().
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "check.hpp"
+#include "flow_analysis.hpp"
+
+static const uint32_t none = DominatorTree::none;
+
+// Writes IR by hand. Branches compare variable 0 with 0.
+struct Code
+{
+    InterCodeArray ir;
+
+    IROperand label() { return ir.new_label(); }
+    void place(IROperand l) { ir.append(IRInstr{IROp::Label, l, IROperand(), IROperand()}); }
+    void print() { ir.append(IRInstr{IROp::PrintInt, IROperand(), ir.immediate(1), IROperand()}); }
+    void jump(IROperand l) { ir.append(IRInstr{IROp::Jump, l, IROperand(), IROperand()}); }
+    void branch(IROp op, IROperand l) { ir.append(IRInstr{op, l, IROperand::variable(0), ir.immediate(0)}); }
+};
+
+static std::string ids(const std::vector<uint32_t> &blocks)
+{
+    std::string s = "{";
+    for (uint32_t b : blocks)
+        s += (s.size() > 1 ? ", " : "") + std::to_string(b);
+    return s + "}";
+}
+
+static void same_blocks(BlockList got, std::vector<uint32_t> expected, bool ordered, const std::string &what)
+{
+    std::vector<uint32_t> blocks(got.begin(), got.end());
+    if (!ordered)
+    {
+        std::sort(blocks.begin(), blocks.end());
+        std::sort(expected.begin(), expected.end());
+    }
+    check(blocks == expected, what + " are " + ids(blocks) + ", not " + ids(expected));
+}
+
+// Checks the graph, both trees and the frontiers against what is expected
+// of each block: successors in order, immediate dominator and immediate
+// post-dominator, and dominance frontier.
+struct Expected
+{
+    std::vector<uint32_t> successors;
+    uint32_t idom, ipdom;
+    std::vector<uint32_t> frontier;
+};
+
+static void check_graph(FlowAnalysis &flow, const std::vector<Expected> &blocks, const std::string &name)
+{
+    const ControlFlowGraph &cfg = flow.cfg();
+    check(cfg.size() == blocks.size() + 1,
+          name + ": " + std::to_string(cfg.size()) + " blocks, not " + std::to_string(blocks.size() + 1));
+    if (cfg.size() != blocks.size() + 1)
+        return;
+    const DominatorTree &dom = flow.dominators(), &post = flow.post_dominators();
+    const DominanceFrontier &df = flow.frontiers();
+    const uint32_t exit = cfg.exit();
+    check(cfg.successors(exit).empty(), name + ": the exit has successors");
+    check(post.root() == exit && dom.root() == cfg.entry(), name + ": the trees are not rooted at entry and exit");
+    for (uint32_t b = 0; b < blocks.size(); ++b)
+    {
+        const Expected &e = blocks[b];
+        const std::string at = name + ", block " + std::to_string(b);
+        same_blocks(cfg.successors(b), e.successors, true, at + ": successors");
+        for (uint32_t s : e.successors)
+        {
+            BlockList preds = cfg.predecessors(s);
+            check(std::find(preds.begin(), preds.end(), b) != preds.end(),
+                  at + ": not a predecessor of its successor " + std::to_string(s));
+        }
+        check(dom.idom(b) == e.idom, at + ": immediate dominator " + std::to_string(dom.idom(b)));
+        check(post.idom(b) == e.ipdom, at + ": immediate post-dominator " + std::to_string(post.idom(b)));
+        check(dom.reachable(b) == (b == 0 || e.idom != none), at + ": reachable from the entry or not");
+        if (e.idom != none)
+            check(dom.dominates(e.idom, b) && !dom.dominates(b, e.idom) && dom.dominates(0, b),
+                  at + ": dominates() disagrees with idom()");
+        if (dom.reachable(b))
+            same_blocks(df[b], e.frontier, false, at + ": dominance frontier");
+    }
+}
+
+static void check_loop(const LoopNest &nest, uint32_t id, uint32_t header, uint32_t parent, uint32_t depth,
+                       uint32_t blocks, const std::string &name)
+{
+    const std::string at = name + ", loop " + std::to_string(id);
+    if (id >= nest.size())
+    {
+        check(false, at + ": missing");
+        return;
+    }
+    const LoopNest::Loop &l = nest[id];
+    check(l.header == header, at + ": header " + std::to_string(l.header));
+    check(l.parent == parent, at + ": parent " + std::to_string(l.parent));
+    check(l.depth == depth, at + ": depth " + std::to_string(l.depth));
+    check(l.blocks == blocks, at + ": " + std::to_string(l.blocks) + " blocks");
+}
+
+//   0: print; if goto L1          -> 2, 1
+//   1: print; goto L2             -> 3
+//   2: L1: print                  -> 3
+//   3: L2: print                  -> exit 4
+static void diamond()
+{
+    Code c;
+    IROperand l1 = c.label(), l2 = c.label();
+    c.print();
+    c.branch(IROp::JumpLt, l1);
+    c.print();
+    c.jump(l2);
+    c.place(l1);
+    c.print();
+    c.place(l2);
+    c.print();
+
+    FlowAnalysis flow(c.ir);
+    check_graph(flow,
+                {
+                    {{2, 1}, none, 3, {}},
+                    {{3}, 0, 3, {3}},
+                    {{3}, 0, 3, {3}},
+                    {{4}, 0, 4, {}},
+                },
+                "diamond");
+    check(flow.loops().size() == 0, "diamond: has a loop");
+    check(flow.cfg().edges() == 5, "diamond: " + std::to_string(flow.cfg().edges()) + " edges");
+}
+
+//   0: print                       -> 1
+//   1: L1: if goto L4              -> 5, 2    outer header
+//   2: L2: if goto L3              -> 4, 3    inner header
+//   3: print; goto L2              -> 2
+//   4: L3: goto L1                 -> 1
+//   5: L4: print                   -> exit 6
+static Code nested_loops()
+{
+    Code c;
+    IROperand l1 = c.label(), l2 = c.label(), l3 = c.label(), l4 = c.label();
+    c.print();
+    c.place(l1);
+    c.branch(IROp::JumpGe, l4);
+    c.place(l2);
+    c.branch(IROp::JumpGe, l3);
+    c.print();
+    c.jump(l2);
+    c.place(l3);
+    c.jump(l1);
+    c.place(l4);
+    c.print();
+    return c;
+}
+
+static void nested()
+{
+    Code c = nested_loops();
+    FlowAnalysis flow(c.ir);
+    check_graph(flow,
+                {
+                    {{1}, none, 1, {}},
+                    {{5, 2}, 0, 5, {1}},
+                    {{4, 3}, 1, 4, {1, 2}},
+                    {{2}, 2, 2, {2}},
+                    {{1}, 2, 1, {1}},
+                    {{6}, 1, 6, {}},
+                },
+                "nested loops");
+
+    // Innermost first.
+    const LoopNest &nest = flow.loops();
+    check(nest.size() == 2, "nested loops: " + std::to_string(nest.size()) + " loops");
+    check_loop(nest, 0, 2, 1, 2, 2, "nested loops");
+    check_loop(nest, 1, 1, LoopNest::none, 1, 4, "nested loops");
+    const uint32_t depths[] = {0, 1, 2, 2, 1, 0, 0};
+    for (uint32_t b = 0; b < 7; ++b)
+        check(nest.depth(b) == depths[b], "nested loops, block " + std::to_string(b) + ": depth " +
+                                              std::to_string(nest.depth(b)));
+    check(nest.contains(1, 3) && !nest.contains(0, 4), "nested loops: contains() is wrong");
+}
+
+//   0: print; goto L1              -> 2
+//   1: print                       -> 2    no jump reaches it
+//   2: L1: print                   -> exit 3
+static void unreachable()
+{
+    Code c;
+    IROperand l1 = c.label();
+    c.print();
+    c.jump(l1);
+    c.print();
+    c.place(l1);
+    c.print();
+
+    FlowAnalysis flow(c.ir);
+    check_graph(flow,
+                {
+                    {{2}, none, 2, {}},
+                    {{2}, none, 2, {}},
+                    {{3}, 0, 3, {}},
+                },
+                "unreachable block");
+    const DominatorTree &dom = flow.dominators();
+    check(!dom.dominates(0, 1) && !dom.dominates(1, 1), "unreachable block: is dominated");
+    check(dom.order().size() == 3, "unreachable block: in the reverse post-order");
+    check(flow.post_dominators().reachable(1), "unreachable block: does not reach the exit");
+}
+
+//   0: print                       -> 1
+//   1: L1: if goto L2              -> 4, 2    header, first exit
+//   2: print; if goto L2           -> 4, 3    second exit
+//   3: print; goto L1              -> 1
+//   4: L2: print                   -> exit 5
+static void two_exits()
+{
+    Code c;
+    IROperand l1 = c.label(), l2 = c.label();
+    c.print();
+    c.place(l1);
+    c.branch(IROp::JumpGe, l2);
+    c.print();
+    c.branch(IROp::JumpEq, l2);
+    c.print();
+    c.jump(l1);
+    c.place(l2);
+    c.print();
+
+    FlowAnalysis flow(c.ir);
+    check_graph(flow,
+                {
+                    {{1}, none, 1, {}},
+                    {{4, 2}, 0, 4, {1}},
+                    {{4, 3}, 1, 4, {1, 4}},
+                    {{1}, 2, 1, {1}},
+                    {{5}, 1, 5, {}},
+                },
+                "loop with two exits");
+
+    const LoopNest &nest = flow.loops();
+    check(nest.size() == 1, "loop with two exits: " + std::to_string(nest.size()) + " loops");
+    check_loop(nest, 0, 1, LoopNest::none, 1, 3, "loop with two exits");
+    const ControlFlowGraph &cfg = flow.cfg();
+    uint32_t exits = 0;
+    for (uint32_t b = 0; b < cfg.size(); ++b)
+        if (nest.contains(0, b))
+            for (uint32_t s : cfg.successors(b))
+                exits += !nest.contains(0, s);
+    check(exits == 2, "loop with two exits: left by " + std::to_string(exits) + " edges");
+}
+
+// Each analysis is computed once however often it is asked for, all are
+// dropped by changed(), and those asked for again describe the new code.
+static void cache()
+{
+    Code c = nested_loops();
+    FlowAnalysis flow(c.ir);
+    for (int i = 0; i < 3; ++i)
+    {
+        flow.cfg();
+        flow.dominators();
+        flow.post_dominators();
+        flow.frontiers();
+        flow.loops();
+    }
+    const FlowAnalysis::Stats &s = flow.stats();
+    check(s.cfg == 1 && s.dominators == 1 && s.post_dominators == 1 && s.frontiers == 1 && s.loops == 1,
+          "cache: an analysis was computed more than once");
+
+    // The inner loop's back edge now leaves it: one loop is left.
+    c.ir.code[6].dst = c.ir.code[7].dst;
+    c.ir.changed();
+    check(flow.loops().size() == 1, "cache: " + std::to_string(flow.loops().size()) + " loops after a change");
+    check(s.cfg == 2 && s.dominators == 2 && s.loops == 2, "cache: the loops are not recomputed after changed()");
+    check(s.post_dominators == 1 && s.frontiers == 1, "cache: an analysis not asked for was recomputed");
+    flow.loops();
+    check(s.cfg == 2 && s.loops == 2, "cache: recomputed twice after one change");
+}
+
+int main()
+{
+    diamond();
+    nested();
+    unreachable();
+    two_exits();
+    cache();
+    return report("cfg");
+}
@@ -0,0 +1,100 @@
+// Runs the compiler on programs nesting a million levels deep: parentheses
+// around a literal, if blocks and while blocks inside each other. Each goes
+// through lexing, parsing, the token, AST and IR dumps and code generation;
+// the run must succeed, print every section, and the AST dump must show
+// every level.
+//
+//   ./test_deep_nesting path/to/compiler
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <sys/wait.h>
+
+#include "check.hpp"
+
+static const size_t depth = 1000000;
+
+// x = ((( ... (1) ... )));
+static std::string parens()
+{
+    return "int x;\nx = " + std::string(depth, '(') + "1" + std::string(depth, ')') + ";\n";
+}
+
+static std::string blocks(const char *head)
+{
+    std::string text = "int x;\n";
+    for (size_t d = 0; d < depth; ++d)
+        text += head;
+    text += "x = x + 1;\n";
+    for (size_t d = 0; d < depth; ++d)
+        text += "}\n";
+    return text;
+}
+
+// Compiles `text` and counts the dump's lines that are `node` once the
+// indentation is taken off.
+static void run(const char *compiler, const char *name, const std::string &text, const char *node,
+                size_t expected)
+{
+    const std::string path = std::string("deep_") + name + ".txt";
+    if (FILE *f = std::fopen(path.c_str(), "wb"))
+    {
+        std::fwrite(text.data(), 1, text.size(), f);
+        std::fclose(f);
+    }
+    FILE *out = popen((std::string(compiler) + " " + path).c_str(), "r");
+    if (!out)
+    {
+        check(false, std::string(name) + ": cannot run " + compiler);
+        return;
+    }
+
+    size_t nodes = 0, sections = 0;
+    bool ast = false;
+    std::string line;
+    char buf[4096];
+    while (std::fgets(buf, sizeof buf, out))
+    {
+        line += buf;
+        if (line.back() != '\n')
+            continue;
+        line.pop_back();
+        if (line.compare(0, 4, "=== ") == 0)
+        {
+            ++sections;
+            ast = line == "=== AST ===";
+        }
+        else if (line.compare(0, 3, "===") == 0)
+            ast = false;
+        else if (ast)
+        {
+            // "  Node" or, past the deepest indentation, "[level] Node".
+            size_t start = line.find_first_not_of(' ');
+            if (start != std::string::npos && line[start] == '[')
+                start = line.find("] ", start) + 2;
+            nodes += start != std::string::npos && line.compare(start, std::string::npos, node) == 0;
+        }
+        line.clear();
+    }
+    const int status = pclose(out);
+    std::remove(path.c_str());
+
+    check(status != -1 && WIFEXITED(status) && WEXITSTATUS(status) == 0,
+          std::string(name) + ": compiler failed");
+    check(sections == 3, std::string(name) + ": " + std::to_string(sections) + " of the 3 dumps printed");
+    check(nodes == expected, std::string(name) + ": " + std::to_string(nodes) + " " + node + " nodes printed");
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        std::fprintf(stderr, "usage: %s path/to/compiler\n", argv[0]);
+        return 2;
+    }
+    run(argv[1], "parentheses", parens(), "Number(1)", 1);
+    run(argv[1], "if", blocks("if (x < 1) {\n"), "If", depth);
+    run(argv[1], "while", blocks("while (x < 1) {\n"), "While", depth);
+    return report("deep_nesting");
+}
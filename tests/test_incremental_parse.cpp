@@ -0,0 +1,247 @@
+// Incremental reparsing against a fresh parse. A generated program goes
+// through random edits, each re-lexed by TokenBuffer::apply() and brought
+// into the tree by IncrementalParser::reparse(); after each, the tree must
+// be the one Parser builds from the edited text on its own.
+//
+// Most edits stay inside a statement or a block (numbers, conditions,
+// statements inserted, deleted or wrapped in an if, comments); some must
+// make reparse() fall back to the whole program (a declaration added), and
+// the test checks that they do, and that the others reuse statements.
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "check.hpp"
+#include "corpus.hpp"
+#include "incremental_parser.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
+#include "token_buffer.hpp"
+#include "token_store.hpp"
+
+// Writes out what a traversal reports, spelling variables and strings by
+// their text, since the two trees come from different Sources.
+struct Recorder
+{
+    const Source &src;
+    std::string out;
+
+    void add(const char *what, std::string_view detail = {})
+    {
+        out += what;
+        out += detail;
+        out += ' ';
+    }
+    void number(Token, int64_t value) { add("num:", std::to_string(value)); }
+    void string_literal(Token tok) { add("str:", src.name(tok)); }
+    void identifier(Token tok, uint32_t) { add("id:", src.name(tok)); }
+    void unary(Token op) { add("unary:", std::to_string(int(op.type))); }
+    void short_circuit(Token op) { add("sc:", std::to_string(int(op.type))); }
+    void binary(Token op) { add("bin:", std::to_string(int(op.type))); }
+    void declaration(ValueType type, Token tok, uint32_t)
+    {
+        add(type == ValueType::Int ? "int:" : "string:", src.name(tok));
+    }
+    void assignment(Token tok, uint32_t) { add("set:", src.name(tok)); }
+    void print() { add("print"); }
+    void block(uint32_t count) { add("block:", std::to_string(count)); }
+    void while_start() { add("while_start"); }
+    void condition() { add("cond"); }
+    void else_start() { add("else"); }
+    void if_statement(bool has_else) { add(has_else ? "if_else" : "if"); }
+    void while_statement() { add("while"); }
+};
+
+static std::string record(const Node *root, const Source &src)
+{
+    Recorder r{src, {}};
+    replay(root, r);
+    return r.out;
+}
+
+// The tree Parser builds from `text`, recorded.
+static std::string fresh_parse(const std::string &text)
+{
+    Source source(text);
+    std::vector<Token> tokens = tokenize(source, best_simd_lexer());
+    TokenStore store(tokens);
+    TokenStoreSource feed(store, source);
+    Arena arena;
+    SymbolTable symbols(source.symbols);
+    Parser parser(feed, source, arena, symbols);
+    return record(parser.get_root(), source);
+}
+
+static bool is_comparison(TokenType t)
+{
+    return t == TokenType::Less || t == TokenType::Greater || t == TokenType::Equal || t == TokenType::NotEqual;
+}
+
+struct Session
+{
+    std::string text;
+    Source source;
+    TokenBuffer tokens;
+    IncrementalParser parser;
+    std::mt19937 rng;
+
+    Session(std::string program, uint32_t seed)
+        : text(std::move(program)), source(text), tokens(tokenize(source, best_simd_lexer())),
+          parser(tokens, source), rng(seed)
+    {
+        parser.parse();
+    }
+
+    // Index of the first token from a random place on that `want` accepts.
+    template <class Want>
+    size_t find(Want want)
+    {
+        for (;;)
+            for (size_t i = rng() % tokens.size(); i + 1 < tokens.size(); ++i)
+                if (want(i))
+                    return i;
+    }
+
+    // A statement start: just after ';', '{' or '}', or the first token.
+    bool statement_start(size_t i)
+    {
+        if (i == 0)
+            return true;
+        TokenType prev = tokens[i - 1].type;
+        return prev == TokenType::Semicolon || prev == TokenType::LBrace || prev == TokenType::RBrace;
+    }
+
+    // An assignment that is a statement of its own: [first, last] tokens.
+    std::pair<size_t, size_t> assignment()
+    {
+        size_t first = find([&](size_t i) {
+            return tokens[i].type == TokenType::Var && tokens[i + 1].type == TokenType::Assign && statement_start(i);
+        });
+        size_t last = first;
+        while (tokens[last].type != TokenType::Semicolon)
+            ++last;
+        return {first, last};
+    }
+
+    void edit(uint32_t offset, uint32_t removed, const std::string &inserted)
+    {
+        text.replace(offset, removed, inserted);
+        source.text = text;
+        source.text_changed();
+        auto range = tokens.apply(source, TextEdit{offset, removed, inserted});
+        parser.reparse(range.first, range.second);
+    }
+
+    void change_number()
+    {
+        Token t = tokens[find([&](size_t i) { return tokens[i].type == TokenType::IntLit; })];
+        edit(t.offset, t.length, std::to_string(rng() % 100000));
+    }
+
+    void insert_statement()
+    {
+        auto [first, last] = assignment();
+        Token a = tokens[first], b = tokens[last];
+        edit(a.offset, 0, text.substr(a.offset, b.offset + 1 - a.offset) + "\n");
+    }
+
+    void delete_statement()
+    {
+        auto [first, last] = assignment();
+        Token a = tokens[first], b = tokens[last];
+        edit(a.offset, b.offset + 1 - a.offset, "");
+    }
+
+    // Puts an assignment inside an if of its own, adding a block.
+    void wrap_statement()
+    {
+        auto [first, last] = assignment();
+        Token a = tokens[first], b = tokens[last];
+        std::string stmt = text.substr(a.offset, b.offset + 1 - a.offset);
+        edit(a.offset, b.offset + 1 - a.offset, "if (1 < 2) {\n" + stmt + "\n}");
+    }
+
+    void edit_condition()
+    {
+        size_t i = find([&](size_t i) { return tokens[i].type == TokenType::If || tokens[i].type == TokenType::While; });
+        while (!is_comparison(tokens[i].type))
+            ++i;
+        Token t = tokens[i];
+        const char *by = t.type == TokenType::Less      ? ">"
+                         : t.type == TokenType::Greater ? "<"
+                         : t.type == TokenType::Equal   ? "!="
+                                                        : "==";
+        edit(t.offset, t.length, by);
+    }
+
+    // A comment between two tokens: the tokens stay, their offsets move.
+    void insert_comment()
+    {
+        Token t = tokens[rng() % (tokens.size() - 1)];
+        edit(t.offset, 0, "# note\n");
+    }
+
+    // A declaration of a new variable between two statements, which
+    // reparse() answers with a parse of the whole program.
+    void insert_declaration(int n)
+    {
+        Token t = tokens[find([&](size_t i) { return statement_start(i) && tokens[i].type != TokenType::End; })];
+        edit(t.offset, 0, "int added_" + std::to_string(n) + ";\n");
+    }
+};
+
+int main()
+{
+    struct Kind
+    {
+        const char *name;
+        void (Session::*run)();
+    } kinds[] = {
+        {"change a number", &Session::change_number},   {"insert a statement", &Session::insert_statement},
+        {"delete a statement", &Session::delete_statement}, {"wrap a statement", &Session::wrap_statement},
+        {"edit a condition", &Session::edit_condition},  {"insert a comment", &Session::insert_comment},
+    };
+
+    size_t edits = 0, reused = 0, whole = 0;
+    for (uint32_t seed = 1; seed <= 4; ++seed)
+    {
+        std::string text;
+        CorpusGenerator(seed).generate(text, 24 << 10);
+        Session s(std::move(text), seed);
+        check(record(s.parser.root(), s.source) == fresh_parse(s.text), "first parse differs from Parser");
+
+        for (int e = 0; e < 150; ++e)
+        {
+            const Kind &k = kinds[s.rng() % (sizeof kinds / sizeof *kinds)];
+            const bool declare = e % 25 == 24;
+            std::string name = declare ? "insert a declaration" : k.name;
+            if (declare)
+                s.insert_declaration(e);
+            else
+                (s.*k.run)();
+            ++edits;
+            reused += s.parser.stats().reused;
+            whole += s.parser.stats().whole;
+            if (declare)
+                check(s.parser.stats().whole, "seed " + std::to_string(seed) + ", edit " + std::to_string(e) +
+                                                  ": a new declaration did not parse the whole program");
+
+            const std::string incremental = record(s.parser.root(), s.source), fresh = fresh_parse(s.text);
+            if (incremental != fresh)
+            {
+                size_t at = 0;
+                while (at < incremental.size() && at < fresh.size() && incremental[at] == fresh[at])
+                    ++at;
+                check(false, "seed " + std::to_string(seed) + ", edit " + std::to_string(e) + " (" + name +
+                                 "): tree differs from a fresh parse at \"" + incremental.substr(at, 40) +
+                                 "\" vs \"" + fresh.substr(at, 40) + "\"");
+                break;
+            }
+        }
+    }
+    check(reused > 0, "no statement was ever reused");
+    check(whole < edits, "every edit parsed the whole program");
+    std::printf("%zu edits, %zu statements reused, %zu whole-program parses\n", edits, reused, whole);
+    return report("incremental_parse");
+}
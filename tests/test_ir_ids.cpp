@@ -0,0 +1,56 @@
+// Operand ids: IROperand::make and the allocators refuse ids past 29 bits
+// with a diagnostic instead of wrapping into the kind bits, and immediates
+// are interned by value.
+
+#include <stdexcept>
+#include <string>
+
+#include "check.hpp"
+#include "ir.hpp"
+
+template <class F>
+static bool throws(F body)
+{
+    try
+    {
+        body();
+    }
+    catch (const std::runtime_error &)
+    {
+        return true;
+    }
+    return false;
+}
+
+int main()
+{
+    const uint32_t last = IROperand::id_mask;
+    for (OperandKind kind : {OperandKind::Variable, OperandKind::Temp, OperandKind::Immediate, OperandKind::Label,
+                             OperandKind::String})
+    {
+        IROperand o = IROperand::make(kind, last);
+        check(o.kind() == kind && o.id() == last, "the largest id keeps its kind");
+        check(throws([&] { IROperand::make(kind, last + 1); }), "an id past 29 bits is refused");
+    }
+    check(throws([] { IROperand::make(OperandKind::Temp, UINT32_MAX); }), "an id of 32 bits is refused");
+
+    // Temporaries only count, so the table can be filled to the limit.
+    Interner names;
+    SymbolTable symbols(names);
+    uint32_t t = 0;
+    for (uint32_t i = 0; i < SymbolTable::max_ids; ++i)
+        t = symbols.add_temp();
+    check(t == last && IROperand::temp(t).id() == last, "temporaries are numbered up to the limit");
+    check(throws([&] { symbols.add_temp(); }), "a temporary past the limit is refused");
+    check(symbols.temps() == SymbolTable::max_ids, "a refused temporary is not counted");
+
+    InterCodeArray ir;
+    ir.labels = SymbolTable::max_ids - 1;
+    check(ir.new_label().id() == last, "the last label is given out");
+    check(throws([&] { ir.new_label(); }), "a label past the limit is refused");
+
+    IROperand a = ir.immediate(42), b = ir.immediate(-7), c = ir.immediate(42);
+    check(a == c && a != b && ir.immediates.size() == 2, "repeated immediates share one id");
+    check(ir.value(a) == 42 && ir.value(b) == -7, "immediates keep their values");
+    return report("ir_ids");
+}
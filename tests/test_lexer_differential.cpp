@@ -0,0 +1,151 @@
+// Differential test of the hand-written kernels against the flex scanner:
+// every input is lexed by tokenize(LexerKind::Flex) and by the scalar, SSE2
+// and AVX2 kernels (those the CPU has), and the streams must agree token
+// by token, or all of them fail with the same error.
+//
+// Inputs are the benchmark corpora over several seeds, and handwritten
+// cases for what the kernels treat specially: strings with escapes and
+// with '#' or newlines in them, quotes inside comments, and comments,
+// blanks and identifier runs of every length up to 70 put behind every
+// offset up to 70, so that they start and end on each side of the 16- and
+// 32-byte block edges.
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "check.hpp"
+#include "corpus.hpp"
+#include "lexer.hpp"
+
+struct Result
+{
+    std::unique_ptr<Source> source;
+    std::vector<Token> tokens;
+    std::string error;
+};
+
+static Result lex(const std::string &text, LexerKind kind)
+{
+    Result r;
+    r.source = std::make_unique<Source>(text);
+    try
+    {
+        r.tokens = tokenize(*r.source, kind);
+    }
+    catch (const std::runtime_error &e)
+    {
+        r.error = e.what();
+    }
+    return r;
+}
+
+static size_t inputs = 0;
+
+static void compare(const std::string &text, const std::string &label)
+{
+    static const struct
+    {
+        LexerKind kind;
+        const char *name;
+    } kernels[] = {{LexerKind::Scalar, "scalar"}, {LexerKind::Sse2, "sse2"}, {LexerKind::Avx2, "avx2"}};
+
+    ++inputs;
+    const Result flex = lex(text, LexerKind::Flex);
+    for (const auto &k : kernels)
+    {
+        if (k.kind > best_simd_lexer())
+            continue;
+        const Result r = lex(text, k.kind);
+        const std::string where = std::string(k.name) + " vs flex on " + label + ": ";
+        if (!flex.error.empty() || !r.error.empty())
+        {
+            check(flex.error == r.error, where + "error \"" + r.error + "\" vs \"" + flex.error + "\"");
+            continue;
+        }
+        std::string why;
+        check(same_tokens(*r.source, r.tokens, *flex.source, flex.tokens, why), where + why);
+    }
+}
+
+static void corpora()
+{
+    const char *names[] = {"program", "identifiers", "literals", "comments", "strings"};
+    for (int mix = 0; mix < 5; ++mix)
+        for (uint32_t seed = 1; seed <= 8; ++seed)
+        {
+            std::string text;
+            CorpusGenerator(seed).generate(text, 64 << 10, static_cast<Mix>(mix));
+            compare(text, std::string(names[mix]) + " corpus, seed " + std::to_string(seed));
+        }
+    std::string text;
+    CorpusGenerator(7).generate_nested(text, 64 << 10, 200);
+    compare(text, "nested corpus");
+}
+
+static void handwritten()
+{
+    const char *cases[] = {
+        "",
+        "\n",
+        "cout << \"a\\\"b\";",
+        "cout << \"\\\\\";",
+        "cout << \"\\n\\t\\\\\\\"\";",
+        "cout << \"# not a comment\";",
+        "cout << \"two\nlines\";",
+        "cout << \"\";x",
+        "# \"a quote in a comment\nx = 1;",
+        "# 'single' and \"unbalanced\nx = 1;",
+        "#\"\nx",
+        "x # comment at the end",
+        "# comment with no newline",
+        "int a; a = 0123 + 9;",
+        "a==b!=c<=d>=e&&f||!g<h>i<<j",
+        "while(x){if(y){x=x-1;}else{y=y/2;}}",
+        // Errors.
+        "x = 1; @",
+        "x = \"unterminated;\ny = 2;",
+        "\n\n\n$",
+        "a & b",
+        "a | b",
+    };
+    for (const char *c : cases)
+        compare(c, "\"" + std::string(c) + "\"");
+}
+
+static void block_edges()
+{
+    const std::string runs[] = {"a", "#", " ", "\t", "\n", "\"", "1"};
+    for (size_t pad = 0; pad <= 70; ++pad)
+        for (size_t len = 1; len <= 70; ++len)
+            for (const std::string &r : runs)
+            {
+                std::string text(pad, ' ');
+                if (r == "#" || r == "\"")
+                {
+                    // A comment or a string whose body is `len` bytes long.
+                    text += r;
+                    text.append(len, 'x');
+                    if (r == "\"")
+                        text += '"';
+                }
+                else
+                {
+                    for (size_t i = 0; i < len; ++i)
+                        text += r;
+                }
+                compare(text, "run of " + std::to_string(len) + " '" + r + "' after " + std::to_string(pad));
+                compare(text + "\n;x", "run of " + std::to_string(len) + " '" + r + "' after " +
+                                           std::to_string(pad) + ", then more");
+            }
+}
+
+int main()
+{
+    corpora();
+    handwritten();
+    block_edges();
+    std::printf("%zu inputs\n", inputs);
+    return report("lexer_differential");
+}
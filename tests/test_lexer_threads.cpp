@@ -0,0 +1,79 @@
+// Lexes many files at the same time on a pool of threads, one Lexer and one
+// Source per file, and checks that every file gets the tokens it gets when
+// the files are lexed one after another. Run for each hand-written kernel
+// the CPU has; the flex scanner is not reentrant and is not run here.
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "check.hpp"
+#include "corpus.hpp"
+#include "lexer.hpp"
+
+struct File
+{
+    std::string text;
+    std::unique_ptr<Source> source;
+    std::vector<Token> tokens;
+};
+
+static std::vector<File> make_files(size_t count)
+{
+    std::vector<File> files(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        // Sizes from a few hundred bytes to 64 KB, with every mix.
+        const Mix mix = static_cast<Mix>(i % 5);
+        CorpusGenerator(static_cast<uint32_t>(i + 1)).generate(files[i].text, size_t(256) << (i % 9), mix);
+    }
+    return files;
+}
+
+static void lex(File &f, LexerKind kind)
+{
+    f.source = std::make_unique<Source>(f.text);
+    f.tokens = lex_string_to_tokens(*f.source, kind);
+}
+
+static void run(LexerKind kind, const char *name, unsigned threads)
+{
+    const size_t count = 256;
+    std::vector<File> serial = make_files(count), pooled = make_files(count);
+    for (File &f : serial)
+        lex(f, kind);
+
+    // Workers take the next file from a shared counter until none is left.
+    std::atomic<size_t> next{0};
+    std::vector<std::thread> pool;
+    for (unsigned t = 0; t < threads; ++t)
+        pool.emplace_back([&] {
+            for (size_t i; (i = next.fetch_add(1)) < count;)
+                lex(pooled[i], kind);
+        });
+    for (std::thread &t : pool)
+        t.join();
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        std::string why;
+        bool same = same_tokens(*serial[i].source, serial[i].tokens, *pooled[i].source, pooled[i].tokens, why);
+        check(same, std::string(name) + ", file " + std::to_string(i) + ": " + why);
+    }
+}
+
+int main()
+{
+    // More threads than cores as well, so that lexers are preempted mid-file.
+    const unsigned threads = std::max(8u, 2 * std::thread::hardware_concurrency());
+    const LexerKind best = best_simd_lexer();
+    run(LexerKind::Scalar, "scalar", threads);
+    if (best >= LexerKind::Sse2)
+        run(LexerKind::Sse2, "sse2", threads);
+    if (best >= LexerKind::Avx2)
+        run(LexerKind::Avx2, "avx2", threads);
+    return report("lexer_threads");
+}
@@ -0,0 +1,151 @@
+// Counts the allocations made from loading a program to handing its IR to
+// the code generator, through a replaced global operator new, and checks
+// that none of them copies a whole-program buffer: the program text, the
+// token vector or the IR instructions. A copy of a vector allocates exactly
+// size() elements, so an allocation of that many bytes is one, unless the
+// buffer itself has that capacity; the text is mapped, never allocated.
+//
+// Both ways main compiles are run: from a token vector (flex, or the hand-
+// written lexer on several jobs) through a TokenStore, and streaming from
+// the Lexer, building the AST or in a single pass.
+
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "check.hpp"
+#include "codegen.hpp"
+#include "corpus.hpp"
+#include "input.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
+#include "token_store.hpp"
+
+// Sizes of the allocations of at least `large` bytes made while recording,
+// kept in a fixed array so that recording itself does not allocate.
+static const size_t large = 4096;
+static size_t sizes[1 << 16];
+static size_t recorded = 0, all = 0;
+static bool recording = false;
+
+void *operator new(size_t n)
+{
+    if (recording)
+    {
+        ++all;
+        if (n >= large && recorded < sizeof sizes / sizeof *sizes)
+            sizes[recorded++] = n;
+    }
+    if (void *p = std::malloc(n ? n : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+
+static size_t allocations_of(size_t bytes)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < recorded; ++i)
+        count += sizes[i] == bytes;
+    return count;
+}
+
+// A whole-program buffer of `size` elements of `element` bytes, holding
+// `capacity` of them.
+static void no_copy(const std::string &what, size_t size, size_t capacity, size_t element)
+{
+    if (size * element < large)
+        return;
+    const size_t own = capacity == size ? 1 : 0;
+    const size_t copies = allocations_of(size * element) - own;
+    check(copies == 0, what + ": " + std::to_string(copies) + " allocation(s) of its " +
+                           std::to_string(size * element) + " bytes");
+}
+
+enum class Path
+{
+    Flex,
+    Jobs,
+    Stream,
+    StreamSinglePass
+};
+
+static void compile(const char *path, Path how, const char *name)
+{
+    recorded = all = 0;
+    recording = true;
+
+    InputBuffer input;
+    check(input.load_file(path), std::string(name) + ": cannot load " + path);
+    Source source(input.text(), true);
+    SymbolTable symbols(source.symbols);
+    size_t tokens = 0, token_capacity = 0;
+    GeneratedIR ir;
+
+    if (how == Path::Flex || how == Path::Jobs)
+    {
+        std::vector<Token> toks = how == Path::Flex ? tokenize(source, LexerKind::Flex)
+                                                    : lex_parallel(source, 4, best_simd_lexer());
+        tokens = toks.size();
+        token_capacity = toks.capacity();
+        TokenStore store(toks);
+        std::vector<Token>().swap(toks);
+        TokenStoreSource feed(store, source);
+        Arena ast;
+        Parser parser(feed, source, ast, symbols);
+        ir = IntermediateCodeGen(parser.get_root(), source, symbols).take();
+    }
+    else
+    {
+        Lexer lexer(source, best_simd_lexer());
+        LexerTokenSource feed(lexer);
+        if (how == Path::StreamSinglePass)
+        {
+            IntermediateCodeGen irgen(source, symbols);
+            Parser(feed, source, irgen, symbols).parse();
+            ir = irgen.take();
+        }
+        else
+        {
+            Arena ast;
+            Parser parser(feed, source, ast, symbols);
+            ir = IntermediateCodeGen(parser.get_root(), source, symbols).take();
+        }
+    }
+    const size_t instrs = ir.code.code.size(), instr_capacity = ir.code.code.capacity();
+    CodeGenerator cg(std::move(ir), symbols);
+    recording = false;
+
+    const std::string text = std::string(name) + ", program text";
+    check(allocations_of(source.text.size()) + allocations_of(source.text.size() + 1) +
+                  allocations_of(source.text.size() + 2) ==
+              0,
+          text + " copied");
+    if (tokens)
+        no_copy(std::string(name) + ", token vector", tokens, token_capacity, sizeof(Token));
+    no_copy(std::string(name) + ", IR", instrs, instr_capacity, sizeof(IRInstr));
+    check(recorded < sizeof sizes / sizeof *sizes, std::string(name) + ": too many large allocations to check");
+    std::printf("%-22s %9zu allocations, %5zu of %zu bytes or more\n", name, all, recorded, large);
+}
+
+int main()
+{
+    std::string text;
+    CorpusGenerator(2024).generate(text, 4 << 20);
+    const char *path = "no_copies.txt";
+    if (FILE *f = std::fopen(path, "wb"))
+    {
+        std::fwrite(text.data(), 1, text.size(), f);
+        std::fclose(f);
+    }
+
+    compile(path, Path::Flex, "flex");
+    compile(path, Path::Jobs, "lexer on 4 jobs");
+    compile(path, Path::Stream, "streaming");
+    compile(path, Path::StreamSinglePass, "streaming, single pass");
+    std::remove(path);
+    return report("no_copies");
+}
@@ -0,0 +1,139 @@
+// Differential test of lex_parallel() against the serial lexer: each input
+// is lexed by lex_string_to_tokens() and by lex_parallel() on 2, 3, 4 and 8
+// jobs and on the default count, and the streams must agree token by token,
+// or both fail with the same error.
+//
+// lex_parallel() starts each chunk at the first line after an even split of
+// the text, as if no token were open there. The inputs put a multi-line
+// string across every split point of every job count, with lines in it
+// that read as comments, as code or as a stray backslash when lexed from
+// the chunk start, followed by a comment holding quotes; others put a
+// lexical error inside a chunk, or leave the strings across the splits
+// unclosed.
+
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "check.hpp"
+#include "corpus.hpp"
+#include "lexer.hpp"
+
+struct Result
+{
+    std::unique_ptr<Source> source;
+    std::vector<Token> tokens;
+    std::string error;
+};
+
+// jobs < 0 lexes serially.
+static Result lex(const std::string &text, int jobs)
+{
+    Result r;
+    r.source = std::make_unique<Source>(text);
+    try
+    {
+        r.tokens = jobs < 0 ? lex_string_to_tokens(*r.source, best_simd_lexer())
+                            : lex_parallel(*r.source, static_cast<unsigned>(jobs), best_simd_lexer());
+    }
+    catch (const std::runtime_error &e)
+    {
+        r.error = e.what();
+    }
+    return r;
+}
+
+static void compare(const std::string &text, const std::string &label)
+{
+    const Result serial = lex(text, -1);
+    for (int jobs : {2, 3, 4, 8, 0})
+    {
+        const Result r = lex(text, jobs);
+        const std::string where = label + " on " + (jobs ? std::to_string(jobs) : "the default") + " jobs: ";
+        if (!serial.error.empty() || !r.error.empty())
+        {
+            check(serial.error == r.error, where + "error \"" + r.error + "\" vs \"" + serial.error + "\"");
+            continue;
+        }
+        std::string why;
+        check(same_tokens(*r.source, r.tokens, *serial.source, serial.tokens, why), where + why);
+    }
+}
+
+// A statement printing a string of `lines` lines, then a comment holding
+// quotes. Lexed from a line start inside it, lines read as a comment, as
+// code, or as a stray backslash, and its closing quote opens a string.
+static std::string multi_line_string(size_t lines)
+{
+    static const char *looks[] = {"# a comment?", "x = 1; \\\" escaped", "plain words", "", "y = 2 # z"};
+    std::string s = "cout << \"";
+    for (size_t i = 0; i < lines; ++i)
+        s += std::string(looks[i % 5]) + "\n";
+    return s + "\";\n# a \"quote\" in a comment\n";
+}
+
+// The generated program with `piece` put at the end of a statement ahead
+// of every split point of every job count compared, `before` bytes early.
+// The pieces are put in from the front, so positions ahead of the next
+// split point are final by the time it is reached.
+static std::string with_pieces(uint32_t seed, size_t bytes, const std::string &piece, size_t before)
+{
+    std::string program;
+    CorpusGenerator(seed).generate(program, bytes);
+    // Every job count splits at multiples of size / jobs of the final text.
+    std::vector<double> fractions;
+    for (size_t jobs : {2, 3, 4, 8})
+        for (size_t i = 1; i < jobs; ++i)
+            fractions.push_back(double(i) / double(jobs));
+    std::sort(fractions.begin(), fractions.end());
+    fractions.erase(std::unique(fractions.begin(), fractions.end()), fractions.end());
+
+    const size_t size = program.size() + fractions.size() * piece.size();
+    std::string text;
+    size_t taken = 0;
+    for (double f : fractions)
+    {
+        const size_t at = size_t(double(size) * f) - before - text.size() + taken;
+        const size_t end = program.rfind(";\n", at) + 2;
+        text.append(program, taken, end - taken);
+        text += piece;
+        taken = end;
+    }
+    text.append(program, taken, std::string::npos);
+    return text;
+}
+
+int main()
+{
+    const size_t bytes = 9 << 20;
+    for (uint32_t seed = 1; seed <= 2; ++seed)
+    {
+        const std::string name = "seed " + std::to_string(seed);
+        std::string plain;
+        CorpusGenerator(seed).generate(plain, bytes);
+        compare(plain, "program, " + name);
+
+        const std::string piece = multi_line_string(4000);
+        compare(with_pieces(seed, bytes, piece, piece.size() / 2), "strings across the split points, " + name);
+
+        // A bad character inside a chunk, away from the split points.
+        std::string bad = plain;
+        const size_t middle = bad.find('\n', bad.size() / 2 + bad.size() / 16);
+        bad.insert(middle + 1, "x = 1 @ 2;\n");
+        compare(bad, "an error inside a chunk, " + name);
+
+        // The strings across the split points with their closing quotes
+        // dropped, so that each one runs into the next.
+        std::string open = multi_line_string(4000);
+        open.erase(open.find("\";"), 1);
+        compare(with_pieces(seed, bytes, open, open.size() / 2), "unclosed strings across the split points, " + name);
+    }
+
+    // Too small to split: every job count lexes serially.
+    std::string small;
+    CorpusGenerator(3).generate(small, 64 << 10);
+    compare(small + multi_line_string(20), "a small program");
+    return report("parallel_lexer");
+}
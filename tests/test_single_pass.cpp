@@ -0,0 +1,116 @@
+// Runs the compiler on the same programs with and without --single-pass,
+// and with --ssa both ways: the IR dump and output.asm must be the same
+// byte for byte. Programs are generated ones over several seeds, a deeply
+// nested one, and a handwritten one with every kind of statement.
+//
+//   ./test_single_pass path/to/compiler
+
+#include <cstdio>
+#include <string>
+#include <sys/wait.h>
+
+#include "check.hpp"
+#include "corpus.hpp"
+
+struct Output
+{
+    std::string ir;   // from "=== IR ===" to the line closing the dump
+    std::string asm_; // output.asm
+    bool ok{false};
+};
+
+static std::string read_file(const char *path)
+{
+    std::string text;
+    if (FILE *f = std::fopen(path, "rb"))
+    {
+        char buf[1 << 16];
+        size_t n;
+        while ((n = std::fread(buf, 1, sizeof buf, f)) > 0)
+            text.append(buf, n);
+        std::fclose(f);
+    }
+    return text;
+}
+
+static Output compile(const char *compiler, const std::string &args, const char *path)
+{
+    Output o;
+    std::remove("output.asm");
+    FILE *out = popen((std::string(compiler) + " " + args + " " + path).c_str(), "r");
+    if (!out)
+        return o;
+    std::string all;
+    char buf[1 << 16];
+    size_t n;
+    while ((n = std::fread(buf, 1, sizeof buf, out)) > 0)
+        all.append(buf, n);
+    const int status = pclose(out);
+    o.ok = status != -1 && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+
+    const size_t begin = all.find("=== IR ===\n");
+    const size_t end = begin == std::string::npos ? begin : all.find("\n==========\n", begin);
+    if (end != std::string::npos)
+        o.ir = all.substr(begin, end - begin);
+    o.asm_ = read_file("output.asm");
+    return o;
+}
+
+// Where two texts first differ, with a little of each.
+static std::string difference(const std::string &x, const std::string &y)
+{
+    size_t at = 0;
+    while (at < x.size() && at < y.size() && x[at] == y[at])
+        ++at;
+    return "at byte " + std::to_string(at) + ": \"" + x.substr(at, 40) + "\" vs \"" + y.substr(at, 40) + "\"";
+}
+
+static void compare(const char *compiler, const std::string &text, const std::string &name)
+{
+    const char *path = "single_pass.txt";
+    if (FILE *f = std::fopen(path, "wb"))
+    {
+        std::fwrite(text.data(), 1, text.size(), f);
+        std::fclose(f);
+    }
+    for (const char *ssa : {"", "--ssa "})
+    {
+        const std::string label = name + (*ssa ? ", with --ssa" : "");
+        const Output two = compile(compiler, ssa, path);
+        const Output one = compile(compiler, std::string(ssa) + "--single-pass", path);
+        check(two.ok && one.ok, label + ": compiler failed");
+        check(!two.ir.empty() && !two.asm_.empty(), label + ": no IR dump or no output.asm");
+        check(one.ir == two.ir, label + ": IR dumps differ " + difference(one.ir, two.ir));
+        check(one.asm_ == two.asm_, label + ": output.asm differs " + difference(one.asm_, two.asm_));
+    }
+    std::remove(path);
+    std::remove("output.asm");
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        std::fprintf(stderr, "usage: %s path/to/compiler\n", argv[0]);
+        return 2;
+    }
+    compare(argv[1],
+            "int i; int s; int t; string name; i = 0; s = 0;\n"
+            "while (i < 10 && s < 100) {\n"
+            "  if (i == 3 || i == 5) { s = s + i * 2; } else { s = s - (i / 2) + 1; }\n"
+            "  t = i / 2; if (!t || s == 0) { cout << \"first\\n\"; }\n"
+            "  i = i + 1;\n"
+            "}\n"
+            "cout << name; cout << s; cout << \"done\\n\";\n",
+            "handwritten program");
+    for (uint32_t seed = 1; seed <= 6; ++seed)
+    {
+        std::string text;
+        CorpusGenerator(seed).generate(text, 32 << 10);
+        compare(argv[1], text, "generated program, seed " + std::to_string(seed));
+    }
+    std::string nested;
+    CorpusGenerator(7).generate_nested(nested, 32 << 10, 200);
+    compare(argv[1], nested, "nested program");
+    return report("single_pass");
+}
@@ -0,0 +1,288 @@
+// SSA construction and destruction. Each program is run before and after a
+// round trip through SSA form by a small interpreter of the IR, which must
+// print the same; the round trip is made as it is and with copies
+// propagated while in SSA form, which makes phis copy each other in
+// cycles, as variables swapped or rotated in a loop do. The verifier must
+// accept every SSA form built, and reject it once it is broken: a
+// temporary assigned twice, a variable assigned, a temporary used without
+// a definition and one used where its definition does not dominate.
+//
+// Programs are handwritten ones (nested while and if blocks, a swap and a
+// rotation in a loop) and generated ones.
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "check.hpp"
+#include "corpus.hpp"
+#include "program.hpp"
+#include "ssa.hpp"
+
+// What a program prints in its first `steps` instructions, and whether it
+// got to the end. Arithmetic wraps as the machine's does; a division by
+// zero or of the smallest value by -1 ends the run, as the trap would.
+struct Run
+{
+    std::string output;
+    bool finished{false};
+};
+
+static Run run(const InterCodeArray &ir, const SymbolTable &symbols, size_t steps)
+{
+    std::vector<uint32_t> label_at(ir.labels, 0);
+    for (uint32_t i = 0; i < ir.code.size(); ++i)
+        if (ir.code[i].op == IROp::Label)
+            label_at[ir.code[i].dst.id()] = i;
+    std::vector<int64_t> variables(symbols.size(), 0), temps(symbols.temps(), 0);
+    auto value = [&](IROperand o) -> int64_t {
+        switch (o.kind())
+        {
+        case OperandKind::Immediate: return ir.value(o);
+        case OperandKind::Variable: return variables[o.id()];
+        default: return temps[o.id()];
+        }
+    };
+    auto slot = [&](IROperand o) -> int64_t & {
+        return o.kind() == OperandKind::Variable ? variables[o.id()] : temps[o.id()];
+    };
+
+    Run r;
+    for (uint32_t pc = 0; steps-- > 0; ++pc)
+    {
+        if (pc >= ir.code.size())
+        {
+            r.finished = true;
+            return r;
+        }
+        const IRInstr &ins = ir.code[pc];
+        const uint64_t a = static_cast<uint64_t>(value(ins.a));
+        const uint64_t b = ins.b.empty() ? 0 : static_cast<uint64_t>(value(ins.b));
+        bool taken = false;
+        switch (ins.op)
+        {
+        case IROp::Copy: slot(ins.dst) = static_cast<int64_t>(a); break;
+        case IROp::Add: slot(ins.dst) = static_cast<int64_t>(a + b); break;
+        case IROp::Sub: slot(ins.dst) = static_cast<int64_t>(a - b); break;
+        case IROp::Mul: slot(ins.dst) = static_cast<int64_t>(a * b); break;
+        case IROp::Div:
+            if (b == 0 || (int64_t(a) == INT64_MIN && int64_t(b) == -1))
+            {
+                r.finished = true;
+                return r;
+            }
+            slot(ins.dst) = int64_t(a) / int64_t(b);
+            break;
+        case IROp::Label: break;
+        case IROp::Jump: taken = true; break;
+        case IROp::JumpEq: taken = int64_t(a) == int64_t(b); break;
+        case IROp::JumpNe: taken = int64_t(a) != int64_t(b); break;
+        case IROp::JumpLt: taken = int64_t(a) < int64_t(b); break;
+        case IROp::JumpLe: taken = int64_t(a) <= int64_t(b); break;
+        case IROp::JumpGt: taken = int64_t(a) > int64_t(b); break;
+        case IROp::JumpGe: taken = int64_t(a) >= int64_t(b); break;
+        case IROp::PrintInt: r.output += std::to_string(int64_t(a)) + "\n"; break;
+        case IROp::PrintString: r.output += std::string(symbols.string_text(ins.a.id())); break;
+        }
+        if (taken)
+            pc = label_at[ins.dst.id()];
+    }
+    return r;
+}
+
+// The round trip adds copies, so a run cut short may print less: the
+// shorter output must start the longer one, and be it when both finish.
+static bool same_behaviour(const Run &x, const Run &y)
+{
+    if (x.finished && y.finished)
+        return x.output == y.output;
+    const std::string &shorter = x.output.size() < y.output.size() ? x.output : y.output;
+    const std::string &longer = x.output.size() < y.output.size() ? y.output : x.output;
+    return longer.compare(0, shorter.size(), shorter) == 0;
+}
+
+// Copy propagation, as a pass working on the SSA form would do it: uses of
+// a temporary that a Copy assigns read the copy's source instead.
+static void propagate_copies(InterCodeArray &ir, const SymbolTable &symbols, SsaForm &ssa)
+{
+    std::vector<IROperand> source(symbols.temps());
+    for (const IRInstr &ins : ir.code)
+        if (ins.op == IROp::Copy && ins.dst.kind() == OperandKind::Temp)
+            source[ins.dst.id()] = ins.a;
+    auto resolve = [&](IROperand o) {
+        while (o.kind() == OperandKind::Temp && !source[o.id()].empty())
+            o = source[o.id()];
+        return o;
+    };
+    for (IRInstr &ins : ir.code)
+    {
+        ins.a = resolve(ins.a);
+        ins.b = resolve(ins.b);
+    }
+    for (uint32_t i = 0; i < ssa.size(); ++i)
+        for (uint32_t k = 0; k < ssa[i].count; ++k)
+            ssa.arg(ssa[i], k) = resolve(ssa.arg(ssa[i], k));
+    ir.changed();
+}
+
+// The verifier's complaint, or "" if it accepts the form.
+static std::string verdict(SsaForm &ssa, FlowAnalysis &flow)
+{
+    try
+    {
+        ssa.verify(flow);
+    }
+    catch (const std::runtime_error &e)
+    {
+        return e.what();
+    }
+    return "";
+}
+
+static bool contains(const std::string &s, const char *part) { return s.find(part) != std::string::npos; }
+
+// Breaks the form in each way the verifier must catch, putting it back
+// after each.
+static void check_rejections(Program &p, SsaForm &ssa, FlowAnalysis &flow, const std::string &name)
+{
+    std::vector<IRInstr> &code = p.ir.code;
+    std::vector<uint32_t> assigning;
+    for (uint32_t i = 0; i < code.size(); ++i)
+        if (assigns(code[i].op))
+            assigning.push_back(i);
+    IRInstr &x = code[assigning.front()], &y = code[assigning.back()];
+    const IRInstr kept = y;
+    auto restore = [&] {
+        y = kept;
+        p.ir.changed();
+    };
+
+    y.dst = x.dst;
+    p.ir.changed();
+    check(contains(verdict(ssa, flow), "defined twice"), name + ": a temporary assigned twice is accepted");
+    restore();
+
+    y.dst = IROperand::variable(0);
+    p.ir.changed();
+    check(contains(verdict(ssa, flow), "is assigned"), name + ": an assigned variable is accepted");
+    restore();
+
+    y.a = IROperand::temp(p.symbols.add_temp());
+    p.ir.changed();
+    check(contains(verdict(ssa, flow), "never defined"), name + ": a temporary with no definition is accepted");
+    restore();
+
+    // An operand read before the assignment that comes later in its block.
+    // The CFG is rebuilt once the code changes, so the pair is found first.
+    uint32_t use = 0, def = 0;
+    const ControlFlowGraph &cfg = flow.cfg();
+    for (uint32_t b = 0; b < cfg.size() && !def; ++b)
+        for (uint32_t i = cfg.begin(b); i < cfg.end(b) && !def; ++i)
+            for (uint32_t j = i + 1; j < cfg.end(b) && !def; ++j)
+                if (code[i].a.is_location() && assigns(code[j].op))
+                {
+                    use = i;
+                    def = j;
+                }
+    check(def != 0, name + ": no use before an assignment in the same block");
+    if (def)
+    {
+        const IROperand used = code[use].a;
+        code[use].a = code[def].dst;
+        p.ir.changed();
+        check(contains(verdict(ssa, flow), "does not dominate"), name + ": a use before its definition is accepted");
+        code[use].a = used;
+        p.ir.changed();
+    }
+    check(verdict(ssa, flow).empty(), name + ": the repaired form is rejected");
+}
+
+struct Totals
+{
+    size_t phis{0}, copies{0}, cycles{0}, split{0};
+};
+
+static void round_trip(const std::string &text, const std::string &name, bool propagate, Totals &totals)
+{
+    const size_t steps = 2000000;
+    Program p(text);
+    const Run before = run(p.ir, p.symbols, steps);
+
+    FlowAnalysis flow(p.ir);
+    SsaForm ssa(p.ir, p.symbols, flow);
+    const std::string label = name + (propagate ? ", copies propagated" : "");
+    std::string why = verdict(ssa, flow);
+    check(why.empty(), label + ": verifier rejects the SSA form: " + why);
+    if (propagate)
+    {
+        propagate_copies(p.ir, p.symbols, ssa);
+        why = verdict(ssa, flow);
+        check(why.empty(), label + ": verifier rejects the propagated form: " + why);
+    }
+    else
+    {
+        totals.phis += ssa.size();
+        check_rejections(p, ssa, flow, label);
+    }
+
+    ssa.destruct(flow);
+    totals.copies += ssa.stats().copies;
+    totals.cycles += ssa.stats().cycles;
+    totals.split += ssa.stats().split;
+    for (const IRInstr &ins : p.ir.code)
+        check(!ins.dst.empty() || !assigns(ins.op), label + ": an instruction lost its destination");
+    const Run after = run(p.ir, p.symbols, steps);
+    check(same_behaviour(before, after), label + ": prints \"" + after.output.substr(0, 80) + "\" instead of \"" +
+                                             before.output.substr(0, 80) + "\"");
+}
+
+static void both(const std::string &text, const std::string &name, Totals &totals)
+{
+    round_trip(text, name, false, totals);
+    round_trip(text, name, true, totals);
+}
+
+int main()
+{
+    Totals nested, swaps, generated;
+    both("int i; int j; int s; i = 0; s = 0;\n"
+         "while (i < 4) {\n"
+         "  j = 0;\n"
+         "  while (j < i) {\n"
+         "    if (j == 1) { s = s + 10; } else { if (s > 3) { s = s * 2; } else { s = s + 1; } }\n"
+         "    if (s > 30) { s = s - 7; }\n"
+         "    j = j + 1;\n"
+         "  }\n"
+         "  if (s > 20) { cout << s; } else { cout << \"small\"; }\n"
+         "  i = i + 1;\n"
+         "}\n"
+         "cout << s;\n",
+         "nested while and if", nested);
+    check(nested.phis > 0, "nested blocks place no phis");
+
+    // Variables swapped and rotated in a loop: with copies propagated their
+    // phis read each other, and the copies out of SSA form a cycle.
+    both("int a; int b; int t; int i; a = 1; b = 2; i = 0;\n"
+         "while (i < 5) { t = a; a = b; b = t; i = i + 1; cout << a; cout << b; }\n",
+         "swap", swaps);
+    both("int a; int b; int c; int t; int i; a = 1; b = 2; c = 3; i = 0;\n"
+         "while (i < 7) { t = a; a = b; b = c; c = t; i = i + 1; cout << a; }\n"
+         "cout << b; cout << c;\n",
+         "rotation", swaps);
+    check(swaps.cycles >= 2, "the swap and the rotation break " + std::to_string(swaps.cycles) + " cycles");
+
+    for (uint32_t seed = 1; seed <= 10; ++seed)
+    {
+        std::string text = "int a; int b; int t; int i; a = 1; b = 2; i = 0;\n"
+                           "while (i < 5) { t = a; a = b; b = t; i = i + 1; cout << a; cout << b; }\n";
+        CorpusGenerator(seed).generate(text, 16 << 10);
+        both(text, "generated program, seed " + std::to_string(seed), generated);
+    }
+    check(generated.phis > 0 && generated.copies > 0, "generated programs place no phis");
+    check(generated.split > 0, "generated programs split no edges");
+
+    std::printf("%zu phis, %zu copies, %zu cycles\n", nested.phis + swaps.phis + generated.phis,
+                nested.copies + swaps.copies + generated.copies, nested.cycles + swaps.cycles + generated.cycles);
+    return report("ssa");
+}
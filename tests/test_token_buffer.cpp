@@ -0,0 +1,134 @@
+// Random edits through TokenBuffer::apply(): after each, the buffer must
+// hold the tokens a full lex of the edited text gives. Edits insert,
+// delete or replace a few bytes inside a token, inside a string literal,
+// between tokens, and at the start and at the end of the text; what they
+// insert splits, joins and opens tokens, strings and comments. An edit the
+// lexer rejects must leave the buffer as it was; the test then takes the
+// edit back.
+
+#include <algorithm>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "check.hpp"
+#include "corpus.hpp"
+#include "lexer.hpp"
+#include "token_buffer.hpp"
+
+static const char *snippets[] = {"a",  "z9", "12", " ",  "\n",     "#",    "# note\n", "\"",  "\"s\"",
+                                 "==", "=",  "<",  "&&", "x = 1;", "cout", "{",        "\\", "@"};
+
+struct Session
+{
+    std::string text;
+    Source source;
+    TokenBuffer tokens;
+    std::mt19937 rng;
+    size_t edits{0}, rejected{0};
+
+    Session(std::string program, uint32_t seed)
+        : text(std::move(program)), source(text), tokens(lex_string_to_tokens(source, best_simd_lexer())), rng(seed)
+    {
+    }
+
+    // Where an edit goes: the start or end of the text, inside a token or
+    // a string literal, or just before a token.
+    uint32_t place()
+    {
+        const size_t count = tokens.size() - 1;
+        switch (rng() % 5)
+        {
+        case 0: return 0;
+        case 1: return static_cast<uint32_t>(text.size());
+        case 2:
+            for (int tries = 0; tries < 64; ++tries)
+            {
+                Token t = tokens[rng() % count];
+                if (t.type == TokenType::String)
+                    return t.offset + 1 + rng() % (t.length - 1);
+            }
+            [[fallthrough]];
+        case 3:
+        {
+            Token t = tokens[rng() % count];
+            return t.offset + rng() % t.length;
+        }
+        default: return tokens[rng() % count].offset;
+        }
+    }
+
+    void edit(const std::string &label)
+    {
+        const uint32_t offset = place();
+        const uint32_t removed = rng() % 3 == 0 ? 0 : std::min<uint32_t>(rng() % 8, uint32_t(text.size()) - offset);
+        const std::string inserted = rng() % 4 == 0 ? "" : snippets[rng() % (sizeof snippets / sizeof *snippets)];
+        const std::string where = label + ", edit " + std::to_string(edits) + " (" + std::to_string(removed) +
+                                  " bytes at " + std::to_string(offset) + " by \"" + inserted + "\")";
+        ++edits;
+
+        const std::vector<Token> before = tokens.to_vector();
+        const std::string old = text.substr(offset, removed);
+        text.replace(offset, removed, inserted);
+        source.text = text;
+        source.text_changed();
+
+        Source fresh(text);
+        std::string expected;
+        std::vector<Token> relexed;
+        try
+        {
+            relexed = lex_string_to_tokens(fresh, best_simd_lexer());
+        }
+        catch (const std::runtime_error &e)
+        {
+            expected = e.what();
+        }
+
+        std::string error;
+        try
+        {
+            tokens.apply(source, TextEdit{offset, removed, inserted});
+        }
+        catch (const std::runtime_error &e)
+        {
+            error = e.what();
+        }
+
+        std::string why;
+        if (!error.empty() || !expected.empty())
+        {
+            check(!error.empty() && !expected.empty(), where + ": error \"" + error + "\" vs \"" + expected + "\"");
+            check(same_tokens(source, tokens.to_vector(), source, before, why),
+                  where + ": a rejected edit changed the buffer: " + why);
+            ++rejected;
+            text.replace(offset, inserted.size(), old);
+            source.text = text;
+            source.text_changed();
+            return;
+        }
+        check(same_tokens(source, tokens.to_vector(), fresh, relexed, why), where + ": " + why);
+    }
+};
+
+int main()
+{
+    size_t edits = 0, rejected = 0;
+    for (Mix mix : {Mix::Program, Mix::Strings, Mix::Comments})
+        for (uint32_t seed = 1; seed <= 3; ++seed)
+        {
+            std::string text;
+            CorpusGenerator(seed).generate(text, 8 << 10, mix);
+            Session s(std::move(text), seed);
+            const std::string label = std::string(mix_name(mix)) + " corpus, seed " + std::to_string(seed);
+            for (int e = 0; e < 1000 && failures() < 10; ++e)
+                s.edit(label);
+            edits += s.edits;
+            rejected += s.rejected;
+        }
+    check(rejected > 0 && rejected < edits, "of " + std::to_string(edits) + " edits " + std::to_string(rejected) +
+                                                " were rejected");
+    std::printf("%zu edits, %zu rejected\n", edits, rejected);
+    return report("token_buffer");
+}